@@ -35,6 +35,25 @@ private:
   float  _dur_trip;           //!< duration of the trip to reach activity localization (in seconds)
   long   _nodeId;             //!< id of the node where the activity occurs.
 
+  //! Initialize the last activity of an Individual, i.e. returning home.
+  /*!
+    \param endNode id node of the house
+    \param durTrip duration of the trip to the house
+   */
+  void initReturnHome(long endNode, float durTrip);
+
+  //! Compute the duration of the trip (given the distance), the duration and the end time of the activity.
+  /*!
+    \param startTime time at which the trip to the activity starts
+   */
+  void initTrip(float startTime);
+
+  //! Compute the duration and the end time of the activity.
+  /*!
+    \param startTime time at which the activity starts
+   */
+  void initDuration(float startTime);
+
 public:
 
   //! Constructor
@@ -63,6 +82,46 @@ public:
    */
   Activity(char aType, long node, bool start, float startTime);
 
+  //! Constructor of an activity whose localization and trip are already known
+  /*!
+    This constructor generate an activity of type aType taking place at a given node,
+    reached by a trip of a given distance (see drawTripDistance()) and duration (see
+    drawTripDurations()), and compute its end time.
+
+    \param aType the desired type of activity.
+    \param destNode the network's node id where the activity is taking place.
+    \param distance the distance of the trip to the activity.
+    \param durTrip the duration of the trip to the activity.
+    \param startTime starting time of the trip to the activity (used to compute the end time)
+   */
+  Activity(char aType, long destNode, float distance, float durTrip, float startTime);
+
+  //! Draw the distance of the trip to an activity of a given type.
+  /*!
+    \param aTypeNum the type of the activity (integer coding)
+
+    \return a distance (in meters, at least 1)
+   */
+  static float drawTripDistance(int aTypeNum);
+
+  //! Draw the durations of independent trips of given distances at once.
+  /*!
+    The trips of at most 1 meter last 0 second, the other durations are drawn
+    together (see BatchMixtureLogNormal::devs()).
+
+    \param distances the distance of each trip
+    \param durations the duration of each trip (output)
+   */
+  static void drawTripDurations(const std::vector<float> & distances, std::vector<float> & durations);
+
+  //! Draw the house departure times of the individuals whose first activity has a given type.
+  /*!
+    \param aNextTypeNum type of the first activity performed after leaving home (integer coding)
+    \param endTimes the house departure time of each individual (output, in seconds, at least 1)
+    \param n the number of individuals
+   */
+  static void drawHouseDepartures(int aNextTypeNum, float * endTimes, int n);
+
   //! Constructor of the first activity
   /*!
     This constructor should be used to generate the first activity of an agent, i.e.
@@ -74,6 +133,13 @@ public:
   */
   Activity(long nodeId, int nextActivityType);
 
+  //! Constructor of the first activity when the house departure time is already drawn
+  /*!
+    \param nodeId the node id where the activity take place
+    \param endTime the house departure time (see drawHouseDepartures())
+  */
+  Activity(long nodeId, float endTime);
+
   //! Constructor of the last activity
   /*!
     Constructor of the last activity performed by an Individual, i.e. returning home.
@@ -83,6 +149,18 @@ public:
    */
   Activity(long startNode, long endNode);
 
+  //! Constructor of the last activity when the duration of the trip is already known
+  /*!
+    Constructor of the last activity performed by an Individual, i.e. returning home,
+    with a trip duration drawn by the caller (see drawTripDurations()). The node left
+    to reach endNode is unused, it is kept to mirror Activity(long, long) and to tell
+    this constructor from the one of the first activity.
+
+    \param endNode id node where is last activity takes place
+    \param durTrip duration of the trip to endNode
+   */
+  Activity(long, long endNode, float durTrip);
+
   //! Destructor
   virtual ~Activity() {};
 
@@ -0,0 +1,205 @@
+/****************************************************************
+ * CHAINCONTRACTION.HPP
+ *
+ * This file contains the contraction of the chains of degree 2
+ * nodes of the road network (shape nodes of the roads).
+ *
+ * Authors: J. Barthelemy
+ * Date   : 16 october 2013
+ ****************************************************************/
+
+/*! \file ChainContraction.hpp
+ *  \brief Routing graph whose chains of degree 2 nodes are collapsed into single links.
+ */
+
+#ifndef CHAINCONTRACTION_HPP_
+#define CHAINCONTRACTION_HPP_
+
+#include <vector>
+#include "Network.hpp"
+
+//! \brief A routing graph whose chains of degree 2 nodes are collapsed into single links.
+/*!
+  Most nodes of the road network only describe the shape of a road: they are
+  linked to exactly two neighbours, with one link in each direction of travel
+  allowed on the road (e.g. u -> v -> w, and w -> v -> u on a two-way road).
+  Such nodes are called interior nodes; the other ones are core nodes.
+
+  The core graph has the same node indices as the routing graph, but each chain
+  of interior nodes between two core nodes is replaced by a single link whose
+  length is the length of the chain: a search on the core graph never reaches an
+  interior node, which saves one queue operation by interior node. The interior
+  nodes of each contracted link are kept, with their distance from the source of
+  the link, so that their distance from a source node can be interpolated along
+  the link (see Network::getDestFromSource()). An interior node belongs to one
+  contracted link by direction of travel, i.e. at most two.
+
+  A cycle made of interior nodes only keeps one of its nodes as a core node.
+ */
+class ChainContraction {
+
+private:
+
+  RoutingGraph       _core;            //!< core graph (same node indices as the routing graph, no link from an interior node)
+  ConstArray<int>    _link_sources;    //!< source node of each link of the core graph
+  ConstArray<int>    _link_first;      //!< first interior node of each link of the core graph (size M+1)
+  ConstArray<int>    _link_nodes;      //!< interior nodes of the contracted links, in travel order
+  ConstArray<float>  _link_offsets;    //!< distance of each interior node from the source of its link
+  ConstArray<int>    _node_first;      //!< first contracted link of each node (size N+1, empty for core nodes)
+  ConstArray<int>    _node_links;      //!< contracted links containing each interior node (link of the core graph)
+  ConstArray<int>    _node_positions;  //!< position of each interior node in _link_nodes, for each of its links
+  float              _max_length;      //!< length of the longest contracted link
+  int                _nb_interior;     //!< number of interior nodes
+  unsigned long long _checksum;        //!< checksum of the routing graph the core graph has been built from
+
+public:
+
+  //! Constructor.
+  ChainContraction() : _core(), _link_sources(), _link_first(1, 0), _link_nodes(), _link_offsets(), _node_first(1, 0), _node_links(), _node_positions(),
+      _max_length(0.0), _nb_interior(0), _checksum(0) {};
+
+  //! Destructor.
+  virtual ~ChainContraction() {};
+
+  //! Collapse the chains of interior nodes of a routing graph.
+  /*!
+    \param g the routing graph
+    \param reverse the reverse of the routing graph
+   */
+  void build(const RoutingGraph & g, const RoutingGraph & reverse);
+
+  //! Return the core graph.
+  /*!
+    \return the routing graph without the interior nodes' links
+   */
+  const RoutingGraph & getCore() const {
+    return _core;
+  }
+
+  //! Check whether a node is an interior node.
+  /*!
+    \param i a node index
+
+    \return true if the node belongs to a contracted link
+   */
+  bool isInterior(int i) const {
+    return _node_first[i] < _node_first[i + 1];
+  }
+
+  //! Return the source node of a link of the core graph.
+  /*!
+    \param e a link position in the core graph
+
+    \return a node index
+   */
+  int getLinkSource(int e) const {
+    return _link_sources[e];
+  }
+
+  //! Return the position of the first interior node of a link of the core graph.
+  /*!
+    \param e a link position in the core graph
+
+    \return a position in the interior nodes' arrays (see getInteriorNode())
+   */
+  int beginInterior(int e) const {
+    return _link_first[e];
+  }
+
+  //! Return the position following the last interior node of a link of the core graph.
+  /*!
+    \param e a link position in the core graph
+
+    \return a position in the interior nodes' arrays (equal to beginInterior() if the link is not contracted)
+   */
+  int endInterior(int e) const {
+    return _link_first[e + 1];
+  }
+
+  //! Return an interior node.
+  /*!
+    \param pos a position in the interior nodes' arrays
+
+    \return a node index
+   */
+  int getInteriorNode(int pos) const {
+    return _link_nodes[pos];
+  }
+
+  //! Return the distance of an interior node from the source of its link.
+  /*!
+    \param pos a position in the interior nodes' arrays
+
+    \return a distance (unit: meters)
+   */
+  float getInteriorOffset(int pos) const {
+    return _link_offsets[pos];
+  }
+
+  //! Return the position of the first contracted link containing a node.
+  /*!
+    \param i a node index
+
+    \return a position in the node's links arrays (see getNodeLink())
+   */
+  int beginLinks(int i) const {
+    return _node_first[i];
+  }
+
+  //! Return the position following the last contracted link containing a node.
+  /*!
+    \param i a node index
+
+    \return a position in the node's links arrays
+   */
+  int endLinks(int i) const {
+    return _node_first[i + 1];
+  }
+
+  //! Return a contracted link containing an interior node.
+  /*!
+    \param k a position in the node's links arrays
+
+    \return a link position in the core graph
+   */
+  int getNodeLink(int k) const {
+    return _node_links[k];
+  }
+
+  //! Return the position of an interior node in the interior nodes' arrays of one of its links.
+  /*!
+    \param k a position in the node's links arrays
+
+    \return a position in the interior nodes' arrays
+   */
+  int getNodePosition(int k) const {
+    return _node_positions[k];
+  }
+
+  //! Return the length of the longest contracted link.
+  /*!
+    \return a length (unit: meters)
+   */
+  float getMaxLength() const {
+    return _max_length;
+  }
+
+  //! Return the number of interior nodes.
+  /*!
+    \return a number of nodes
+   */
+  int getNbInterior() const {
+    return _nb_interior;
+  }
+
+  //! Return the checksum of the routing graph the core graph has been built from.
+  /*!
+    \return a checksum (see RoutingGraph::getChecksum())
+   */
+  unsigned long long getChecksum() const {
+    return _checksum;
+  }
+
+};
+
+#endif /* CHAINCONTRACTION_HPP_ */
@@ -0,0 +1,133 @@
+/****************************************************************
+ * CONTRACTIONHIERARCHY.HPP
+ *
+ * This file contains the contraction hierarchy used to answer
+ * the point to point distance queries on the road network.
+ *
+ * Authors: J. Barthelemy
+ * Date   : 19 september 2013
+ ****************************************************************/
+
+/*! \file ContractionHierarchy.hpp
+ *  \brief Contraction hierarchy of the routing graph (preprocessing, cache file and distance queries).
+ */
+
+#ifndef CONTRACTIONHIERARCHY_HPP_
+#define CONTRACTIONHIERARCHY_HPP_
+
+#include <string>
+#include <vector>
+#include "Network.hpp"
+
+//! \brief A contraction hierarchy of a routing graph.
+/*!
+  The nodes of the routing graph are contracted one by one, by increasing
+  importance (edge difference and number of contracted neighbours). When a node
+  is contracted, a shortcut is added between two of its neighbours if no
+  witness path avoiding the node is found by a local Dijkstra search.
+
+  The hierarchy is stored as two routing graphs sharing the node indices of the
+  original graph: the upward graph, containing the links (and shortcuts) going
+  from a node to a more important one, and the downward graph, containing the
+  reversed links going from a node to a less important one. A distance query is
+  a bidirectional Dijkstra search, forward in the upward graph from the source
+  and backward in the downward graph from the destination. Both searches only
+  settle a few hundred nodes, whatever the size of the network.
+
+  Distances are exact (up to the rounding of the sums of link lengths).
+ */
+class ContractionHierarchy {
+
+private:
+
+  RoutingGraph       _up;            //!< links from a node to a more important node
+  RoutingGraph       _down;          //!< reversed links from a node to a less important node
+  unsigned long long _checksum;      //!< checksum of the routing graph the hierarchy has been built from
+  long               _nb_shortcuts;  //!< number of shortcuts added during the contraction
+
+public:
+
+  //! Constructor.
+  ContractionHierarchy() : _up(), _down(), _checksum(0), _nb_shortcuts(0) {};
+
+  //! Destructor.
+  virtual ~ContractionHierarchy() {};
+
+  //! Build the hierarchy of a routing graph.
+  /*!
+    \param g the routing graph
+   */
+  void build(const RoutingGraph & g);
+
+  //! Write the hierarchy to a cache file.
+  /*!
+    \param filename the path to the cache file
+
+    \return true if the file has been written successfully
+   */
+  bool save(const std::string & filename) const;
+
+  //! Read the hierarchy from a cache file.
+  /*!
+    The file is rejected if it has not been written by the current version of
+    the model or if it has been built from another routing graph.
+
+    \param filename the path to the cache file
+    \param g the routing graph the hierarchy must correspond to
+
+    \return true if the hierarchy has been read successfully
+   */
+  bool load(const std::string & filename, const RoutingGraph & g);
+
+  //! Compute the distance between two nodes.
+  /*!
+    \param source the source node index
+    \param dest the destination node index
+
+    \return the distance between the nodes, the largest float if the destination is not reachable
+   */
+  float distance(int source, int dest) const;
+
+  //! Return the number of nodes of the hierarchy.
+  /*!
+    \return a number of nodes
+   */
+  int getNbNodes() const {
+    return _up.getNbNodes();
+  }
+
+  //! Return the upward graph of the hierarchy.
+  /*!
+    \return the links (and shortcuts) from each node to more important nodes
+   */
+  const RoutingGraph & getUpwardGraph() const {
+    return _up;
+  }
+
+  //! Return the downward graph of the hierarchy.
+  /*!
+    \return the reversed links (and shortcuts) to each node from more important nodes
+   */
+  const RoutingGraph & getDownwardGraph() const {
+    return _down;
+  }
+
+  //! Return the checksum of the routing graph the hierarchy has been built from.
+  /*!
+    \return a checksum (see RoutingGraph::getChecksum())
+   */
+  unsigned long long getChecksum() const {
+    return _checksum;
+  }
+
+  //! Return the number of shortcuts added during the contraction.
+  /*!
+    \return a number of shortcuts
+   */
+  long getNbShortcuts() const {
+    return _nb_shortcuts;
+  }
+
+};
+
+#endif /* CONTRACTIONHIERARCHY_HPP_ */
@@ -17,6 +17,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <limits>
@@ -24,10 +25,15 @@
 #include <stdexcept>
 #include <boost/tokenizer.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/mpi/communicator.hpp>
 #include <math.h>
 #include "repast_hpc/Properties.h"
 #include "repast_hpc/RepastProcess.h"
 #include "Network.hpp"
+#include "RoutingService.hpp"
+#include "SharedSegment.hpp"
 #include "tinyxml2.hpp"
 #include "Random.hpp"
 #include "repast_hpc/TDataSource.h"
@@ -104,23 +110,38 @@ private:
 
   std::map<int, std::vector<long> >    _mun_age_men;              //!< men's age distribution by municipality
   std::map<int, std::vector<long> >    _mun_age_women;            //!< women's age distribution by municipality
+  std::map<int, std::vector<AliasTable> > _mun_age_men_alias;     //!< alias tables of the men's age distribution by municipality and age class
+  std::map<int, std::vector<AliasTable> > _mun_age_women_alias;   //!< alias tables of the women's age distribution by municipality and age class
   std::map<int, float>                 _death_age_men;            //!< death's probability for a man by age
   std::map<int, float>                 _death_age_women;          //!< death's probability for a woman by age
   std::map<int, float>	               _birth_age;		            //!< birth's probability by women's age
   std::map<int, float>		             _birth_men;	              //!< birth's probability to have a boy
-  std::multimap<int, long>             _map_ins_node;             //!< set of node by municipalities' ins code
-  std::map<long,int>                   _map_node_ins;             //!< ins code of node
+  ConstArray<int>                      _ins_codes;                //!< municipalities' ins codes having nodes (increasing)
+  ConstArray<int>                      _ins_offsets;              //!< first node of each ins code in _ins_nodes (size: number of ins codes + 1)
+  ConstArray<long>                     _ins_nodes;                //!< nodes grouped by municipalities' ins code (file order within a municipality)
+  std::vector<int>                     _ins_draw_offsets;         //!< first node of each ins code in _ins_draw_nodes (size: number of ins codes + 1)
+  std::vector<long>                    _ins_draw_nodes;           //!< nodes among which the houses of each ins code are drawn (see getOneNodeIdFromIns())
   std::map<int,char>                   _map_act_intToChar;        //!< activities' code-book (from integer to character encoding)
   std::map<char,int>                   _map_act_charToInt;        //!< activities' code-book (from character to integer encoding)
   std::map<int,dist_param>             _map_act_dist_par_dist;    //!< distribution parameters for activities' distance (log normal)
   std::map<int,dist_param_mixture>     _map_act_tdep_par_dist;    //!< distribution parameters for activities' house departure time (log normal)
   std::map<int, dist_param_mixture_2d> _map_act_start_x_dur;      //!< distribution parameters for activities' starting time x log(duration)
   dist_param_mixture_2d                _act_dist_x_dur_trip_dist; //!< distribution parameters for log(distance) x log(duration of the trip)
+  int                                  _act_start_bin;            //!< width of the starting time bins of _act_dur_condi_start (seconds)
+  int                                  _act_start_nb_bins;        //!< number of starting time bins by activity type
+  std::vector<int>                     _act_dur_condi_start_row;  //!< first entry of each activity type (integer coding) in _act_dur_condi_start, -1 if none
+  std::vector<dist_param_mixture>      _act_dur_condi_start;      //!< activities' duration parameters conditional to the starting time, by activity type and starting time bin
+  dist_param_mixture                   _no_mixture;               //!< empty mixture, returned for the unknown activity types
+  dist_param_mixture                   _trip_dur_condi_dist;      //!< trip duration parameters conditional to a distance of 1 meter (log(distance) = 0)
+  float                                _trip_dur_slope[MIXTURE_MAX_SIZE]; //!< slope of the mean of each trip duration component in log(distance)
   Network                              _network;                  //!< road network
+  RoutingService                       _routing;                  //!< routing service on the road network
   std::map<int, long>                  _indic_mun_size;           //!< size indicator of a municipality
   std::map<int, int>                   _map_ins_id_mun;           //!< map of ins code (key) x id of municipality (value)
   std::map<int, int>                   _map_id_mun_ins;           //!< map of id of municipality (key) x ins code (value)
   repast::Properties                   _props;                    //!< properties of simulation
+  boost::mpi::communicator             _node_comm;                //!< processes running on the same computing node
+  bool                                 _shared;                   //!< true if the read-only data are shared by the processes of a node
 
 public:
 
@@ -140,6 +161,10 @@ public:
 
     this->_props = aProps;
 
+    // Processes sharing the read-only data
+
+    init_shared_memory();
+
     // Socio-demographics data
 
     read_mun_age_men();
@@ -151,6 +176,12 @@ public:
 
     read_node_ins();
     read_network();
+    index_ins_node_draws();
+    read_contraction_hierarchy();
+    read_hub_labels();
+    read_landmarks();
+    this->_routing = RoutingService(&this->_network);
+    read_detour_factors();
     read_indicators();
     read_ins_id_mun();
 
@@ -159,9 +190,15 @@ public:
     read_activity_cdb();
     read_distribution_parameters_distance();
     read_distribution_parameters_start_duration();
+    tabulate_act_duration_condi_start();
     read_distribution_parameters_distance_x_duration_trip();
+    init_duration_condi_dist_trip();
     read_distribution_parameters_house_tdep();
 
+    // Destination sampling index (requires the activities' distance distributions)
+
+    read_ring_index();
+
 
   }
 
@@ -180,27 +217,137 @@ public:
   //! Read the birth probability by age and the probability to have a boy or a girl.
   void read_birth_age();
 
-  //! Read the municipalities's node.
+  //! Group the processes by computing node and decide whether they share the read-only data.
+  /*!
+    The data are shared if the property par.shared_memory is set to 'y' and
+    several processes run on the same computing node.
+   */
+  void init_shared_memory();
+
+  //! Check whether the process reads the input files (i.e. it is the first process of its node, or the data are not shared).
+  /*!
+    \return true if the process reads the input files
+   */
+  bool isNodeReader() const {
+    return !_shared || _node_comm.rank() == 0;
+  }
+
+  //! Place a memory image built by the first process of the node in a segment shared by the processes of the node.
+  /*!
+    Collective operation on the processes of the node: the first process creates
+    and fills the segment, the others map it read-only. The name of the segment
+    is removed once every process has mapped it.
+
+    \param aLabel a label identifying the image (e.g. "network")
+    \param aImage the image (only used by the first process of the node)
+
+    \return the segment, NULL if it could not be created or mapped by every process of the node
+   */
+  boost::shared_ptr<SharedSegment> share_image(const std::string & aLabel, const std::vector<char> & aImage);
+
+  //! Read the municipalities's node (once by computing node if the read-only data are shared).
   void read_node_ins();
 
   //! Read the activities' codebook.
   void read_activity_cdb();
 
   //! Read the road network.
+  /*!
+    The network is mapped from the binary network file if available (see
+    vbel-netconvert), otherwise it is parsed from the XML file, once by computing
+    node if the read-only data are shared.
+   */
   void read_network();
 
+  //! Parse the XML road network (see Network::readXml()).
+  void read_network_xml();
+
+  //! Read (or build) the contraction hierarchy of the road network if activated.
+  void read_contraction_hierarchy();
+
+  //! Read (or build) the hub labels of the road network if activated and a contraction hierarchy is used.
+  void read_hub_labels();
+
+  //! Read (or build) the landmark distance tables of the road network if activated and no contraction hierarchy is used.
+  void read_landmarks();
+
+  //! Read (or build) a routing index cached in a file, shared by the processes.
+  /*!
+    The first process reads the cache file, or builds the index and saves it if
+    the file is missing or outdated. The other processes read the file once it
+    has been written, or build the index themselves if they cannot.
+
+    \param filename the cache file
+    \param name the name of the index in the messages
+    \param load reads the cache file, returns false if it is missing or outdated
+    \param build builds the index on the first process
+    \param rebuild builds the index on the other processes
+    \param save writes the cache file, returns false on failure
+    \return true if this process has built the index
+   */
+  bool share_routing_index(const std::string & filename, const std::string & name,
+                           const boost::function<bool ()> & load, const boost::function<void ()> & build,
+                           const boost::function<void ()> & rebuild, const boost::function<bool ()> & save);
+
+  //! Check random distances of the network against the Dijkstra search.
+  /*!
+    The routing.ch_verify queries are run by the first process and their maximum
+    relative error is broadcast, so that all the processes keep (or disable) the
+    routing index just set on the network together.
+
+    \param nbChecked the number of distances checked
+    \return the maximum relative error, as measured by the first process
+   */
+  float verify_routing_index(int & nbChecked);
+
+  //! Calibrate the detour factors of the fast distance mode if activated (see DetourTable).
+  /*!
+    The searches of the calibration are shared by the processes. The relative
+    errors of the approximate distances are measured on random queries, printed
+    and appended to ../logs/log_fast_distance.csv by the root process.
+   */
+  void read_detour_factors();
+
   //! Read the distribution parameters for activities' distance.
   void read_distribution_parameters_distance();
 
+  //! Read the distance ring index of the road network if activated.
+  void read_ring_index();
+
+  //! Save the distance ring index of the road network if it has been extended during the simulation.
+  void save_ring_index() const;
+
+  //! Index the nodes among which the houses of each municipality are drawn.
+  /*!
+   The nodes of a municipality belonging to the largest strongly connected
+   component of the network are kept, unless it has none.
+   */
+  void index_ins_node_draws();
+
   //! Read the distribution parameters for activities' house time departure.
   void read_distribution_parameters_house_tdep();
 
   //! Read the distribution parameters for activities' starting time x duration.
   void read_distribution_parameters_start_duration();
 
+  //! Tabulate the activities' duration distribution parameters conditional to the starting time.
+  /*!
+   The conditional mixture of each activity type is computed for every starting
+   time bin (property par.act_start_bin, in seconds) up to 48 hours, at the middle
+   of the bin. The later starting times get the parameters of the last bin.
+   */
+  void tabulate_act_duration_condi_start();
+
   //! Read the distribution parameters for distance x duration of a trip.
   void read_distribution_parameters_distance_x_duration_trip();
 
+  //! Prepare the trip duration distribution parameters conditional to the distance.
+  /*!
+   The means of the components are linear in log(distance): their values at
+   log(distance) = 0 and their slopes are computed once.
+   */
+  void init_duration_condi_dist_trip();
+
   //! Read the various indicators used by the activity localization model.
   void read_indicators();
 
@@ -216,6 +363,19 @@ public:
    */
   std::vector<long int> getMunAge(int municipality, char gender);
 
+  //! Draw the age of an individual of a municipality given its gender and age class.
+  /*!
+   The age is drawn from the alias table of the age distribution of the municipality
+   restricted to the age class (0-5, 6-17, 18-39, 40-59, 60 and more).
+
+   \param municipality the INS code of a municipality
+   \param gender       the gender of an individual
+   \param ageClass     the age class of the individual (0 to 4)
+
+   \return an age, -1 if the municipality or the age class is unknown
+   */
+  int drawMunAge(int municipality, char gender, int ageClass);
+
   //! Compute and return the death's probability of an individual.
   /*!
    \param gender the gender of the individual
@@ -251,6 +411,10 @@ public:
 
   //! Return one node of a given municipality identified by its INS code.
   /*!
+    The node is drawn uniformly among the nodes of the municipality belonging to
+    the largest strongly connected component of the network (see Network::labelComponents()),
+    or among all its nodes if none belongs to it.
+
     \param aIns the INS code of the municipality of interest
 
     \return the node's id of the municipality
@@ -273,25 +437,33 @@ public:
 
    \return a mixture of univariate log-normal distributions
   */
-  dist_param_mixture getActHouseTDepParDist(int aActivityType );
+  const dist_param_mixture & getActHouseTDepParDist(int aActivityType );
 
 
   //! Return the activity duration distribution's parameter conditional to a starting time for a given activity type.
   /*!
+   The parameters are read from the table computed when the data are read (see
+   tabulate_act_duration_condi_start()), the starting time being rounded to the
+   middle of its bin.
+
    \param aActivityType type of an activity, integer coding
-   \param aStartTime starting time of an activity
+   \param aStartTime starting time of an activity (seconds)
 
-   \return a mixture of univariate log-normal distributions
+   \return a mixture of univariate log-normal distributions (empty for an unknown activity type)
   */
-  dist_param_mixture getActDurationCondiStartParDist(int aActivityType, int aStartTime);
+  const dist_param_mixture & getActDurationCondiStartParDist(int aActivityType, int aStartTime) const {
+    if ( aActivityType < 0 || aActivityType >= (int) _act_dur_condi_start_row.size() || _act_dur_condi_start_row[aActivityType] < 0 ) return _no_mixture;
+    int bin = std::min(std::max(aStartTime, 0) / _act_start_bin, _act_start_nb_bins - 1);
+    return _act_dur_condi_start[_act_dur_condi_start_row[aActivityType] + bin];
+  }
 
   //! Return a journey duration distribution's parameters conditional to the journey distance.
   /*!
-   \param aDistance the distance performed
+   \param aDistance the distance performed (taken as 1 meter if lower)
 
    \return a mixture of univariate log-normal distributions
    */
-  dist_param_mixture getDurationCondiDistTripParDist(int aDistance);
+  dist_param_mixture getDurationCondiDistTripParDist(int aDistance) const;
 
   //! Return the road network.
   /*!
@@ -301,6 +473,17 @@ public:
     return _network;
   }
 
+  //! Return the routing service on the road network.
+  /*!
+    The service refers to the network of this Data object (copies of a Data object
+    keep referring to the network of the original one).
+
+    \return the routing service
+   */
+  const RoutingService & getRoutingService() const {
+    return _routing;
+  }
+
   //! Return the character to integer activity code-book.
   /*!
    \return character to integer activity code-book
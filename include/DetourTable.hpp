@@ -0,0 +1,154 @@
+/****************************************************************
+ * DETOURTABLE.HPP
+ *
+ * This file contains the detour factors between municipalities,
+ * used to approximate the network distances by the euclidean
+ * distances between the nodes.
+ *
+ * Authors: J. Barthelemy
+ * Date   : 18 october 2013
+ ****************************************************************/
+
+/*! \file DetourTable.hpp
+ *  \brief Detour factors by pair of municipalities (calibration from network searches and approximate distances).
+ */
+
+#ifndef DETOURTABLE_HPP_
+#define DETOURTABLE_HPP_
+
+#include <vector>
+#include "Network.hpp"
+
+//! \brief The detour factors of the road network by pair of municipalities.
+/*!
+  The distance between two nodes is approximated by their euclidean distance
+  times the detour factor of their municipalities (origin, destination), i.e.
+  the average ratio between the network and euclidean distances of the pairs
+  of nodes of these municipalities. A query is answered in constant time, at
+  the cost of the error of the approximation (see measureErrors()).
+
+  The factors are calibrated from network searches: each search from a source
+  node of an origin municipality gives a sample for every destination
+  municipality (one random node of each). The samples of several processes are
+  added before computing the factors (see getSampleSums(), getSampleCounts()),
+  the factor of a pair being the geometric mean of its ratios. A pair without
+  enough samples gets the factor of its origin municipality, then the factor of
+  the whole network.
+ */
+class DetourTable {
+
+private:
+
+  std::vector<int>    _ins;             //!< ins code of each municipality (sorted)
+  std::vector<int>    _node_mun;        //!< municipality of each node, by routing graph index (-1 if none)
+  std::vector<int>    _mun_first;       //!< first node of each municipality in _mun_nodes (size M+1)
+  std::vector<int>    _mun_nodes;       //!< nodes by municipality
+  std::vector<double> _log_sums;        //!< sum of the logarithms of the sampled ratios of each pair of municipalities
+  std::vector<double> _counts;          //!< number of sampled ratios of each pair of municipalities
+  std::vector<float>  _factors;         //!< detour factor of each pair of municipalities (origin x destination)
+  float               _global_factor;   //!< detour factor of the whole network
+  int                 _nb_calibrated;   //!< number of pairs of municipalities with a factor of their own
+
+public:
+
+  //! Constructor.
+  DetourTable() : _ins(), _node_mun(), _mun_first(1, 0), _mun_nodes(), _log_sums(), _counts(), _factors(), _global_factor(1.0), _nb_calibrated(0) {};
+
+  //! Destructor.
+  virtual ~DetourTable() {};
+
+  //! Index the municipalities of the nodes of a road network.
+  /*!
+    \param network the road network (the nodes whose ins code is not positive have no municipality)
+   */
+  void init(const Network & network);
+
+  //! Sample the detour ratios from the nodes of a municipality.
+  /*!
+    \param network the road network
+    \param mun a municipality index
+    \param nbSources the number of searches, each one from a random node of the municipality
+    \param rng a uniform random generator
+   */
+  void addSamples(const Network & network, int mun, int nbSources, Ranq1 & rng);
+
+  //! Compute the detour factors from the samples.
+  /*!
+    \param minSamples the minimum number of samples of a pair of municipalities to get a factor of its own
+   */
+  void computeFactors(int minSamples);
+
+  //! Measure the relative errors of the approximate distances.
+  /*!
+    \param network the road network
+    \param nbQueries the number of random pairs of nodes (the unreachable pairs are skipped)
+    \param rng a uniform random generator
+
+    \return the relative error of each pair, |approximate - exact| / exact (in increasing order)
+   */
+  std::vector<float> measureErrors(const Network & network, int nbQueries, Ranq1 & rng) const;
+
+  //! Approximate the distance between two nodes.
+  /*!
+    \param network the road network
+    \param source_id source node
+    \param dest_id destination node
+
+    \return the euclidean distance between the nodes times their detour factor, the largest float if the
+            destination is not reachable (see Network::mayReach())
+   */
+  float distance(const Network & network, long source_id, long dest_id) const;
+
+  //! Approximate the distance between two nodes.
+  /*!
+    \param network the road network
+    \param source source node index in the routing graph
+    \param dest destination node index in the routing graph
+
+    \return the euclidean distance between the nodes times their detour factor
+   */
+  float distanceIndex(const Network & network, int source, int dest) const;
+
+  //! Return the sums of the logarithms of the sampled ratios (added over the processes before computeFactors()).
+  /*!
+    \return one sum by pair of municipalities (origin x destination)
+   */
+  std::vector<double> & getSampleSums() {
+    return _log_sums;
+  }
+
+  //! Return the numbers of sampled ratios (added over the processes before computeFactors()).
+  /*!
+    \return one number by pair of municipalities (origin x destination)
+   */
+  std::vector<double> & getSampleCounts() {
+    return _counts;
+  }
+
+  //! Return the number of municipalities.
+  /*!
+    \return a number of municipalities
+   */
+  int getNbMunicipalities() const {
+    return _ins.size();
+  }
+
+  //! Return the number of pairs of municipalities with a factor of their own.
+  /*!
+    \return a number of pairs
+   */
+  int getNbCalibrated() const {
+    return _nb_calibrated;
+  }
+
+  //! Return the detour factor of the whole network.
+  /*!
+    \return a factor
+   */
+  float getGlobalFactor() const {
+    return _global_factor;
+  }
+
+};
+
+#endif /* DETOURTABLE_HPP_ */
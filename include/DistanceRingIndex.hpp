@@ -0,0 +1,170 @@
+/****************************************************************
+ * DISTANCERINGINDEX.HPP
+ *
+ * This file contains the distance ring index used to sample
+ * destinations at a given distance from frequent source nodes.
+ *
+ * Authors: J. Barthelemy
+ * Date   : 27 september 2013
+ ****************************************************************/
+
+/*! \file DistanceRingIndex.hpp
+ *  \brief Index of the nodes sorted by distance from frequent source nodes.
+ */
+
+#ifndef DISTANCERINGINDEX_HPP_
+#define DISTANCERINGINDEX_HPP_
+
+#include <string>
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include "Network.hpp"
+
+//! \brief An index of the nodes sorted by distance from some source nodes.
+/*!
+  For an indexed source node, the index stores every node reachable within a
+  given radius (the largest distance that can be sampled for an activity),
+  sorted by distance from the source. A destination at a given distance
+  +/- epsilon is then drawn with two binary searches and a uniform pick,
+  instead of a Dijkstra search.
+
+  A source node is indexed on demand, once it has been used a given number of
+  times (houses and workplaces are the main candidates), as long as the memory
+  used by the index remains below its budget. The index can be saved to and
+  read from a binary file, so that the next simulations start with the rings
+  of the frequent sources.
+ */
+class DistanceRingIndex {
+
+private:
+
+  //! A node of a ring.
+  struct RingEntry {
+    float dist;    //!< distance from the source node
+    int   node;    //!< node index
+  };
+
+  float                                             _radius;     //!< largest distance covered by the rings
+  int                                               _min_uses;   //!< number of uses of a source node before it is indexed
+  size_t                                            _budget;     //!< maximum memory used by the rings (bytes)
+  size_t                                            _memory;     //!< memory currently used by the rings (bytes)
+  boost::unordered_map<int, std::vector<RingEntry> > _rings;      //!< rings by source node index
+  boost::unordered_map<int, int>                    _uses;       //!< number of uses of the source nodes not indexed yet
+  bool                                              _modified;   //!< true if rings have been added since the index was read
+  mutable boost::shared_mutex                       _mutex;      //!< lock of the index (rings are read concurrently, added exclusively)
+
+  //! Comparison used to find the first node farther than a distance.
+  static bool distBefore(float d, const RingEntry & e) {
+    return d < e.dist;
+  }
+
+  //! Comparison used to find the first node at least at a distance.
+  static bool distAfter(const RingEntry & e, float d) {
+    return e.dist < d;
+  }
+
+  //! Build the ring of a source node (the index must be locked exclusively).
+  /*!
+    Only the nodes of the largest strongly connected component of the network
+    are kept, unless none of them is reachable from the source.
+
+    \param network the network
+    \param source a source node index
+   */
+  void build(const Network & network, int source);
+
+  //! Draw a destination node in a ring.
+  /*!
+    \param g the routing graph
+    \param ring the ring of the source node
+    \param dist the desired distance (in meters)
+    \param rng a uniform random generator
+    \param dest the id of the destination node drawn
+
+    \return true if a destination has been drawn
+   */
+  bool sampleRing(const RoutingGraph & g, const std::vector<RingEntry> & ring, float dist, Ranq1 & rng, long & dest) const;
+
+public:
+
+  //! Constructor.
+  /*!
+    \param radius the largest distance covered by the rings
+    \param minUses the number of uses of a source node before it is indexed
+    \param budget the maximum memory used by the rings (in bytes)
+   */
+  DistanceRingIndex(float radius, int minUses, size_t budget);
+
+  //! Destructor.
+  virtual ~DistanceRingIndex() {};
+
+  //! Draw a destination node at a given distance from a source node.
+  /*!
+    Follows the same rule as Network::getDestFromSource(): a node is drawn
+    uniformly among the nodes at distance dist +/- epsilon from the source,
+    epsilon starting at 250 meters and being doubled until such a node exists.
+
+    May be called concurrently by several threads.
+
+    \param network the network
+    \param source the source node index
+    \param dist the desired distance (in meters)
+    \param rng a uniform random generator (owned by the calling thread)
+    \param dest the id of the destination node drawn
+
+    \return true if a destination has been drawn, false if the source is not indexed (yet) or the band exceeds the radius
+   */
+  bool sample(const Network & network, int source, float dist, Ranq1 & rng, long & dest);
+
+  //! Write the index to a binary file.
+  /*!
+    \param filename the path to the file
+    \param g the routing graph the index has been built on
+
+    \return true if the file has been written successfully
+   */
+  bool save(const std::string & filename, const RoutingGraph & g) const;
+
+  //! Read an index written by save().
+  /*!
+    The file is rejected if it has been built on another routing graph or for
+    another radius. Rings are read as long as the memory budget allows it.
+
+    \param filename the path to the file
+    \param g the routing graph
+
+    \return true if the index has been read successfully
+   */
+  bool load(const std::string & filename, const RoutingGraph & g);
+
+  //! Return the number of indexed source nodes.
+  /*!
+    \return a number of source nodes
+   */
+  int getNbRings() const {
+    boost::shared_lock<boost::shared_mutex> lock(_mutex);
+    return _rings.size();
+  }
+
+  //! Return the memory used by the rings.
+  /*!
+    \return a number of bytes
+   */
+  size_t getMemory() const {
+    boost::shared_lock<boost::shared_mutex> lock(_mutex);
+    return _memory;
+  }
+
+  //! Check whether rings have been added since the index was read.
+  /*!
+    \return true if the index should be saved
+   */
+  bool isModified() const {
+    boost::shared_lock<boost::shared_mutex> lock(_mutex);
+    return _modified;
+  }
+
+};
+
+#endif /* DISTANCERINGINDEX_HPP_ */
@@ -13,6 +13,9 @@
  *  \brief Fibonacci heap data structure implementation.
  */
 
+#ifndef FIBOHEAP_HPP_
+#define FIBOHEAP_HPP_
+
 #include <iostream>
 #include <algorithm>
 #include <vector>
@@ -442,3 +445,5 @@ public:
   }
 
 };
+
+#endif /* FIBOHEAP_HPP_ */
@@ -0,0 +1,147 @@
+/****************************************************************
+ * HUBLABELS.HPP
+ *
+ * This file contains the hub labels computed from the contraction
+ * hierarchy, used to answer the point to point distance queries on
+ * national-scale road networks.
+ *
+ * Authors: J. Barthelemy
+ * Date   : 17 october 2013
+ ****************************************************************/
+
+/*! \file HubLabels.hpp
+ *  \brief Hub labels of the routing graph (construction from a contraction hierarchy, compressed cache file and distance queries).
+ */
+
+#ifndef HUBLABELS_HPP_
+#define HUBLABELS_HPP_
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include "Network.hpp"
+
+class ContractionHierarchy;
+
+//! \brief The hub labels of a routing graph.
+/*!
+  Each node v has a forward label, i.e. a list of hubs h with the distance from
+  v to h, and a backward label with the distances from its hubs to v. The hubs
+  of a label are the nodes settled by the upward search of the contraction
+  hierarchy from the node, except the ones reached by a longer path than the
+  one found through another hub (pruning): for any nodes s and t, a node of a
+  shortest path from s to t is a hub of both the forward label of s and the
+  backward label of t. The distance between s and t is then the smallest sum of
+  distances over the hubs common to both labels, found by a merge of the two
+  labels sorted by hub.
+
+  The labels are computed from the most important nodes of the hierarchy to the
+  least important ones, level by level: the labels of a node are merged from the
+  labels of its upper neighbours, so the nodes of a level are processed in
+  parallel by several threads. The labels computed so far are saved to a
+  checkpoint file from time to time, from which an interrupted construction is
+  resumed.
+
+  A label is stored as its number of hubs followed by, for each hub in increasing
+  order, the difference with the previous hub (variable length integer, 7 bits by
+  byte) and the distance (float). The labels are written to a cache file, mapped
+  in memory when read (see MappedFile) so that its pages are shared by the
+  processes of a computing node.
+ */
+class HubLabels {
+
+private:
+
+  int                            _nb_nodes;       //!< number of nodes of the routing graph
+  ConstArray<unsigned long long> _fwd_offsets;    //!< first byte of the forward label of each node (size N+1)
+  ConstArray<unsigned long long> _bwd_offsets;    //!< first byte of the backward label of each node (size N+1)
+  ConstArray<unsigned char>      _fwd_bytes;      //!< compressed forward labels
+  ConstArray<unsigned char>      _bwd_bytes;      //!< compressed backward labels
+  unsigned long long             _nb_entries;     //!< number of hubs of all the labels
+  int                            _max_size;       //!< number of hubs of the largest label
+  unsigned long long             _checksum;       //!< checksum of the routing graph the labels have been built from
+
+public:
+
+  //! Constructor.
+  HubLabels() : _nb_nodes(0), _fwd_offsets(1, 0), _bwd_offsets(1, 0), _fwd_bytes(), _bwd_bytes(), _nb_entries(0), _max_size(0), _checksum(0) {};
+
+  //! Destructor.
+  virtual ~HubLabels() {};
+
+  //! Compute the labels from a contraction hierarchy.
+  /*!
+    \param ch the contraction hierarchy of the routing graph
+    \param nbThreads the number of threads computing the labels
+    \param checkpoint the path to the checkpoint file (resumed if it exists, removed once the labels are complete,
+                      no checkpoint if empty)
+   */
+  void build(const ContractionHierarchy & ch, int nbThreads, const std::string & checkpoint);
+
+  //! Write the labels to a cache file.
+  /*!
+    \param filename the path to the cache file
+
+    \return true if the file has been written successfully
+   */
+  bool save(const std::string & filename) const;
+
+  //! Read the labels from a cache file.
+  /*!
+    The file is rejected if it has not been written by the current version of
+    the model or if it has been built from another routing graph.
+
+    \param filename the path to the cache file
+    \param g the routing graph the labels must correspond to
+
+    \return true if the labels have been read successfully
+   */
+  bool load(const std::string & filename, const RoutingGraph & g);
+
+  //! Compute the distance between two nodes.
+  /*!
+    \param source the source node index
+    \param dest the destination node index
+
+    \return the distance between the nodes, the largest float if the destination is not reachable
+   */
+  float distance(int source, int dest) const;
+
+  //! Return the average number of hubs of a label.
+  /*!
+    \return a number of hubs
+   */
+  double getAverageSize() const {
+    return ( _nb_nodes > 0 ) ? (double) _nb_entries / (2.0 * _nb_nodes) : 0.0;
+  }
+
+  //! Return the number of hubs of the largest label.
+  /*!
+    \return a number of hubs
+   */
+  int getMaxSize() const {
+    return _max_size;
+  }
+
+  //! Return the size of the compressed labels.
+  /*!
+    \return a number of bytes
+   */
+  size_t getNbBytes() const {
+    return _fwd_bytes.size() + _bwd_bytes.size();
+  }
+
+  //! Write the statistics of the label sizes.
+  /*!
+    Writes the number of labels, the average and largest number of hubs by label,
+    the histogram of the label sizes (by power of two) and the size of the
+    compressed labels.
+
+    \param out the output stream
+    \param indent the prefix of each line
+   */
+  void writeStatistics(std::ostream & out, const std::string & indent) const;
+
+};
+
+#endif /* HUBLABELS_HPP_ */
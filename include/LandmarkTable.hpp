@@ -0,0 +1,124 @@
+/****************************************************************
+ * LANDMARKTABLE.HPP
+ *
+ * This file contains the landmark distance tables used by the
+ * goal-directed (A*, landmarks, triangle inequality) searches
+ * of the point to point distances on the road network.
+ *
+ * Authors: J. Barthelemy
+ * Date   : 14 october 2013
+ ****************************************************************/
+
+/*! \file LandmarkTable.hpp
+ *  \brief Landmark distance tables of the routing graph (selection, cache file and ALT distance queries).
+ */
+
+#ifndef LANDMARKTABLE_HPP_
+#define LANDMARKTABLE_HPP_
+
+#include <string>
+#include <vector>
+#include "Network.hpp"
+
+//! \brief The landmark distance tables of a routing graph (ALT algorithm).
+/*!
+  A few nodes of the routing graph, the landmarks, are chosen by the farthest
+  heuristic: each new landmark is the node farthest from the landmarks already
+  chosen. The distances from every landmark to every node, and from every node
+  to every landmark, are then stored node by node (the K distances of a node are
+  contiguous).
+
+  By the triangle inequality, for a landmark L and any nodes v and t,
+  d(v,t) >= d(L,t) - d(L,v) and d(v,t) >= d(v,L) - d(t,L). The largest of these
+  lower bounds is used as the potential of an A* search from the source to the
+  destination: the search is directed towards the destination and settles far
+  less nodes than a Dijkstra search, for a preprocessing limited to two Dijkstra
+  searches by landmark. The potential is consistent, hence the distances are
+  exact (up to the rounding of the sums of link lengths).
+
+  Landmarks not connected to the destination are ignored by a query, and the
+  nodes which are proven unable to reach the destination are not explored.
+  The tables are written to a cache file, mapped in memory when read (see
+  MappedFile) so that its pages are shared by the processes of a computing node.
+ */
+class LandmarkTable {
+
+private:
+
+  int                _nb_landmarks;  //!< number of landmarks (K)
+  int                _nb_requested;  //!< number of landmarks requested when the tables were built
+  int                _nb_nodes;      //!< number of nodes of the routing graph
+  ConstArray<int>    _landmarks;     //!< node index of each landmark
+  ConstArray<float>  _from;          //!< distance from each landmark to each node (K distances by node)
+  ConstArray<float>  _to;            //!< distance from each node to each landmark (K distances by node)
+  unsigned long long _checksum;      //!< checksum of the routing graph the tables have been built from
+
+public:
+
+  //! Constructor.
+  LandmarkTable() : _nb_landmarks(0), _nb_requested(0), _nb_nodes(0), _landmarks(), _from(), _to(), _checksum(0) {};
+
+  //! Destructor.
+  virtual ~LandmarkTable() {};
+
+  //! Select the landmarks of a routing graph and compute their distance tables.
+  /*!
+    \param g the routing graph
+    \param reverse the reverse of the routing graph
+    \param nbLandmarks the number of landmarks (at most 64, less may be found on a very small network)
+   */
+  void build(const RoutingGraph & g, const RoutingGraph & reverse, int nbLandmarks);
+
+  //! Write the tables to a cache file.
+  /*!
+    \param filename the path to the cache file
+
+    \return true if the file has been written successfully
+   */
+  bool save(const std::string & filename) const;
+
+  //! Read the tables from a cache file.
+  /*!
+    The file is rejected if it has not been written by the current version of
+    the model, if it has been built from another routing graph or for another
+    number of landmarks.
+
+    \param filename the path to the cache file
+    \param g the routing graph the tables must correspond to
+    \param nbLandmarks the number of landmarks
+
+    \return true if the tables have been read successfully
+   */
+  bool load(const std::string & filename, const RoutingGraph & g, int nbLandmarks);
+
+  //! Compute the distance between two nodes with an A* search.
+  /*!
+    \param g the routing graph the tables have been built from
+    \param source the source node index
+    \param dest the destination node index
+
+    \return the distance between the nodes, the largest float if the destination is not reachable
+   */
+  float distance(const RoutingGraph & g, int source, int dest) const;
+
+  //! Return the number of landmarks.
+  /*!
+    \return a number of landmarks
+   */
+  int getNbLandmarks() const {
+    return _nb_landmarks;
+  }
+
+  //! Return a landmark.
+  /*!
+    \param k the number of the landmark (0 to getNbLandmarks() - 1)
+
+    \return the node index of the landmark
+   */
+  int getLandmark(int k) const {
+    return _landmarks[k];
+  }
+
+};
+
+#endif /* LANDMARKTABLE_HPP_ */
@@ -0,0 +1,77 @@
+/****************************************************************
+ * MAPPEDFILE.HPP
+ *
+ * This file contains a read-only memory mapping of a file.
+ *
+ * Authors: J. Barthelemy
+ * Date   : 7 october 2013
+ ****************************************************************/
+
+/*! \file MappedFile.hpp
+ *  \brief Read-only memory mapping of a file.
+ */
+
+#ifndef MAPPEDFILE_HPP_
+#define MAPPEDFILE_HPP_
+
+#include <string>
+#include <cstddef>
+
+//! \brief A file mapped in memory (read-only).
+/*!
+  The pages of the file are loaded on demand by the operating system and are
+  shared through the page cache by every process mapping the same file (e.g.
+  the MPI ranks running on the same node). The mapping is released when the
+  object is destroyed, hence the object cannot be copied.
+ */
+class MappedFile {
+
+private:
+
+  const char * _data;    //!< first byte of the mapping (NULL if the file could not be mapped)
+  size_t       _size;    //!< size of the file (bytes)
+
+  //! Copy constructor (disabled).
+  MappedFile(const MappedFile &);
+
+  //! Assignment operator (disabled).
+  MappedFile & operator=(const MappedFile &);
+
+public:
+
+  //! Constructor, mapping a file.
+  /*!
+    \param filename the path to the file
+   */
+  MappedFile(const std::string & filename);
+
+  //! Destructor, releasing the mapping.
+  virtual ~MappedFile();
+
+  //! Check whether the file has been mapped.
+  /*!
+    \return true if the file has been mapped successfully
+   */
+  bool isOpen() const {
+    return _data != NULL;
+  }
+
+  //! Return the first byte of the mapping.
+  /*!
+    \return a pointer to the content of the file
+   */
+  const char * getData() const {
+    return _data;
+  }
+
+  //! Return the size of the file.
+  /*!
+    \return a number of bytes
+   */
+  size_t getSize() const {
+    return _size;
+  }
+
+};
+
+#endif /* MAPPEDFILE_HPP_ */
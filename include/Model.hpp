@@ -18,6 +18,7 @@
 #include "Individual.hpp"
 #include "Household.hpp"
 #include "Data.hpp"
+#include "ShortestPathTree.hpp"
 #include "tinyxml2.hpp"
 
 #include "repast_hpc/SharedContext.h"
@@ -16,14 +16,19 @@
 
 #include <map>
 #include <vector>
+#include <string>
 #include <iostream>
 #include <functional>
 #include <limits>
 #include <utility>
 #include <sstream>
 #include <set>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/tss.hpp>
 #include "Random.hpp"
-#include "FiboHeap.hpp"
+#include "PriorityQueue.hpp"
 
 //! A node class.
 /*!
@@ -474,10 +479,627 @@ public:
 
 };
 
+//! A read-only array whose elements are either owned or stored in an external memory block.
+/*!
+  The arrays of the routing graph are usually built in memory, but they may also
+  directly refer to a block they do not own (e.g. a memory mapped network file,
+  see MappedFile), in which case the array keeps the owner of the block alive.
+  Copying an array never copies external elements.
+ */
+template <typename T> class ConstArray {
+
+private:
+
+  std::vector<T>                 _data;    //!< owned elements (empty when viewing an external block)
+  const T *                      _begin;   //!< first element
+  size_t                         _size;    //!< number of elements
+  boost::shared_ptr<const void>  _owner;   //!< owner of the external block (NULL if the elements are owned)
+
+public:
+
+  //! Constructor (empty array).
+  ConstArray() : _data(), _begin(NULL), _size(0), _owner() {};
+
+  //! Constructor owning a copy of some elements.
+  /*!
+    \param n number of elements
+    \param value value of the elements
+   */
+  ConstArray(size_t n, const T & value) : _data(n, value), _begin(NULL), _size(n), _owner() {
+    if (_size > 0) _begin = &_data[0];
+  };
+
+  //! Copy constructor.
+  ConstArray(const ConstArray<T> & a) : _data(a._data), _begin(a._begin), _size(a._size), _owner(a._owner) {
+    if (!_owner) _begin = _data.empty() ? NULL : &_data[0];
+  };
+
+  //! Assignment operator.
+  ConstArray<T> & operator=(const ConstArray<T> & a) {
+    _data  = a._data;
+    _begin = a._begin;
+    _size  = a._size;
+    _owner = a._owner;
+    if (!_owner) _begin = _data.empty() ? NULL : &_data[0];
+    return *this;
+  }
+
+  //! Destructor.
+  virtual ~ConstArray() {};
+
+  //! Take the elements of a vector (the vector is left empty).
+  /*!
+    \param v a vector of elements
+   */
+  void take(std::vector<T> & v) {
+    _data.swap(v);
+    v.clear();
+    _begin = _data.empty() ? NULL : &_data[0];
+    _size  = _data.size();
+    _owner.reset();
+  }
+
+  //! Refer to elements stored in an external memory block.
+  /*!
+    \param begin the first element
+    \param size the number of elements
+    \param owner the owner of the memory block, kept alive as long as the array refers to it
+   */
+  void view(const T * begin, size_t size, const boost::shared_ptr<const void> & owner) {
+    std::vector<T>().swap(_data);
+    _begin = begin;
+    _size  = size;
+    _owner = owner;
+  }
+
+  //! Return the number of elements.
+  size_t size() const {
+    return _size;
+  }
+
+  //! Check whether the array is empty.
+  bool empty() const {
+    return _size == 0;
+  }
+
+  //! Return an element.
+  const T & operator[](size_t i) const {
+    return _begin[i];
+  }
+
+  //! Return the last element.
+  const T & back() const {
+    return _begin[_size - 1];
+  }
+
+  //! Return a pointer to the first element.
+  const T * begin() const {
+    return _begin;
+  }
+
+  //! Return a pointer following the last element.
+  const T * end() const {
+    return _begin + _size;
+  }
+
+};
+
+//! Append an array to a memory image, padded to a multiple of 8 bytes.
+/*!
+  The arrays of an image (e.g. a binary network file) are aligned on 8 bytes, so
+  that they can be used in place once the image is mapped in memory (see
+  locateArray()).
+
+  \param image the memory image
+  \param data the first element of the array
+  \param n the number of elements
+ */
+template <typename T> void appendArray(std::vector<char> & image, const T * data, size_t n) {
+
+  size_t size = n * sizeof(T);
+  if (size > 0) image.insert(image.end(), (const char *) data, (const char *) data + size);
+  image.resize(image.size() + (8 - size % 8) % 8, 0);
+
+}
+
+//! Locate an array in a memory image written by appendArray().
+/*!
+  \param image the first byte of the image
+  \param size the size of the image
+  \param pos the position of the array in the image, moved to the next array
+  \param n the number of elements
+
+  \return the first element of the array, NULL if the image is too short
+ */
+template <typename T> const T * locateArray(const char * image, size_t size, size_t & pos, size_t n) {
+
+  const T * data = (const T *) (image + pos);
+  pos += n * sizeof(T) + (8 - (n * sizeof(T)) % 8) % 8;
+  return ( pos <= size ) ? data : NULL;
+
+}
+
+//! A compressed sparse row (CSR) representation of the road network used for routing.
+/*!
+  The nodes of the network are densely indexed from 0 to N-1 and their outgoing
+  links are stored contiguously: the links leaving the node of index i are the
+  entries [offset(i), offset(i+1)) of the target and length arrays. The original
+  node ids (as found in the network XML file) are kept in a translation table.
+
+  The dense index of a node is initially its rank in the increasing order of the
+  node ids, but the nodes may be reordered to improve the memory locality of the
+  searches (see Network::reorder()). In that case a translation table holds the
+  node ids in increasing order with their index. Either way, the translation
+  from an id to an index is a binary search.
+ */
+class RoutingGraph {
+
+private:
+
+  ConstArray<int>   _offsets;                                     //!< first outgoing link of each node (size N+1)
+  ConstArray<int>   _targets;                                     //!< sink node index of each link (size M)
+  ConstArray<float> _lengths;                                     //!< length of each link, in meters (size M)
+  ConstArray<long>  _ids;                                         //!< original id of each node (size N)
+  ConstArray<long>  _sorted_ids;                                  //!< node ids in increasing order (size N, empty if _ids is increasing)
+  ConstArray<int>   _sorted_index;                                //!< index of each node of _sorted_ids (size N, empty if _ids is increasing)
+  float             _min_length;                                  //!< length of the shortest link with a positive length
+  float             _max_length;                                  //!< length of the longest link
+  unsigned long long _checksum;                                   //!< checksum of the arrays (see getChecksum())
+
+  //! Compute the bounds of the link lengths.
+  void computeLengthBounds();
+
+  //! Compute the checksum of the arrays.
+  void computeChecksum();
+
+  //! Compute the translation table of the node ids (left empty if the ids are increasing).
+  void computeIdTable();
+
+public:
+
+  //! Constructor.
+  RoutingGraph() : _offsets(1, 0), _targets(), _lengths(), _ids(), _sorted_ids(), _sorted_index(), _min_length(0.0), _max_length(0.0), _checksum(0) {
+    computeChecksum();
+  };
+
+  //! Destructor.
+  virtual ~RoutingGraph() {};
+
+  //! Build the CSR arrays from the nodes and links of a network.
+  /*!
+    Links whose source or sink node is unknown are ignored.
+
+    \param nodes the network's map <nodes id, nodes>
+    \param links the network's map <links id, links>
+   */
+  void build(const std::map<long, Node> & nodes, const std::map<long, Link> & links);
+
+  //! Build the CSR arrays from a list of arcs.
+  /*!
+    \param ids the original id of each node
+    \param sources the source node index of each arc
+    \param targets the sink node index of each arc
+    \param lengths the length of each arc
+   */
+  void build(const std::vector<long> & ids, const std::vector<int> & sources,
+             const std::vector<int> & targets, const std::vector<float> & lengths);
+
+  //! Build the reverse of a graph (same nodes, links with swapped ends).
+  /*!
+    \param g a routing graph
+   */
+  void buildReverse(const RoutingGraph & g);
+
+  //! Refer to CSR arrays stored in an external memory block (e.g. a network file mapped in memory).
+  /*!
+    The arrays are neither copied nor checked: they must follow the layout of
+    the arrays built by build().
+
+    \param n the number of nodes
+    \param ids the original id of each node (size n)
+    \param sortedIds the node ids in increasing order (size n, NULL if ids is increasing)
+    \param sortedIndex the index of each node of sortedIds (size n, NULL if ids is increasing)
+    \param offsets the first outgoing link of each node (size n+1)
+    \param targets the sink node index of each link (size offsets[n])
+    \param lengths the length of each link (size offsets[n])
+    \param minLength the length of the shortest link with a positive length
+    \param maxLength the length of the longest link
+    \param checksum the checksum of the arrays (see getChecksum())
+    \param owner the owner of the memory block, kept alive as long as the graph refers to it
+   */
+  void view(int n, const long * ids, const long * sortedIds, const int * sortedIndex, const int * offsets, const int * targets, const float * lengths,
+            float minLength, float maxLength, unsigned long long checksum, const boost::shared_ptr<const void> & owner);
+
+  //! Return a checksum of the graph (used to check that cached data derived from the graph are up to date).
+  /*!
+    The checksum is computed once, when the graph is built or read.
+
+    \return a 64 bits FNV-1a hash of the CSR arrays and ids
+   */
+  unsigned long long getChecksum() const {
+    return _checksum;
+  }
+
+  //! Write the graph in binary format.
+  /*!
+    \param out an output stream opened in binary mode
+   */
+  void write(std::ostream & out) const;
+
+  //! Read a graph written by write().
+  /*!
+    \param in an input stream opened in binary mode
+
+    \return true if the graph has been read successfully
+   */
+  bool read(std::istream & in);
+
+  //! Return the number of nodes of the graph.
+  /*!
+    \return the number of nodes
+   */
+  int getNbNodes() const {
+    return _ids.size();
+  }
+
+  //! Return the number of links of the graph.
+  /*!
+    \return the number of links
+   */
+  int getNbLinks() const {
+    return _targets.size();
+  }
+
+  //! Return the dense index of a node.
+  /*!
+    \param id a node id
+
+    \return the index of the node, -1 if the node does not belong to the graph
+   */
+  int getIndex(long id) const;
+
+  //! Check whether the nodes are indexed by increasing id.
+  /*!
+    \return true if the translation table of the node ids is empty
+   */
+  bool hasIncreasingIds() const {
+    return _sorted_ids.empty();
+  }
+
+  //! Return the node ids in increasing order (translation table).
+  /*!
+    \return the sorted ids, empty if the nodes are indexed by increasing id
+   */
+  const ConstArray<long>& getSortedIds() const {
+    return _sorted_ids;
+  }
+
+  //! Return the index of the nodes in increasing id order (translation table).
+  /*!
+    \return the index of each node of getSortedIds(), empty if the nodes are indexed by increasing id
+   */
+  const ConstArray<int>& getSortedIndex() const {
+    return _sorted_index;
+  }
+
+  //! Return the original id of a node.
+  /*!
+    \param index a node index
+
+    \return the node id
+   */
+  long getId(int index) const {
+    return _ids[index];
+  }
+
+  //! Return the position of the first outgoing link of a node.
+  /*!
+    \param index a node index
+
+    \return the position of the first link in the target and length arrays
+   */
+  int beginOut(int index) const {
+    return _offsets[index];
+  }
+
+  //! Return the position following the last outgoing link of a node.
+  /*!
+    \param index a node index
+
+    \return the position following the last link in the target and length arrays
+   */
+  int endOut(int index) const {
+    return _offsets[index + 1];
+  }
+
+  //! Return the sink node's index of a link.
+  /*!
+    \param pos a link position
+
+    \return a node index
+   */
+  int getTarget(int pos) const {
+    return _targets[pos];
+  }
+
+  //! Return the length of a link.
+  /*!
+    \param pos a link position
+
+    \return the length of the link (unit: meters)
+   */
+  float getLength(int pos) const {
+    return _lengths[pos];
+  }
+
+  //! Return the length of the shortest link with a positive length.
+  /*!
+    \return a length (unit: meters)
+   */
+  float getMinLength() const {
+    return _min_length;
+  }
+
+  //! Return the length of the longest link.
+  /*!
+    \return a length (unit: meters)
+   */
+  float getMaxLength() const {
+    return _max_length;
+  }
+
+};
+
+
+//! A reusable workspace for the shortest path searches on a routing graph.
+/*!
+  Instead of preloading every node of the network in a priority queue, a search
+  only touches the nodes it actually reaches: the tentative distances and the
+  settled flags are stored in arrays indexed by node and stamped with the
+  generation (i.e. the search number) that wrote them, so that starting a new
+  search only requires incrementing the generation. The priority queue (see
+  PriorityQueue.hpp for the available backends) only holds reached nodes; a node
+  may be pushed several times and outdated entries are skipped when popped.
+
+  The setup cost of a search is then proportional to the number of nodes reached,
+  not to the size of the network. Each thread should use its own workspace (see
+  local()).
+ */
+template <class Queue> class DijkstraWorkspace {
+
+private:
+
+  std::vector<float>        _dist;        //!< tentative distance of each node from the source
+  std::vector<unsigned int> _reached;     //!< generation at which the distance of each node was set
+  std::vector<unsigned int> _settled;     //!< generation at which each node was settled
+  unsigned int              _generation;  //!< number of the current search
+  Queue                     _queue;       //!< priority queue of the reached nodes
+  std::vector<int>          _order;       //!< nodes settled by the current search, by increasing distance
+  const RoutingGraph *      _graph;       //!< graph of the previous search
+
+public:
+
+  //! Constructor.
+  DijkstraWorkspace() : _dist(), _reached(), _settled(), _generation(0), _queue(), _order(), _graph(NULL) {};
+
+  //! Destructor.
+  virtual ~DijkstraWorkspace() {};
+
+  //! Return a workspace of the calling thread.
+  /*!
+    Searches needing several simultaneous workspaces (e.g. bidirectional searches)
+    use distinct slots.
+
+    \param slot the number of the workspace (0 to 3)
+
+    \return a workspace owned by the calling thread
+   */
+  static DijkstraWorkspace<Queue> & local(int slot = 0) {
+
+    static __thread DijkstraWorkspace<Queue> * workspaces[4];            // workspaces of the thread, allocated at first use...
+    static boost::thread_specific_ptr< DijkstraWorkspace<Queue> > owners[4];  // ... and freed when it exits
+    if (workspaces[slot] == NULL) {
+      owners[slot].reset(new DijkstraWorkspace<Queue>());
+      workspaces[slot] = owners[slot].get();
+    }
+    return *workspaces[slot];
+
+  }
+
+  //! Start a new search on a graph.
+  /*!
+    \param g the routing graph
+   */
+  void init(const RoutingGraph & g) {
+
+    int n = g.getNbNodes();
+
+    // (re)allocating the arrays if the graph is larger than the previous one
+    if ( (int) _dist.size() < n ) {
+      _dist.resize(n, 0.0);
+      _reached.resize(n, 0);
+      _settled.resize(n, 0);
+    }
+
+    // new generation: every node is unreached and unsettled
+    _generation++;
+    if ( _generation == 0 ) {          // overflow of the generation counter
+      std::fill(_reached.begin(), _reached.end(), 0);
+      std::fill(_settled.begin(), _settled.end(), 0);
+      _generation = 1;
+    }
+
+    if ( _graph != &g ) {
+      _queue.setup(g.getMinLength(), g.getMaxLength());
+      _graph = &g;
+    }
+    _queue.clear();
+    _order.clear();
+
+  }
+
+  //! Return the tentative distance of a node.
+  /*!
+    \param v a node index
+
+    \return the distance of the node from the source, the largest float if not reached yet
+   */
+  float getDist(int v) const {
+    return ( _reached[v] == _generation ) ? _dist[v] : std::numeric_limits<float>::max();
+  }
+
+  //! Check if a node is settled.
+  /*!
+    \param v a node index
+
+    \return true if the shortest distance from the source to the node is known
+   */
+  bool isSettled(int v) const {
+    return _settled[v] == _generation;
+  }
+
+  //! Update the tentative distance of a node and push it in the queue if it decreases.
+  /*!
+    \param v a node index
+    \param d a new distance from the source
+
+    \return true if the distance has been decreased
+   */
+  bool relax(int v, float d) {
+    if ( d < getDist(v) ) {
+      _dist[v]    = d;
+      _reached[v] = _generation;
+      _queue.push(v, d);
+      return true;
+    }
+    return false;
+  }
+
+  //! Update the tentative distance of a node and push it in the queue with a given key if it decreases.
+  /*!
+    Used by goal-directed searches, in which the nodes are settled by increasing
+    key (e.g. distance from the source plus a lower bound of the distance to the
+    destination) instead of increasing distance. The queue must then accept
+    non monotone keys (see BinaryHeapQueue).
+
+    \param v a node index
+    \param d a new distance from the source
+    \param key the priority of the node
+
+    \return true if the distance has been decreased
+   */
+  bool relax(int v, float d, float key) {
+    if ( d < getDist(v) ) {
+      _dist[v]    = d;
+      _reached[v] = _generation;
+      _queue.push(v, key);
+      return true;
+    }
+    return false;
+  }
+
+  //! Return the nodes settled by the current search.
+  /*!
+    \return the settled node indices, by increasing distance from the source
+   */
+  const std::vector<int>& getSettledOrder() const {
+    return _order;
+  }
+
+  //! Remove the outdated entries at the top of the queue.
+  /*!
+    \return true if the queue still contains an unsettled node
+   */
+  bool hasNext() {
+    while ( !_queue.empty() && isSettled(_queue.top()) ) _queue.pop();
+    return !_queue.empty();
+  }
+
+  //! Return the distance of the unsettled node closest to the source (hasNext() must be true).
+  /*!
+    \return a distance
+   */
+  float nextDist() {
+    return _queue.topKey();
+  }
+
+  //! Remove the unsettled node closest to the source from the queue and settle it (hasNext() must be true).
+  /*!
+    \return a node index
+   */
+  int next() {
+    int v = _queue.top();
+    _queue.pop();
+    _settled[v] = _generation;
+    _order.push_back(v);
+    return v;
+  }
+
+};
+
+
+//! Orders of the nodes in the routing graph (see Network::reorder()).
+enum NodeOrder {
+  ORDER_ID,        //!< increasing node id (order of the network file)
+  ORDER_BFS,       //!< breadth first search order
+  ORDER_HILBERT    //!< position of the node on a Hilbert curve covering the bounding box of the network
+};
+
+//! Return the node order corresponding to its name.
+/*!
+  \param aName the name of the order (id, bfs or hilbert)
+  \param aDefault the order returned if the name is unknown
+
+  \return a node order
+ */
+inline NodeOrder nodeOrderFromString(const std::string & aName, NodeOrder aDefault) {
+
+  if      ( aName == "id"      ) return ORDER_ID;
+  else if ( aName == "bfs"     ) return ORDER_BFS;
+  else if ( aName == "hilbert" ) return ORDER_HILBERT;
+  return aDefault;
+
+}
+
+//! Return the name of a node order.
+/*!
+  \param aOrder a node order
+
+  \return the name of the order
+ */
+inline std::string nodeOrderToString(NodeOrder aOrder) {
+
+  switch (aOrder) {
+    case ORDER_ID      : return "id";
+    case ORDER_BFS     : return "bfs";
+    case ORDER_HILBERT : return "hilbert";
+  }
+  return "unknown";
+
+}
+
+class ChainContraction;
+class ContractionHierarchy;
+class DistanceRingIndex;
+class HubLabels;
+class LandmarkTable;
+class SpatialGrid;
+
 //! A Network class.
 /*!
   This class implements a network consisting of a set of nodes and links.
   Refers to the Node and Link class for more informations.
+
+  The maps of nodes and links are the reference description of the network, while
+  the shortest path computations are performed on a CSR copy of the network (see
+  the RoutingGraph class) which has to be built once all the nodes and links are
+  added (see buildGraph()).
+
+  A network can also be read from a binary network file (see writeBinary() and
+  readBinary()), which holds the routing graphs and the coordinates and ins codes
+  of the nodes. The file is mapped in memory instead of being parsed, and the maps
+  of nodes and links are left empty: the nodes' attributes are then only available
+  through getNodeX(), getNodeY() and getNodeIns().
  */
 class Network {
 
@@ -485,17 +1107,78 @@ private:
 
   std::map<long, Node> _Nodes;                                    //!< Nodes of the network (see Node class)
   std::map<long, Link> _Links;                                    //!< Links of the network (see Link class)
+  RoutingGraph         _graph;                                    //!< CSR graph used by the shortest path algorithms
+  RoutingGraph         _reverse_graph;                            //!< reverse of the CSR graph (searches towards a node)
+  QueueType            _queue_type;                               //!< priority queue backend used by the searches
+  NodeOrder            _node_order;                               //!< order of the nodes in the routing graph
+  bool                 _bidirectional;                            //!< true if the point to point searches are bidirectional
+  boost::shared_ptr<const ContractionHierarchy> _ch;              //!< contraction hierarchy answering the distance queries (if any)
+  boost::shared_ptr<const HubLabels>            _hub_labels;      //!< hub labels answering the distance queries (if any)
+  boost::shared_ptr<DistanceRingIndex>          _rings;           //!< distance ring index answering the destination queries (if any)
+  boost::shared_ptr<const LandmarkTable>        _landmarks;       //!< landmark distance tables directing the point to point searches (if any)
+  boost::shared_ptr<const ChainContraction>     _chains;          //!< routing graph with contracted chains of shape nodes, used by the Dijkstra searches (if any)
+  boost::shared_ptr<const SpatialGrid>          _grid;            //!< spatial index of the nodes (if any)
+  ConstArray<double>   _x;                                        //!< x coordinate of each node, by routing graph index
+  ConstArray<double>   _y;                                        //!< y coordinate of each node, by routing graph index
+  ConstArray<int>      _ins;                                      //!< ins code of each node, by routing graph index
+  ConstArray<int>      _scc;                                      //!< strongly connected component of each node, by routing graph index (see labelComponents())
+  ConstArray<int>      _wcc;                                      //!< weakly connected component of each node, by routing graph index
+  int                  _nb_scc;                                   //!< number of strongly connected components
+  int                  _largest_scc;                              //!< label of the largest strongly connected component (-1 if not labelled)
+  int                  _largest_scc_size;                         //!< number of nodes of the largest strongly connected component
 
   double min_x;                                                   //!< Minimum x coordinate
   double max_x;                                                   //!< Maximum x coordinate
   double min_y;                                                   //!< Minimum y coordinate
   double max_y;                                                   //!< Maximum y coordinate
 
+  //! Draw a destination at a given distance among the nodes of the spatial grid close enough to the source (see getDestFromSource()).
+  bool sampleGrid(int source, float dist, Ranq1 & rng, long & dest) const;
+
+  //! Dijkstra search of a destination at a given distance (see getDestFromSource()).
+  template <class Queue> long destFromSource(int source, float dist, Ranq1 & rng) const;
+
+  //! Dijkstra search of a destination at a given distance on the graph with contracted chains (see getDestFromSource()).
+  template <class Queue> long destFromSourceChains(int source, float dist, Ranq1 & rng) const;
+
+  //! Single Dijkstra search answering a group of destination requests sharing their source node (see getDestsFromSources()).
+  template <class Queue> void destsFromSource(int source, const std::vector<float> & dists, const std::vector<int> & requests,
+                                              std::vector<long> & dests, Ranq1 & rng) const;
+
+  //! Dijkstra search of the distance between two nodes (see getDistanceNodes()).
+  template <class Queue> float distanceNodes(int source, int dest) const;
+
+  //! Dijkstra search of the distance between two nodes on the graph with contracted chains (see getDistanceNodes()).
+  template <class Queue> float distanceNodesChains(int source, int dest) const;
+
+  //! Bidirectional Dijkstra search of the distance between two nodes (see getDistanceNodesBidirectional()).
+  template <class Queue> float distanceNodesBidirectional(int source, int dest) const;
+
+  //! Dijkstra search of the distances between a node and a set of nodes in a graph (see getDistancesFromSource() and getDistancesToDest()).
+  template <class Queue> void distancesFrom(const RoutingGraph & g, bool reverse, int source, const std::vector<int> & dests, std::vector<float> & result) const;
+
+  //! Remove the labels of the components (e.g. when a new routing graph is built or read).
+  void clearComponents();
+
+  //! Return the number of nodes settled by the last Dijkstra search of the calling thread (with the selected queue backend).
+  int getNbSettled() const;
+
+  //! Check whether a node may reach another one (see mayReach()).
+  bool mayReachIndex(int source, int dest) const {
+    return _scc.empty() || ( _wcc[source] == _wcc[dest] && _scc[source] >= _scc[dest] );
+  }
+
 public:
 
   //! Constructor.
   Network() {
 
+    _queue_type = QUEUE_RADIX;
+    _node_order = ORDER_ID;
+    _bidirectional = false;
+    _nb_scc = 0;
+    _largest_scc = -1;
+    _largest_scc_size = 0;
     min_x = 0.0;
     max_x = 0.0;
     min_y = 0.0;
@@ -524,6 +1207,8 @@ public:
 
   //! Return the network's nodes.
   /*!
+    The map is empty if the network has been read from a binary network file.
+
     \return the networks's map <nodes id, nodes>
    */
   const std::map<long, Node>& getNodes() const {
@@ -559,31 +1244,594 @@ public:
    */
   void addLink(Link aLink);
 
+  //! Build the routing graph from the current set of nodes and links.
+  /*!
+    Must be called once the network is loaded and before any shortest path computation.
+   */
+  void buildGraph();
+
+  //! Read the network from a XML file and build its routing graph.
+  /*!
+    The file lists the nodes (id, x, y) and the links (id, start node, end node,
+    length) of the network, e.g.
+    \code
+    <network>
+      <nodes> <node id="1" x="150000.0" y="160000.0"/> ... </nodes>
+      <links> <link id="1" from="1" to="2" length="120.5"/> ... </links>
+    </network>
+    \endcode
+    The attributes are read by position.
+
+    \param filename the path to the XML file
+    \param nodeIns the ins code of the nodes (nodes not found are given the code 0)
+
+    \return true if the file has been read successfully
+   */
+  bool readXml(const std::string & filename, const std::map<long, int> & nodeIns);
+
+  //! Write the network in a binary network file (see the vbel-netconvert tool).
+  /*!
+    The file contains the CSR arrays of the routing graph and of its reverse,
+    the coordinates and ins codes of the nodes and the bounding box of the
+    network, each array being aligned on 8 bytes so that it can be used in place
+    once the file is mapped in memory.
+
+    \param filename the path to the file
+
+    \return true if the file has been written successfully
+   */
+  bool writeBinary(const std::string & filename) const;
+
+  //! Append the binary image of the network (i.e. the content of a binary network file) to a memory block.
+  /*!
+    \param image the memory block
+   */
+  void writeBinary(std::vector<char> & image) const;
+
+  //! Read a network written by writeBinary().
+  /*!
+    The file is mapped in memory (see MappedFile) and the routing graphs refer
+    directly to its content: reading is almost instantaneous and the pages of the
+    file are shared by the processes of a computing node. The file is rejected if
+    its format version differs or if it is truncated.
+
+    \param filename the path to the file
+
+    \return true if the file has been read successfully
+   */
+  bool readBinary(const std::string & filename);
+
+  //! Read the binary image of a network stored in a memory block (e.g. a shared memory segment).
+  /*!
+    As for a mapped file, the routing graphs directly refer to the memory block.
+
+    \param image the first byte of the memory block (aligned on 8 bytes)
+    \param size the size of the memory block
+    \param owner the owner of the memory block, kept alive as long as the network refers to it
+
+    \return true if the image has been read successfully
+   */
+  bool readBinary(const char * image, size_t size, const boost::shared_ptr<const void> & owner);
+
+  //! Return the number of nodes of the network.
+  /*!
+    \return the number of nodes of the routing graph
+   */
+  int getNbNodes() const {
+    return _graph.getNbNodes();
+  }
+
+  //! Return the number of links of the network.
+  /*!
+    \return the number of links of the routing graph
+   */
+  int getNbLinks() const {
+    return _graph.getNbLinks();
+  }
+
+  //! Reorder the nodes of the routing graph.
+  /*!
+    The searches access the arrays of the routing graph by node index: numbering
+    close nodes with close indices keeps the nodes settled by a search in a few
+    cache lines and memory pages. Every array indexed by node (routing graphs,
+    coordinates, ins codes, components) is permuted and the translation table of
+    the node ids is updated (see RoutingGraph). The contraction hierarchy, the
+    hub labels, the landmark tables, the distance ring index, the contracted
+    chains and the spatial grid refer to node indices, hence they are removed and
+    must be set again.
+
+    \param order the new order of the nodes
+   */
+  void reorder(NodeOrder order);
+
+  //! Return the order of the nodes in the routing graph.
+  /*!
+    \return a node order
+   */
+  NodeOrder getNodeOrder() const {
+    return _node_order;
+  }
+
+  //! Label the strongly and weakly connected components of the routing graph.
+  /*!
+    Must be called once the routing graph is built or read. The strongly
+    connected components are numbered by Tarjan's algorithm, which completes a
+    component after every component reachable from it: a node can only reach the
+    nodes of its weakly connected component whose strongly connected component
+    has a lower or equal number. Distance queries between nodes failing this
+    test are answered at once (see mayReach()), and the destinations are drawn
+    in the largest strongly connected component, from which every node of the
+    component can go back home (see getDestFromSource()).
+   */
+  void labelComponents();
+
+  //! Return the number of strongly connected components of the routing graph.
+  /*!
+    \return a number of components, 0 if the components have not been labelled
+   */
+  int getNbComponents() const {
+    return _nb_scc;
+  }
+
+  //! Return the size of the largest strongly connected component of the routing graph.
+  /*!
+    \return a number of nodes, 0 if the components have not been labelled
+   */
+  int getLargestComponentSize() const {
+    return _largest_scc_size;
+  }
+
+  //! Check whether a node belongs to the largest strongly connected component of the routing graph.
+  /*!
+    \param node_id a node id
+
+    \return true if the node belongs to the largest component (or if the components have not been labelled)
+   */
+  bool isInLargestComponent(long node_id) const;
+
+  //! Check whether a node belongs to the largest strongly connected component of the routing graph.
+  /*!
+    \param i a node index in the routing graph
+
+    \return true if the node belongs to the largest component (or if the components have not been labelled)
+   */
+  bool isInLargestComponentIndex(int i) const {
+    return _scc.empty() || _scc[i] == _largest_scc;
+  }
+
+  //! Check whether a node may reach another node (constant time).
+  /*!
+    \param source_id source node
+    \param dest_id destination node
+
+    \return false if the destination is not reachable from the source, true if it may be (always true if the components have not been labelled)
+   */
+  bool mayReach(long source_id, long dest_id) const;
+
+  //! Return the x coordinate of a node.
+  /*!
+    \param node_id a node id
+
+    \return the x coordinate of the node
+   */
+  double getNodeX(long node_id) const;
+
+  //! Return the y coordinate of a node.
+  /*!
+    \param node_id a node id
+
+    \return the y coordinate of the node
+   */
+  double getNodeY(long node_id) const;
+
+  //! Return the ins code of a node (corresponding to the municipality to which the node belongs).
+  /*!
+    \param node_id a node id
+
+    \return the ins code of the node
+   */
+  int getNodeIns(long node_id) const;
+
+  //! Return the x coordinate of a node.
+  /*!
+    \param i a node index in the routing graph
+
+    \return the x coordinate of the node
+   */
+  double getNodeXIndex(int i) const {
+    return _x[i];
+  }
+
+  //! Return the y coordinate of a node.
+  /*!
+    \param i a node index in the routing graph
+
+    \return the y coordinate of the node
+   */
+  double getNodeYIndex(int i) const {
+    return _y[i];
+  }
+
+  //! Return the ins code of a node.
+  /*!
+    \param i a node index in the routing graph
+
+    \return the ins code of the node
+   */
+  int getNodeInsIndex(int i) const {
+    return _ins[i];
+  }
+
+  //! Return the routing graph.
+  /*!
+    \return the CSR graph of the network
+   */
+  const RoutingGraph& getGraph() const {
+    return _graph;
+  }
+
+  //! Return the reverse routing graph.
+  /*!
+    \return the CSR graph of the network with reversed links
+   */
+  const RoutingGraph& getReverseGraph() const {
+    return _reverse_graph;
+  }
+
+  //! Return the priority queue backend used by the searches.
+  /*!
+    \return a queue backend
+   */
+  QueueType getQueueType() const {
+    return _queue_type;
+  }
+
+  //! Set the priority queue backend used by the searches.
+  /*!
+    \param queueType a queue backend
+   */
+  void setQueueType(QueueType queueType) {
+    _queue_type = queueType;
+  }
+
+  //! Check whether the point to point searches are bidirectional.
+  /*!
+    \return true if getDistanceNodes() runs bidirectional searches
+   */
+  bool isBidirectional() const {
+    return _bidirectional;
+  }
+
+  //! Set whether the point to point searches are bidirectional.
+  /*!
+    \param bidirectional true to run bidirectional searches (see getDistanceNodesBidirectional())
+   */
+  void setBidirectional(bool bidirectional) {
+    _bidirectional = bidirectional;
+  }
+
+  //! Return the contraction hierarchy of the network.
+  /*!
+    \return the contraction hierarchy used by getDistanceNodes(), NULL if none
+   */
+  const boost::shared_ptr<const ContractionHierarchy>& getContractionHierarchy() const {
+    return _ch;
+  }
+
+  //! Set the contraction hierarchy of the network.
+  /*!
+    The hierarchy must have been built from the routing graph of the network
+    (see buildGraph()). It is shared by the copies of the network.
+
+    \param ch a contraction hierarchy, NULL to use Dijkstra searches
+   */
+  void setContractionHierarchy(const boost::shared_ptr<const ContractionHierarchy>& ch) {
+    _ch = ch;
+  }
+
+  //! Return the hub labels of the network.
+  /*!
+    \return the hub labels used by getDistanceNodes(), NULL if none
+   */
+  const boost::shared_ptr<const HubLabels>& getHubLabels() const {
+    return _hub_labels;
+  }
+
+  //! Set the hub labels of the network.
+  /*!
+    The labels must have been built from the contraction hierarchy of the routing
+    graph of the network. They answer the distance queries instead of the
+    hierarchy and are shared by the copies of the network.
+
+    \param labels hub labels, NULL to use the other searches
+   */
+  void setHubLabels(const boost::shared_ptr<const HubLabels>& labels) {
+    _hub_labels = labels;
+  }
+
+  //! Return the landmark distance tables of the network.
+  /*!
+    \return the landmark tables used by getDistanceNodes(), NULL if none
+   */
+  const boost::shared_ptr<const LandmarkTable>& getLandmarkTable() const {
+    return _landmarks;
+  }
+
+  //! Set the landmark distance tables of the network.
+  /*!
+    The tables must have been built from the routing graph of the network
+    (see buildGraph()). They are shared by the copies of the network.
+
+    \param landmarks landmark tables, NULL to run searches without landmarks
+   */
+  void setLandmarkTable(const boost::shared_ptr<const LandmarkTable>& landmarks) {
+    _landmarks = landmarks;
+  }
+
+  //! Collapse the chains of shape nodes of the routing graph.
+  /*!
+    Builds a copy of the routing graph whose chains of nodes with only two
+    neighbours are replaced by single links (see ChainContraction). The Dijkstra
+    searches of getDestFromSource() and getDistanceNodesDijkstra() then run on
+    this smaller graph, the distance of the shape nodes being interpolated along
+    the contracted links. Must be called once the routing graph is built or read,
+    and again after reorder().
+   */
+  void contractChains();
+
+  //! Return the routing graph with contracted chains of the network.
+  /*!
+    \return the contracted graph used by the Dijkstra searches, NULL if none (see contractChains())
+   */
+  const boost::shared_ptr<const ChainContraction>& getChainContraction() const {
+    return _chains;
+  }
+
+  //! Return the distance ring index of the network.
+  /*!
+    \return the distance ring index used by getDestFromSource(), NULL if none
+   */
+  const boost::shared_ptr<DistanceRingIndex>& getDistanceRingIndex() const {
+    return _rings;
+  }
+
+  //! Set the distance ring index of the network.
+  /*!
+    The index is shared by the copies of the network.
+
+    \param rings a distance ring index, NULL to use Dijkstra searches only
+   */
+  void setDistanceRingIndex(const boost::shared_ptr<DistanceRingIndex>& rings) {
+    _rings = rings;
+  }
+
+  //! Return the spatial grid of the network.
+  /*!
+    \return the spatial index of the nodes, NULL if none
+   */
+  const boost::shared_ptr<const SpatialGrid>& getSpatialGrid() const {
+    return _grid;
+  }
+
+  //! Set the spatial grid of the network.
+  /*!
+    The grid must have been built on the routing graph of the network. It answers
+    getNearestNode() and, if hub labels have been set, prefilters the destination
+    sampling (see getDestFromSource()).
+
+    \param grid a spatial grid, NULL to scan the nodes
+   */
+  void setSpatialGrid(const boost::shared_ptr<const SpatialGrid>& grid) {
+    _grid = grid;
+  }
+
+  //! Return the node nearest to a point (snapping).
+  /*!
+    Scans every node if no spatial grid has been set.
+
+    \param x the x coordinate of the point
+    \param y the y coordinate of the point
+
+    \return the id of the nearest node, -1 if the network has no node
+   */
+  long getNearestNode(double x, double y) const;
+
+  //! Compare the priority queue backends on the network.
+  /*!
+    Runs the same random point to point and destination searches with every
+    backend, checks that they agree and writes one line by backend (label, name,
+    time of the point to point searches, time of the destination searches,
+    maximum difference with the binary heap distances) in a semicolon separated
+    format, preceded by a header line unless the output is a non empty file.
+
+    \param aLabel a label identifying the network in the output
+    \param nQueries the number of searches of each kind
+    \param out the output stream
+   */
+  void benchmarkQueues(const std::string & aLabel, int nQueries, std::ostream & out) const;
+
+  //! Compare the node orders on the network.
+  /*!
+    Runs the same random point to point Dijkstra searches on copies of the
+    network reordered with each node order (see reorder()) and writes one line by
+    order (label, order, time of the searches, mean number of nodes settled by a
+    search, cache misses by settled node) in a semicolon separated format,
+    preceded by a header line unless the output is a non empty file. The cache
+    misses are counted by the hardware performance counters of the calling
+    thread (Linux perf events), NA if they are not available.
+
+    \param aLabel a label identifying the network in the output
+    \param nQueries the number of searches
+    \param out the output stream
+   */
+  void benchmarkNodeOrders(const std::string & aLabel, int nQueries, std::ostream & out) const;
+
+  //! Compare the bidirectional and unidirectional point to point searches on the network.
+  /*!
+    Runs the same random point to point searches with both algorithms.
+
+    \param nQueries the number of searches
+    \param maxError the largest relative difference between the distances found by both algorithms
+
+    \return the speed-up of the bidirectional searches (time of the unidirectional searches / time of the bidirectional searches)
+   */
+  double compareBidirectional(int nQueries, double & maxError) const;
+
   //! Compute the set of destination nodes at a given distance from a source node
   /*!
    The computation of the node at a given distance +/- epsilon from a source node
-   is done using a Dijkstra shortest path algorithm relying on a D-ary heap data
-   structure.
+   is done using a Dijkstra shortest path algorithm running on the routing graph,
+   using the search workspace of the calling thread (see DijkstraWorkspace) and
+   the selected priority queue backend (see setQueueType()).
 
    The error term 'epsilon' can be increased since we can end up in an sparse area
    of the network (in term of node density) and it could then be impossible to find
-   feasible nodes.
+   feasible nodes. In that case the search is not restarted: it resumes from its
+   current frontier and the candidates are collected in the widened band, so that
+   a retry only costs the extra annulus.
+
+   If the components of the network have been labelled (see labelComponents()),
+   the destination is drawn among the nodes of the largest strongly connected
+   component, unless none of them is reachable from the source. Once every node
+   reachable from the source is settled, epsilon is directly widened up to the
+   farthest of them instead of being doubled.
+
+   If the chains of shape nodes have been contracted (see contractChains()), the
+   search runs on the core graph and the distance of the shape nodes is
+   interpolated along the contracted links: the feasible nodes are the same.
+
+   If a distance ring index has been set (see setDistanceRingIndex()) and the
+   source node is indexed, the destination is drawn from its ring instead.
+
+   Otherwise, if a spatial grid and hub labels have been set (see setSpatialGrid()),
+   candidates are first drawn uniformly among the nodes close enough to the
+   source: a node at network distance d lies within d divided by the smallest
+   link length / euclidean distance ratio of the network (see
+   SpatialGrid::getMinRatio()). A candidate is accepted if its hub labels
+   distance falls into the band dist +/- 250 meters, so the accepted node is drawn
+   uniformly among the feasible nodes; the search is only run if no candidate has
+   been accepted after a few draws.
 
    \param source_id the source node's id
    \param dist the distance (in meters) desired between the source and the feasible destinations
 
    \return a set of node at distance dist (in meters) from the source node
    */
-  long getDestFromSource(long source_id, float dist);
+  long getDestFromSource(long source_id, float dist) const;
+
+  //! Compute the set of destination nodes at a given distance from a source node, using a given random generator.
+  /*!
+    Same as getDestFromSource(long, float), the destination being drawn with the
+    given generator instead of the simulation's one (e.g. a generator owned by
+    the calling thread).
+
+    \param source_id the source node's id
+    \param dist the distance (in meters) desired between the source and the feasible destinations
+    \param rng a uniform random generator
+
+    \return a set of node at distance dist (in meters) from the source node
+   */
+  long getDestFromSource(long source_id, float dist, Ranq1 & rng) const;
+
+  //! Compute a destination node for each of a batch of (source node, distance) requests.
+  /*!
+    Each destination follows the same rule as getDestFromSource(), but the
+    requests are grouped by source node: a single search is run by distinct
+    source, up to the largest distance requested from it, and every request of
+    the group is answered from the nodes it has settled (sorted by distance, the
+    feasible nodes of a request being found by binary search). The search is
+    only resumed if a request has to widen its band beyond the nodes settled.
+    The requests answered by the distance ring index (if any) do not need any
+    search. The destinations are drawn with the simulation's random generator.
+
+    \param source_ids the source node of each request
+    \param dists the distance (in meters) desired between the source and the destination of each request
+
+    \return the destination node id of each request
+   */
+  std::vector<long> getDestsFromSources(const std::vector<long> & source_ids, const std::vector<float> & dists) const;
+
+  //! Compute a destination node for each of a batch of (source node, distance) requests, using a given random generator.
+  /*!
+    \param source_ids the source node of each request
+    \param dists the distance (in meters) desired between the source and the destination of each request
+    \param rng a uniform random generator
+
+    \return the destination node id of each request
+   */
+  std::vector<long> getDestsFromSources(const std::vector<long> & source_ids, const std::vector<float> & dists, Ranq1 & rng) const;
 
   //! Compute the distance between two nodes in the network.
   /*!
+    The distance is given by the hub labels if they have been set (see
+    setHubLabels()), by the contraction hierarchy if one has been set
+    (see setContractionHierarchy()), by an A* search directed by the landmarks
+    if landmark tables have been set (see setLandmarkTable()), by a bidirectional
+    Dijkstra search if activated (see setBidirectional()), by a Dijkstra search
+    otherwise. If the components of the network have been labelled and the
+    destination is not reachable from the source (see mayReach()), no search is run.
+
     \param source_id source node
     \param dest_id destination node
     
+    \return a distance between the source and destination nodes, the largest float if the destination is not reachable
+   */
+  float getDistanceNodes(long source_id, long dest_id) const;
+
+  //! Compute the distances between a node and a set of nodes in the network.
+  /*!
+    A single Dijkstra search is run from the source node, stopped as soon as every
+    destination node which may be reached (see mayReach()) is settled (or one hub labels or contraction hierarchy
+    query by destination if the labels or a hierarchy have been set).
+
+    \param source_id source node
+    \param dest_ids destination nodes
+
+    \return the distance between the source node and each destination node
+   */
+  std::vector<float> getDistancesFromSource(long source_id, const std::vector<long> & dest_ids) const;
+
+  //! Compute the distances between a set of nodes and a node in the network.
+  /*!
+    A single Dijkstra search is run from the destination node on the reverse graph,
+    stopped as soon as every source node which may reach it is settled (or one hub labels or contraction
+    hierarchy query by source if the labels or a hierarchy have been set).
+
+    \param source_ids source nodes
+    \param dest_id destination node
+
+    \return the distance between each source node and the destination node
+   */
+  std::vector<float> getDistancesToDest(const std::vector<long> & source_ids, long dest_id) const;
+
+  //! Compute the distance between two nodes in the network with a Dijkstra search.
+  /*!
+    Ignores the contraction hierarchy and the landmarks, e.g. to check their distances.
+
+    \param source_id source node
+    \param dest_id destination node
+
+    \return a distance between the source and destination nodes
+   */
+  float getDistanceNodesDijkstra(long source_id, long dest_id) const;
+
+  //! Compute the distance between two nodes in the network with a bidirectional Dijkstra search.
+  /*!
+    A search from the source node on the routing graph and a search from the
+    destination node on the reverse graph are run alternately, the search whose
+    next node is the closest to its origin being advanced. Every link relaxed
+    towards a node reached by the other search gives a path between the nodes,
+    and the searches stop as soon as the sum of the distances of their next nodes
+    exceeds the length of the shortest path found: no shorter path can be found
+    anymore. Both searches roughly explore a disk of radius half the distance,
+    instead of a disk of radius the distance.
+
+    \param source_id source node
+    \param dest_id destination node
+
     \return a distance between the source and destination nodes
    */
-  float getDistanceNodes(long source_id, long dest_id);
+  float getDistanceNodesBidirectional(long source_id, long dest_id) const;
 
   //! Return the maximum x coordinate
   /*!
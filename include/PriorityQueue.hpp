@@ -0,0 +1,508 @@
+/****************************************************************
+ * PRIORITYQUEUE.HPP
+ *
+ * This file contains the priority queues that can be used by
+ * the shortest path algorithms running on the road network.
+ *
+ * Authors: J. Barthelemy
+ * Date   : 12 september 2013
+ ****************************************************************/
+
+/*! \file PriorityQueue.hpp
+ *  \brief Priority queue backends for the network searches (d-ary heaps, radix heap, Dial buckets, Fibonacci heap).
+ */
+
+#ifndef PRIORITYQUEUE_HPP_
+#define PRIORITYQUEUE_HPP_
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <utility>
+#include <cstring>
+#include "FiboHeap.hpp"
+
+//! Priority queue backends available for the network searches.
+enum QueueType {
+  QUEUE_BINARY,     //!< binary heap
+  QUEUE_4ARY,       //!< 4-ary heap
+  QUEUE_RADIX,      //!< radix heap
+  QUEUE_DIAL,       //!< Dial's buckets
+  QUEUE_FIBONACCI   //!< Fibonacci heap
+};
+
+//! Return the queue backend corresponding to its name.
+/*!
+  \param aName the name of the backend (binary, 4ary, radix, dial or fibonacci)
+  \param aDefault the backend returned if the name is unknown
+
+  \return a queue backend
+ */
+inline QueueType queueTypeFromString(const std::string & aName, QueueType aDefault) {
+
+  if      ( aName == "binary"    ) return QUEUE_BINARY;
+  else if ( aName == "4ary"      ) return QUEUE_4ARY;
+  else if ( aName == "radix"     ) return QUEUE_RADIX;
+  else if ( aName == "dial"      ) return QUEUE_DIAL;
+  else if ( aName == "fibonacci" ) return QUEUE_FIBONACCI;
+  return aDefault;
+
+}
+
+//! Return the name of a queue backend.
+/*!
+  \param aType a queue backend
+
+  \return the name of the backend
+ */
+inline std::string queueTypeToString(QueueType aType) {
+
+  switch (aType) {
+    case QUEUE_BINARY    : return "binary";
+    case QUEUE_4ARY      : return "4ary";
+    case QUEUE_RADIX     : return "radix";
+    case QUEUE_DIAL      : return "dial";
+    case QUEUE_FIBONACCI : return "fibonacci";
+  }
+  return "unknown";
+
+}
+
+// All the queues below share the same interface, used as a template policy by
+// the network searches:
+//
+//   void  setup(float minLength, float maxLength)  prepare the queue for a graph whose
+//                                                   link lengths are in [minLength, maxLength]
+//   void  clear()                                   remove every element
+//   bool  empty()                                   check if the queue is empty
+//   void  push(int v, float key)                    insert a node or decrease its key
+//   int   top()                                     node with the minimum key
+//   float topKey()                                  minimum key
+//   void  pop()                                     remove the node with the minimum key
+//
+// The heaps may contain several entries for the same node (lazy deletion): the
+// caller is responsible for skipping outdated entries. The keys pushed must never
+// be smaller than the last key popped (monotone queue), which is always the case
+// for Dijkstra's algorithm on non negative link lengths.
+
+
+//! A d-ary heap of (key, node) pairs.
+/*!
+  An array based heap where each element has D children. Larger degrees give
+  shallower trees, hence cheaper insertions, at the cost of more comparisons
+  during the removal of the minimum.
+ */
+template <int D> class DaryHeapQueue {
+
+private:
+
+  std::vector< std::pair<float,int> > _heap;   //!< heap of (key, node index)
+
+public:
+
+  //! Prepare the queue for a graph (nothing to do).
+  void setup(float, float) {}
+
+  //! Remove every element.
+  void clear() {
+    _heap.clear();
+  }
+
+  //! Check if the queue is empty.
+  /*!
+    \return true if empty
+   */
+  bool empty() const {
+    return _heap.empty();
+  }
+
+  //! Insert a node.
+  /*!
+    \param v a node index
+    \param key its key
+   */
+  void push(int v, float key) {
+
+    int i = _heap.size();
+    _heap.push_back(std::make_pair(key, v));
+
+    // moving the new element up
+    while ( i > 0 ) {
+      int p = (i - 1) / D;
+      if ( _heap[p].first <= key ) break;
+      _heap[i] = _heap[p];
+      i = p;
+    }
+    _heap[i] = std::make_pair(key, v);
+
+  }
+
+  //! Return the node with the minimum key.
+  /*!
+    \return a node index
+   */
+  int top() const {
+    return _heap.front().second;
+  }
+
+  //! Return the minimum key.
+  /*!
+    \return a key
+   */
+  float topKey() const {
+    return _heap.front().first;
+  }
+
+  //! Remove the node with the minimum key.
+  void pop() {
+
+    std::pair<float,int> last = _heap.back();
+    _heap.pop_back();
+    int n = _heap.size();
+    if ( n == 0 ) return;
+
+    // moving the last element down from the root
+    int i = 0;
+    while ( true ) {
+      int first = D * i + 1;
+      if ( first >= n ) break;
+      int end = ( first + D < n ) ? first + D : n;
+      int c   = first;
+      for ( int k = first + 1; k < end; k++ ) {
+        if ( _heap[k].first < _heap[c].first ) c = k;
+      }
+      if ( _heap[c].first >= last.first ) break;
+      _heap[i] = _heap[c];
+      i = c;
+    }
+    _heap[i] = last;
+
+  }
+
+};
+
+typedef DaryHeapQueue<2> BinaryHeapQueue;      //!< binary heap
+typedef DaryHeapQueue<4> QuaternaryHeapQueue;  //!< 4-ary heap
+
+
+//! A radix heap (monotone priority queue).
+/*!
+  The keys are non negative floats whose IEEE 754 representations, read as
+  unsigned integers, are ordered like the floats themselves. An element is
+  stored in the bucket given by the highest bit in which its key differs from
+  the last key removed, so that each element moves down at most 32 times.
+
+  References: Ahuja, Mehlhorn, Orlin and Tarjan, Faster algorithms for the shortest
+  path problem, Journal of the ACM 37(2), 1990.
+ */
+class RadixHeapQueue {
+
+private:
+
+  std::vector< std::pair<unsigned int,int> > _buckets[33];   //!< buckets of (key bits, node index)
+  unsigned int                               _last;          //!< bits of the last key removed
+  unsigned int                               _size;          //!< number of elements
+
+  //! Convert a non negative float to its bits.
+  static unsigned int toBits(float key) {
+    unsigned int bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    return bits;
+  }
+
+  //! Convert bits to the corresponding float.
+  static float toKey(unsigned int bits) {
+    float key;
+    std::memcpy(&key, &bits, sizeof(key));
+    return key;
+  }
+
+  //! Return the bucket of a key given the last key removed.
+  int bucket(unsigned int bits) const {
+    return ( bits == _last ) ? 0 : 32 - __builtin_clz(bits ^ _last);
+  }
+
+  //! Make sure bucket 0 contains the minimum elements.
+  void normalize() {
+
+    if ( !_buckets[0].empty() ) return;
+
+    // first non empty bucket
+    int i = 1;
+    while ( _buckets[i].empty() ) i++;
+
+    // its minimum becomes the last key and its elements are redistributed
+    unsigned int min = _buckets[i][0].first;
+    for ( unsigned int k = 1; k < _buckets[i].size(); k++ ) {
+      if ( _buckets[i][k].first < min ) min = _buckets[i][k].first;
+    }
+    _last = min;
+    for ( unsigned int k = 0; k < _buckets[i].size(); k++ ) {
+      _buckets[bucket(_buckets[i][k].first)].push_back(_buckets[i][k]);
+    }
+    _buckets[i].clear();
+
+  }
+
+public:
+
+  //! Constructor.
+  RadixHeapQueue() : _last(0), _size(0) {};
+
+  //! Prepare the queue for a graph (nothing to do).
+  void setup(float, float) {}
+
+  //! Remove every element.
+  void clear() {
+    for ( int i = 0; i < 33; i++ ) _buckets[i].clear();
+    _last = 0;
+    _size = 0;
+  }
+
+  //! Check if the queue is empty.
+  /*!
+    \return true if empty
+   */
+  bool empty() const {
+    return _size == 0;
+  }
+
+  //! Insert a node.
+  /*!
+    \param v a node index
+    \param key its key (not smaller than the last key removed)
+   */
+  void push(int v, float key) {
+    unsigned int bits = toBits(key);
+    _buckets[bucket(bits)].push_back(std::make_pair(bits, v));
+    _size++;
+  }
+
+  //! Return the node with the minimum key.
+  /*!
+    \return a node index
+   */
+  int top() {
+    normalize();
+    return _buckets[0].back().second;
+  }
+
+  //! Return the minimum key.
+  /*!
+    \return a key
+   */
+  float topKey() {
+    normalize();
+    return toKey(_last);
+  }
+
+  //! Remove the node with the minimum key.
+  void pop() {
+    normalize();
+    _buckets[0].pop_back();
+    _size--;
+  }
+
+};
+
+
+//! Dial's bucket queue.
+/*!
+  The keys are distributed in buckets of fixed width in a circular array. As all
+  the keys present in the queue are within the longest link length of the last
+  key removed, the array only needs to cover that length. The minimum is searched
+  inside the current bucket, so that the queue is exact whatever the bucket width.
+  The width is taken as the shortest link length, bounded so that the number of
+  buckets remains reasonable.
+
+  References: Dial, Algorithm 360: shortest-path forest with topological ordering,
+  Communications of the ACM 12(11), 1969.
+ */
+class DialQueue {
+
+private:
+
+  std::vector< std::vector< std::pair<float,int> > > _buckets;  //!< circular array of buckets of (key, node index)
+  float                                              _width;    //!< width of a bucket (unit: meters)
+  unsigned long                                      _cursor;   //!< absolute number of the current bucket
+  unsigned int                                       _size;     //!< number of elements
+  int                                                _min;      //!< position of the minimum in the current bucket, -1 if unknown
+
+  //! Make sure the current bucket is not empty and locate its minimum.
+  void normalize() {
+
+    if ( _min >= 0 ) return;
+
+    while ( _buckets[_cursor % _buckets.size()].empty() ) _cursor++;
+
+    const std::vector< std::pair<float,int> > & b = _buckets[_cursor % _buckets.size()];
+    _min = 0;
+    for ( unsigned int k = 1; k < b.size(); k++ ) {
+      if ( b[k].first < b[_min].first ) _min = k;
+    }
+
+  }
+
+public:
+
+  //! Constructor.
+  DialQueue() : _buckets(2), _width(1.0), _cursor(0), _size(0), _min(-1) {};
+
+  //! Prepare the queue for a graph.
+  /*!
+    \param minLength the length of the shortest link with a positive length
+    \param maxLength the length of the longest link
+   */
+  void setup(float minLength, float maxLength) {
+
+    const float max_buckets = 65536.0;
+
+    _width = ( minLength > 0.0 ) ? minLength : 1.0;
+    if ( maxLength / _width > max_buckets ) _width = maxLength / max_buckets;
+
+    _buckets.assign((unsigned long) (maxLength / _width) + 2, std::vector< std::pair<float,int> >());
+    _cursor = 0;
+    _size   = 0;
+    _min    = -1;
+
+  }
+
+  //! Remove every element.
+  void clear() {
+
+    if ( _size > 0 ) {
+      for ( unsigned int i = 0; i < _buckets.size(); i++ ) _buckets[i].clear();
+    }
+    _cursor = 0;
+    _size   = 0;
+    _min    = -1;
+
+  }
+
+  //! Check if the queue is empty.
+  /*!
+    \return true if empty
+   */
+  bool empty() const {
+    return _size == 0;
+  }
+
+  //! Insert a node.
+  /*!
+    \param v a node index
+    \param key its key (between the last key removed and the last key removed plus the longest link length)
+   */
+  void push(int v, float key) {
+
+    unsigned long b = (unsigned long) (key / _width);
+    _buckets[b % _buckets.size()].push_back(std::make_pair(key, v));
+    if ( b == _cursor ) _min = -1;                                  // the minimum of the current bucket may change
+    _size++;
+
+  }
+
+  //! Return the node with the minimum key.
+  /*!
+    \return a node index
+   */
+  int top() {
+    normalize();
+    return _buckets[_cursor % _buckets.size()][_min].second;
+  }
+
+  //! Return the minimum key.
+  /*!
+    \return a key
+   */
+  float topKey() {
+    normalize();
+    return _buckets[_cursor % _buckets.size()][_min].first;
+  }
+
+  //! Remove the node with the minimum key.
+  void pop() {
+
+    normalize();
+    std::vector< std::pair<float,int> > & b = _buckets[_cursor % _buckets.size()];
+    b[_min] = b.back();
+    b.pop_back();
+    _size--;
+    _min = -1;
+
+  }
+
+};
+
+
+//! Adapter of the Fibonacci heap (see FiboHeap.hpp) to the queue interface.
+/*!
+  Contrary to the other queues, the keys of the nodes already in the heap are
+  decreased instead of inserting new entries.
+ */
+class FibonacciQueue {
+
+private:
+
+  FibonacciHeap<int,float>                        _heap;     //!< Fibonacci heap of node indices
+  std::vector< FibonacciHeapNode<int,float>* >    _handles;  //!< handle of each node in the heap, NULL if not in the heap
+
+public:
+
+  //! Prepare the queue for a graph (nothing to do).
+  void setup(float, float) {}
+
+  //! Remove every element.
+  void clear() {
+    while ( !_heap.empty() ) {
+      _handles[_heap.minimum()->data()] = NULL;
+      _heap.deletemin();
+    }
+  }
+
+  //! Check if the queue is empty.
+  /*!
+    \return true if empty
+   */
+  bool empty() const {
+    return _heap.empty();
+  }
+
+  //! Insert a node or decrease its key.
+  /*!
+    \param v a node index
+    \param key its key
+   */
+  void push(int v, float key) {
+
+    if ( v >= (int) _handles.size() ) _handles.resize(v + 1, NULL);
+
+    if ( _handles[v] == NULL ) _handles[v] = _heap.insert(v, key);
+    else if ( key < _handles[v]->key() ) _heap.decreaseKey(_handles[v], key);
+
+  }
+
+  //! Return the node with the minimum key.
+  /*!
+    \return a node index
+   */
+  int top() const {
+    return _heap.minimum()->data();
+  }
+
+  //! Return the minimum key.
+  /*!
+    \return a key
+   */
+  float topKey() const {
+    return _heap.minimum()->key();
+  }
+
+  //! Remove the node with the minimum key.
+  void pop() {
+    _handles[_heap.minimum()->data()] = NULL;
+    _heap.deletemin();
+  }
+
+};
+
+#endif /* PRIORITYQUEUE_HPP_ */
@@ -15,6 +15,7 @@
 #define RANDOM_HPP_
 
 #include <iostream>
+#include <algorithm>
 #include <cstdlib>
 #include <vector>
 #include <cmath>
@@ -47,17 +48,192 @@ struct dist_param {
 };
 
 
+//! Builds the alias table of an empirical density function (Vose's construction).
+/*!
+  \param freq the frequencies of the classes (the negative frequencies count as 0, the classes are
+              equally likely if every frequency is 0)
+  \param n the number of classes
+  \param prob the probability of keeping each column (n values)
+  \param alias the class replacing each column otherwise (n values)
+ */
+template <typename T> void build_alias(const T * freq, int n, float * prob, int * alias) {
+
+  double total = 0.0;
+  for( int i = 0; i < n; i++ ) total += std::max((double) freq[i], 0.0);
+
+  // frequencies scaled to an average of 1, split into the columns under and over the average
+  std::vector<double> scaled(n);
+  std::vector<int>    small, large;
+  for( int i = 0; i < n; i++ ) {
+    scaled[i] = ( total > 0.0 ) ? std::max((double) freq[i], 0.0) * n / total : 1.0;
+    if ( scaled[i] < 1.0 ) small.push_back(i);
+    else                   large.push_back(i);
+  }
+
+  // each column under the average is filled up by a column over the average
+  for( int i = 0; i < n; i++ ) {
+    prob[i]  = 1.0;
+    alias[i] = i;
+  }
+  while( !small.empty() && !large.empty() ) {
+    int s = small.back(); small.pop_back();
+    int l = large.back();
+    prob[s]  = scaled[s];
+    alias[s] = l;
+    scaled[l] = ( scaled[l] + scaled[s] ) - 1.0;
+    if ( scaled[l] < 1.0 ) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+
+}
+
+//! Draws a class from an alias table of N classes.
+/*!
+  \param prob the probability of keeping each column
+  \param alias the class replacing each column otherwise
+  \param u a uniform random number in [0,1)
+
+  \return the class identifier
+ */
+template <int N> inline int draw_alias(const float * prob, const int * alias, double u) {
+  double x = u * N;
+  int    k = std::min((int) x, N - 1);
+  return ( x - k < prob[k] ) ? k : alias[k];
+}
+
+//! Draws a class from an alias table of a single class.
+template <> inline int draw_alias<1>(const float *, const int *, double) {
+  return 0;
+}
+
+//! \brief Walker's alias table of an empirical density function.
+/*!
+ The table is built once (see build_alias()) and a class is then drawn in
+ constant time from a single uniform number u: the integer part of u * N gives
+ a column, which is kept if the fractional part is below its probability and
+ replaced by its alias otherwise.
+ */
+typedef struct AliasTable AliasTable;
+struct AliasTable {
+
+  std::vector<float> prob;   //!< probability of keeping each column
+  std::vector<int>   alias;  //!< class replacing each column otherwise
+
+  //! Build the table of an empirical density function.
+  /*!
+    \param freq the frequencies of the classes (see build_alias())
+    \param n the number of classes
+   */
+  template <typename T> void build(const T * freq, int n) {
+    prob.resize(n);
+    alias.resize(n);
+    if ( n > 0 ) build_alias(freq, n, &prob[0], &alias[0]);
+  }
+
+  //! Build the table of an empirical density function.
+  /*!
+    \param freq the frequencies of the classes
+   */
+  template <typename T> void build(const std::vector<T> & freq) {
+    build(freq.empty() ? (const T *) NULL : &freq[0], freq.size());
+  }
+
+  //! Draw a class.
+  /*!
+    \param u a uniform random number in [0,1)
+
+    \return the class identifier (index in the frequencies the table has been built from)
+   */
+  inline int draw(double u) const {
+    int    n = prob.size();
+    double x = u * n;
+    int    k = std::min((int) x, n - 1);
+    return ( x - k < prob[k] ) ? k : alias[k];
+  }
+
+  //! Return true if the table has not been built.
+  bool empty() const {
+    return prob.empty();
+  }
+
+};
+
+//! Largest number of components of a mixture.
+const int MIXTURE_MAX_SIZE = 8;
+
+//! Draws a component of a mixture from the alias table of its proportions (see draw_alias()).
+/*!
+  The draw is specialised on the number of components, dispatched by a switch
+  the compiler can inline.
+
+  \param size the number of components, from 0 to MIXTURE_MAX_SIZE
+  \param prob the probability of keeping each column
+  \param alias the component replacing each column otherwise
+  \param u a uniform random number in [0,1)
+
+  \return the index of the component (0 for a mixture without component)
+ */
+inline int draw_component(int size, const float * prob, const int * alias, double u) {
+
+  switch( size ) {
+    case 2: return draw_alias<2>(prob, alias, u);
+    case 3: return draw_alias<3>(prob, alias, u);
+    case 4: return draw_alias<4>(prob, alias, u);
+    case 5: return draw_alias<5>(prob, alias, u);
+    case 6: return draw_alias<6>(prob, alias, u);
+    case 7: return draw_alias<7>(prob, alias, u);
+    case 8: return draw_alias<8>(prob, alias, u);
+  }
+  return 0;  // a single component (or none)
+
+}
+
+
 //! \brief A structure for storing the parameters of a mixture of univariate distributions.
 /*!
  This structure saves the the location and scale parameters of the components
- and the upper bound of an univariate distribution.
+ and the upper bound of an univariate distribution. The components are stored
+ inline (at most MIXTURE_MAX_SIZE) with the alias table of the proportions (see
+ resize() and buildAlias()).
  */
 typedef struct dist_param_mixture dist_param_mixture;
 struct dist_param_mixture {
-  std::vector<float> mu;    //!< vector storing the mean of each component
-  std::vector<float> sigma; //!< vector storing the standard error of each component
-  std::vector<float> p;     //!< proportions of each components
-  float              max;   //!< upper bound of the distribution
+  int                       size;                          //!< number of components
+  float                     mu[MIXTURE_MAX_SIZE];          //!< mean of each component
+  float                     sigma[MIXTURE_MAX_SIZE];       //!< standard error of each component
+  float                     p[MIXTURE_MAX_SIZE];           //!< proportions of each components
+  float                     alias_prob[MIXTURE_MAX_SIZE];  //!< alias table of the proportions: probability of keeping each column
+  int                       alias[MIXTURE_MAX_SIZE];       //!< alias table of the proportions: component replacing each column otherwise
+  float                     max;                           //!< upper bound of the distribution
+
+  //! Constructor (no component).
+  dist_param_mixture() : size(0), mu(), sigma(), p(), alias_prob(), alias(), max(0.0) {};
+
+  //! Set the number of components.
+  /*!
+    \param n the number of components (from 0 to MIXTURE_MAX_SIZE, an exception otherwise)
+   */
+  void resize(int n) {
+    if ( n < 0 || n > MIXTURE_MAX_SIZE ) throw std::out_of_range("dist_param_mixture: the number of components must be between 0 and MIXTURE_MAX_SIZE");
+    size = n;
+  }
+
+  //! Build the alias table of the proportions, once they are set.
+  void buildAlias() {
+    build_alias(p, size, alias_prob, alias);
+  }
+
+  //! Draw a component.
+  /*!
+    \param u a uniform random number in [0,1)
+
+    \return the index of the component
+   */
+  inline int drawComponent(double u) const {
+    return draw_component(size, alias_prob, alias, u);
+  }
 };
 
 
@@ -75,17 +251,48 @@ struct dist_param_2d {
 
 //! \brief A structure for storing the parameters of a mixture of bivariate distributions.
 /*!
- This structure saves the location vectors, the Choleski decomposition
- of the covariance matrices and the upper bounds vectors of the components of
- bivariate mixture distribution.
+ This structure saves the components of the mixture (at most MIXTURE_MAX_SIZE,
+ stored inline), the mixing proportions with their alias table (see resize()
+ and buildAlias()) and the upper bounds vector.
  */
 typedef struct dist_param_mixture_2d dist_param_mixture_2d;
 struct dist_param_mixture_2d {
-  std::vector<dist_param_2d > components;  //!< vector storing the mixture's components
-  std::vector<float> p;                    //!< mixing proportions of each components
-  float max[2];                            //!< vector of upper bounds
+  int                       size;                          //!< number of components
+  dist_param_2d             components[MIXTURE_MAX_SIZE];  //!< the mixture's components
+  float                     p[MIXTURE_MAX_SIZE];           //!< mixing proportions of each components
+  float                     alias_prob[MIXTURE_MAX_SIZE];  //!< alias table of the proportions: probability of keeping each column
+  int                       alias[MIXTURE_MAX_SIZE];       //!< alias table of the proportions: component replacing each column otherwise
+  float                     max[2];                        //!< vector of upper bounds
+
+  //! Constructor (no component).
+  dist_param_mixture_2d() : size(0), components(), p(), alias_prob(), alias(), max() {};
+
+  //! Set the number of components.
+  /*!
+    \param n the number of components (from 0 to MIXTURE_MAX_SIZE, an exception otherwise)
+   */
+  void resize(int n) {
+    if ( n < 0 || n > MIXTURE_MAX_SIZE ) throw std::out_of_range("dist_param_mixture_2d: the number of components must be between 0 and MIXTURE_MAX_SIZE");
+    size = n;
+  }
+
+  //! Build the alias table of the mixing proportions, once they are set.
+  void buildAlias() {
+    build_alias(p, size, alias_prob, alias);
+  }
+
+  //! Draw a component.
+  /*!
+    \param u a uniform random number in [0,1)
+
+    \return the index of the component
+   */
+  inline int drawComponent(double u) const {
+    return draw_component(size, alias_prob, alias, u);
+  }
 };
 
+
 //! Simplest and fastest random number generator recommended by Numerical Recipes.
 /*!
   Implements the Ranq1 algorithm.
@@ -110,7 +317,7 @@ struct Ranq1 {
   inline unsigned long long int64() {
     v ^= v >> 21;
     v ^= v << 35;
-    v ^= 4;
+    v ^= v >> 4;
     return v * 2685821657736338717LL;
   }
 
@@ -218,7 +425,7 @@ struct Normaldev : Ranfib {
       u = fl();
       v = 1.7156 * ( fl() - 0.5 );
       x = u - 0.449871;
-      y = abs(v) + 0.386595;
+      y = fabs(v) + 0.386595;
       q = x * x + y * ( 0.19600 * y - 0.25472 * x );
     } while ( q > 0.27597 && ( q > 0.27846 || v * v > -4.0 * log(u) * u * u ) );
 
@@ -272,7 +479,7 @@ struct LogNormaldev : Ranfib {
       u = fl();
       v = 1.7156 * ( fl() - 0.5 );
       x = u - 0.449871;
-      y = abs(v) + 0.386595;
+      y = fabs(v) + 0.386595;
       q = x * x + y * ( 0.19600 * y - 0.25472 * x );
     } while ( q > 0.27597 && ( q > 0.27846 || v * v > -4.0 * log(u) * u * u ) );
 
@@ -307,81 +514,63 @@ struct MixtureNormal : Normaldev {
   //! Constructor.
   MixtureNormal(unsigned long long i) : Normaldev(i) {};
 
-  //! Returns a draw from the mixture distribution.
+  //! Returns a draw from the mixture distribution, without bounds.
   /*!
-    \param mu vector of means
-    \param sigma vector of standart deviations
-    \param p vector of mixing proportions
+    \param distrib the parameters of the mixture
 
     \return a random number
    */
-  inline float dev(std::vector<float> mu, std::vector<float> sigma, std::vector<float> p) {
+  inline float draw(const dist_param_mixture & distrib) {
 
-    float  a_p, prop_cum;
-    int    comp;
     float u, v, x, y, q;
 
     // looking for the right component of the mixture
-    a_p      = fl();
-    comp     = 0;
-    prop_cum = p[comp];
-    while( prop_cum < a_p ) {
-      comp++;                               // moving to the next component
-      prop_cum = prop_cum + p[comp];        // computation of the cumulative proportion
-    }
+    int comp = distrib.drawComponent(fl());
 
     // normal draw
     do {
       u = fl();
       v = 1.7156 * ( fl() - 0.5 );
       x = u - 0.449871;
-      y = abs(v) + 0.386595;
+      y = fabs(v) + 0.386595;
       q = x * x + y * ( 0.19600 * y - 0.25472 * x );
-    } while ( q > 0.27597 && ( q > 0.27846 || v * v > -4.0 * log(u) * u * u ) );    
+    } while ( q > 0.27597 && ( q > 0.27846 || v * v > -4.0 * log(u) * u * u ) );
 
-    return (mu[comp] + sigma[comp] * v / u);
+    return (distrib.mu[comp] + distrib.sigma[comp] * v / u);
 
   }
 
-  //! Returns a draw from the mixture distribution.
+  //! Returns a draw from the mixture distribution, bounded by its upper bound.
   /*!
-    \param mu vector of means
-    \param sigma vector of standart deviations
-    \param p vector of mixing proportions
-    \param max upper bound of the distribution
+    \param distrib the parameters of the mixture
 
     \return a random number
    */
-  inline float dev( std::vector<float> mu, std::vector<float> sigma, std::vector<float> p, float max) {
+  inline float dev(const dist_param_mixture & distrib) {
 
     float result;
 
     do {
-      result = dev(mu, sigma, p);
-      std::cout << "TEST MIXTURE NORM " << result << std::endl;
-    } while ( result > max );
+      result = draw(distrib);
+    } while ( result > distrib.max );
     return result;
 
   }
 
-  //! Returns a draw from the mixture distribution.
+  //! Returns a draw from the mixture distribution, bounded by its upper bound and a lower bound.
   /*!
-    \param mu vector of means
-    \param sigma vector of standart deviations
-    \param p vector of mixing proportions
-    \param max upper bound of the distribution
+    \param distrib the parameters of the mixture
     \param min lower bound of the distribution
 
     \return a random number
    */
-  inline float dev( std::vector<float> mu, std::vector<float> sigma, std::vector<float> p, float min, float max) {
+  inline float dev(const dist_param_mixture & distrib, float min) {
 
     float result;
 
     do {
-      result = dev(mu, sigma, p);
-      //std::cout << "TEST MIXTURE NORM " << result << " MIN "<< min << " MAX " << max << std::endl;
-    } while ( result > max || result < min );
+      result = draw(distrib);
+    } while ( result > distrib.max || result < min );
     return result;
 
   }
@@ -394,79 +583,63 @@ struct MixtureLogNormal : LogNormaldev {
   //! Constructor.
   MixtureLogNormal(unsigned long long i) : LogNormaldev(i) {};
 
-  //! Returns a draw from the mixture distribution.
+  //! Returns a draw from the mixture distribution, without bounds.
   /*!
-    \param mu vector of means
-    \param sigma vector of standart deviations
-    \param p vector of mixing proportions
+    \param distrib the parameters of the mixture
 
     \return a random number
    */
-  inline float dev(std::vector<float> mu, std::vector<float> sigma, std::vector<float> p) {
+  inline float draw(const dist_param_mixture & distrib) {
 
-    float  a_p, prop_cum;
-    int    comp;
     float u, v, x, y, q;
 
     // looking for the right component of the mixture
-    a_p      = fl();
-    comp     = 0;
-    prop_cum = p[comp];
-    while( prop_cum < a_p ) {
-      comp++;                               // moving to the next component
-      prop_cum = prop_cum + p[comp];        // computation of the cumulative proportion
-    }
+    int comp = distrib.drawComponent(fl());
 
     // log-normal draw
     do {
       u = doub();
       v = 1.7156 * ( fl() - 0.5 );
       x = u - 0.449871;
-      y = abs(v) + 0.386595;
+      y = fabs(v) + 0.386595;
       q = x * x + y * ( 0.19600 * y - 0.25472 * x );
     } while ( q > 0.27597 && ( q > 0.27846 || v * v > -4.0 * log(u) * u * u ) );
 
-    return exp(mu[comp] + sigma[comp] * v / u);
+    return exp(distrib.mu[comp] + distrib.sigma[comp] * v / u);
 
   }
 
-  //! Returns a draw from the mixture distribution.
+  //! Returns a draw from the mixture distribution, bounded by its upper bound.
   /*!
-    \param mu vector of means
-    \param sigma vector of standart deviations
-    \param p vector of mixing proportions
-    \param max upper bound of the distribution
+    \param distrib the parameters of the mixture
 
     \return a random number
    */
-  inline float dev( std::vector<float> mu, std::vector<float> sigma, std::vector<float> p, float max) {
+  inline float dev(const dist_param_mixture & distrib) {
 
     float result;
 
     do {
-      result = dev(mu, sigma, p);
-    } while ( result > max );
+      result = draw(distrib);
+    } while ( result > distrib.max );
     return result;
 
   }
 
-  //! Returns a draw from the mixture distribution.
+  //! Returns a draw from the mixture distribution, bounded by its upper bound and a lower bound.
   /*!
-    \param mu vector of means
-    \param sigma vector of standart deviations
-    \param p vector of mixing proportions
-    \param max upper bound of the distribution
+    \param distrib the parameters of the mixture
     \param min lower bound of the distribution
 
     \return a random number
    */
-  inline float dev( std::vector<float> mu, std::vector<float> sigma, std::vector<float> p, float min, float max) {
+  inline float dev(const dist_param_mixture & distrib, float min) {
 
     float result;
 
     do {
-      result = dev(mu, sigma, p);
-    } while ( result > max || result < min );
+      result = draw(distrib);
+    } while ( result > distrib.max || result < min );
     return result;
 
   }
@@ -481,20 +654,12 @@ struct MixtureLogNormal2D : Normaldev {
   MixtureLogNormal2D(unsigned long long i) : Normaldev(i) {};
 
   //! Returns 2 draws from a bounded mixture distribution.
-  inline draw_2d dev(dist_param_mixture_2d distrib) {
+  inline draw_2d dev(const dist_param_mixture_2d & distrib) {
 
-    float   a_p, prop_cum;
-    int     comp;
     draw_2d result(0.0,0.0);
 
     // looking for the right component of the mixture
-    a_p      = fl();
-    comp     = 0;
-    prop_cum = distrib.p[comp];
-    while( prop_cum < a_p ) {
-      comp++;                                       // moving to the next component
-      prop_cum = prop_cum + distrib.p[comp];        // computation of the cumulative proportion
-    }
+    int comp = distrib.drawComponent(fl());
 
     do {
 
@@ -513,6 +678,112 @@ struct MixtureLogNormal2D : Normaldev {
 
 };
 
+
+//! Fills an array with standard normal draws.
+/*!
+  The draws are generated by pairs with the Box-Muller transform, 8 pairs at a
+  time with AVX2 instructions when the compiler targets them (see the -march
+  flag of the Makefile), one pair at a time otherwise.
+
+  \param rng the uniform random generator
+  \param z the array to fill
+  \param n the number of draws
+ */
+void normal_block(Ranq1 & rng, float * z, int n);
+
+//! Exponentiates an array in place (8 values at a time with AVX2 instructions when available).
+/*!
+  \param x the array
+  \param n the number of values
+ */
+void exp_block(float * x, int n);
+
+//! Batched random number generator for mixtures of log-normal distributions.
+/*!
+  The standard normal draws (see normal_block()) and the uniform draws picking
+  the components are generated by blocks, refilled when exhausted or on request
+  (see reserve()). devs() fills an array of independent draws at once from the
+  block, exponentiated together (see exp_block()), while dev() draws from
+  mixtures depending on the previous draws (e.g. the activities' durations,
+  conditional to their starting time) one at a time.
+ */
+struct BatchMixtureLogNormal {
+
+  Ranq1               rng;        //!< uniform random draws
+  std::vector<float>  normals;    //!< pre-drawn standard normal draws
+  std::vector<double> uniforms;   //!< pre-drawn uniform draws (components of the mixtures)
+  unsigned int        next;       //!< next pre-drawn draws to use
+
+  //! Constructor.
+  /*!
+    \param i seed of the generator
+   */
+  BatchMixtureLogNormal(unsigned long long i) : rng(i), normals(), uniforms(), next(0) {};
+
+  //! Makes sure that n draws at least are pre-drawn, drawing a new block otherwise.
+  /*!
+    \param n the number of draws about to be performed
+   */
+  void reserve(unsigned int n);
+
+  //! Returns an unbounded draw from a mixture distribution, using the pre-drawn block.
+  /*!
+    \param distrib the parameters of the mixture
+
+    \return a random number (0 for a mixture without component)
+   */
+  inline float draw(const dist_param_mixture & distrib) {
+
+    if ( distrib.size == 0 ) return 0.0;
+    if ( next == normals.size() ) reserve(1);
+    int comp = distrib.drawComponent(uniforms[next]);
+    float result = exp(distrib.mu[comp] + distrib.sigma[comp] * normals[next]);
+    next++;
+    return result;
+
+  }
+
+  //! Returns a draw from a bounded mixture distribution, using the pre-drawn block.
+  /*!
+    \param distrib the parameters of the mixture
+
+    \return a random number
+   */
+  inline float dev(const dist_param_mixture & distrib) {
+
+    float result;
+
+    do {
+      result = draw(distrib);
+    } while ( result > distrib.max );
+    return result;
+
+  }
+
+  //! Fills an array with draws from a mixture distribution bounded from both sides.
+  /*!
+    \param distrib the parameters of the mixture
+    \param out the array to fill
+    \param n the number of draws
+    \param min the lower bound of the draws
+   */
+  void devs(const dist_param_mixture & distrib, float * out, int n, float min = 0.0);
+
+  //! Fills an array with draws from bounded mixture distributions, one mixture by draw.
+  /*!
+    \param distribs the parameters of the mixture of each draw
+    \param out the array to fill
+    \param n the number of draws
+   */
+  void devs(const dist_param_mixture * distribs, float * out, int n);
+
+private:
+
+  //! Fills an array with draws from bounded mixture distributions, the mixture of the i-th draw being distribs[i * stride].
+  void devs(const dist_param_mixture * distribs, int stride, float * out, int n, float min);
+
+};
+
 //! \brief SingletonRnd class for the RandomGenerators class.
 template <typename T>
 class SingletonRnd {
@@ -583,13 +854,15 @@ public:
   MixtureNormal      mixt_norm_dev;       //!< mixture of univariate normal random draws
   MixtureLogNormal   mixt_lognorm_dev;    //!< mixture of univariate log-normal random draws
   MixtureLogNormal2D mixt_lognorm_dev_2d; //!< mixture of bivariate log-normal random draws
+  BatchMixtureLogNormal mixt_lognorm_batch; //!< mixture of univariate log-normal random draws, by blocks
 
   //! Constructor, initialize every random number generators
   /*!
     \param i the seed
    */
   RandomGenerators(unsigned long long i) : unif(i + 10000), fast_unif(i+10), norm_dev(i + 100), lognorm_dev(i + 1000),
-					   mixt_norm_dev(i + 10000), mixt_lognorm_dev(i + 100000), mixt_lognorm_dev_2d(i + 1000000) {};
+					   mixt_norm_dev(i + 10000), mixt_lognorm_dev(i + 100000), mixt_lognorm_dev_2d(i + 1000000),
+					   mixt_lognorm_batch(i + 10000000) {};
 
   //! Destructor.
   virtual ~RandomGenerators() {};
@@ -0,0 +1,190 @@
+/****************************************************************
+ * ROUTINGSERVICE.HPP
+ *
+ * This file contains the routing service answering the network
+ * queries of the activity models.
+ *
+ * Authors: J. Barthelemy
+ * Date   : 1 october 2013
+ ****************************************************************/
+
+/*! \file RoutingService.hpp
+ *  \brief Routing service: const queries on the road network.
+ */
+
+#ifndef ROUTINGSERVICE_HPP_
+#define ROUTINGSERVICE_HPP_
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "Network.hpp"
+#include "DetourTable.hpp"
+
+//! \brief A routing service.
+/*!
+  The routing service is the entry point of the activity models to the road
+  network. It only refers to the network owned by the Data class, so it can
+  be used (and passed around) without copying any node, link or graph.
+
+  Every query is const. The distance queries and the destination sampling with
+  a generator owned by the calling thread may be called concurrently by several
+  threads: the searches use the workspaces of the calling thread (see
+  DijkstraWorkspace), the contraction hierarchy is read-only and the distance
+  ring index is locked internally. The destination sampling without a given
+  generator draws from the simulation's random generator and must only be
+  called by the simulation's thread.
+
+  In the fast distance mode (see setDetourTable()), the distance queries are
+  approximated from the euclidean distances between the nodes instead of
+  searching the network; the destination sampling is not affected.
+ */
+class RoutingService {
+
+private:
+
+  const Network *                        _network;    //!< road network
+  boost::shared_ptr<const DetourTable>   _detours;    //!< detour factors approximating the distances (fast distance mode, if any)
+
+public:
+
+  //! Constructor.
+  /*!
+    \param network the road network (must outlive the service)
+   */
+  RoutingService(const Network * network = NULL) : _network(network), _detours() {};
+
+  //! Destructor.
+  virtual ~RoutingService() {};
+
+  //! Return the road network.
+  /*!
+    \return the road network
+   */
+  const Network & getNetwork() const {
+    return *_network;
+  }
+
+  //! Set the detour factors approximating the distance queries.
+  /*!
+    \param detours calibrated detour factors (fast distance mode), NULL to search the network
+   */
+  void setDetourTable(const boost::shared_ptr<const DetourTable> & detours) {
+    _detours = detours;
+  }
+
+  //! Check whether the distance queries are approximated (fast distance mode).
+  /*!
+    \return true if a detour table has been set
+   */
+  bool isApproximate() const {
+    return _detours.get() != NULL;
+  }
+
+  //! Return the ins code of a node of the road network (see Network::getNodeIns()).
+  /*!
+    \param node_id the id of a node
+
+    \return the ins code of the node
+   */
+  int getNodeIns(long node_id) const {
+    return _network->getNodeIns(node_id);
+  }
+
+  //! Compute the distance between two nodes (see Network::getDistanceNodes(), DetourTable::distance() in the fast distance mode).
+  /*!
+    \param source_id source node
+    \param dest_id destination node
+
+    \return the distance between the nodes
+   */
+  float getDistance(long source_id, long dest_id) const {
+    if (_detours) return _detours->distance(*_network, source_id, dest_id);
+    return _network->getDistanceNodes(source_id, dest_id);
+  }
+
+  //! Compute the distances from a node to a set of nodes in one search (see Network::getDistancesFromSource()).
+  /*!
+    \param source_id source node
+    \param target_ids destination nodes
+
+    \return the distance between the source node and each destination node
+   */
+  std::vector<float> distancesFrom(long source_id, const std::vector<long> & target_ids) const {
+    if (_detours) {
+      std::vector<float> result(target_ids.size());
+      for (unsigned int k = 0; k < target_ids.size(); k++) result[k] = _detours->distance(*_network, source_id, target_ids[k]);
+      return result;
+    }
+    return _network->getDistancesFromSource(source_id, target_ids);
+  }
+
+  //! Compute the distances from a set of nodes to a node in one search (see Network::getDistancesToDest()).
+  /*!
+    \param target_id destination node
+    \param source_ids source nodes
+
+    \return the distance between each source node and the destination node
+   */
+  std::vector<float> distancesTo(long target_id, const std::vector<long> & source_ids) const {
+    if (_detours) {
+      std::vector<float> result(source_ids.size());
+      for (unsigned int k = 0; k < source_ids.size(); k++) result[k] = _detours->distance(*_network, source_ids[k], target_id);
+      return result;
+    }
+    return _network->getDistancesToDest(source_ids, target_id);
+  }
+
+  //! Draw a destination node at a given distance from a source node (see Network::getDestFromSource()).
+  /*!
+    Uses the simulation's random generator, which is not shared between threads.
+
+    \param source_id the source node
+    \param dist the desired distance (in meters)
+
+    \return a destination node id
+   */
+  long sampleDestination(long source_id, float dist) const {
+    return _network->getDestFromSource(source_id, dist);
+  }
+
+  //! Draw a destination node at a given distance from a source node with a given random generator.
+  /*!
+    \param source_id the source node
+    \param dist the desired distance (in meters)
+    \param rng a uniform random generator owned by the calling thread
+
+    \return a destination node id
+   */
+  long sampleDestination(long source_id, float dist, Ranq1 & rng) const {
+    return _network->getDestFromSource(source_id, dist, rng);
+  }
+
+  //! Draw a destination node for each of a batch of (source node, distance) requests (see Network::getDestsFromSources()).
+  /*!
+    One search is run by distinct source node instead of one by request. Uses
+    the simulation's random generator, which is not shared between threads.
+
+    \param source_ids the source node of each request
+    \param dists the desired distance (in meters) of each request
+
+    \return the destination node id of each request
+   */
+  std::vector<long> sampleDestinations(const std::vector<long> & source_ids, const std::vector<float> & dists) const {
+    return _network->getDestsFromSources(source_ids, dists);
+  }
+
+  //! Draw a destination node for each of a batch of (source node, distance) requests with a given random generator.
+  /*!
+    \param source_ids the source node of each request
+    \param dists the desired distance (in meters) of each request
+    \param rng a uniform random generator owned by the calling thread
+
+    \return the destination node id of each request
+   */
+  std::vector<long> sampleDestinations(const std::vector<long> & source_ids, const std::vector<float> & dists, Ranq1 & rng) const {
+    return _network->getDestsFromSources(source_ids, dists, rng);
+  }
+
+};
+
+#endif /* ROUTINGSERVICE_HPP_ */
@@ -0,0 +1,90 @@
+/****************************************************************
+ * SHAREDSEGMENT.HPP
+ *
+ * This file contains a POSIX shared memory segment used to share
+ * read-only data between the processes of a computing node.
+ *
+ * Authors: J. Barthelemy
+ * Date   : 9 october 2013
+ ****************************************************************/
+
+/*! \file SharedSegment.hpp
+ *  \brief POSIX shared memory segment.
+ */
+
+#ifndef SHAREDSEGMENT_HPP_
+#define SHAREDSEGMENT_HPP_
+
+#include <string>
+#include <cstddef>
+
+//! \brief A POSIX shared memory segment.
+/*!
+  A segment is created (and filled) by one process, then opened read-only by
+  the other processes of the computing node using its name. Once every process
+  has opened the segment, its name can be removed (see unlink()): the memory is
+  released when the last process unmaps it, i.e. destroys its segment object.
+  Hence the object cannot be copied.
+ */
+class SharedSegment {
+
+private:
+
+  std::string _name;     //!< name of the segment (e.g. "/vbel-1234-network")
+  char *      _data;     //!< first byte of the mapping (NULL if the segment could not be mapped)
+  size_t      _size;     //!< size of the segment (bytes)
+
+  //! Copy constructor (disabled).
+  SharedSegment(const SharedSegment &);
+
+  //! Assignment operator (disabled).
+  SharedSegment & operator=(const SharedSegment &);
+
+public:
+
+  //! Constructor, creating a new segment mapped read-write.
+  /*!
+    \param name the name of the segment (must start with a '/' and not exist yet)
+    \param size the size of the segment (in bytes)
+   */
+  SharedSegment(const std::string & name, size_t size);
+
+  //! Constructor, opening an existing segment mapped read-only.
+  /*!
+    \param name the name of the segment
+   */
+  SharedSegment(const std::string & name);
+
+  //! Destructor, unmapping the segment.
+  virtual ~SharedSegment();
+
+  //! Remove the name of the segment (no other process can open it anymore).
+  void unlink();
+
+  //! Check whether the segment has been mapped.
+  /*!
+    \return true if the segment has been created or opened successfully
+   */
+  bool isOpen() const {
+    return _data != NULL;
+  }
+
+  //! Return the first byte of the segment (writable only by the process that created it).
+  /*!
+    \return a pointer to the content of the segment
+   */
+  char * getData() const {
+    return _data;
+  }
+
+  //! Return the size of the segment.
+  /*!
+    \return a number of bytes
+   */
+  size_t getSize() const {
+    return _size;
+  }
+
+};
+
+#endif /* SHAREDSEGMENT_HPP_ */
@@ -0,0 +1,196 @@
+/****************************************************************
+ * SHORTESTPATHTREE.HPP
+ *
+ * This file contains the shortest path trees rooted at the
+ * households' houses and their cache.
+ *
+ * Authors: J. Barthelemy
+ * Date   : 24 september 2013
+ ****************************************************************/
+
+/*! \file ShortestPathTree.hpp
+ *  \brief Reverse shortest path trees rooted at a node and a memory bounded cache of trees.
+ */
+
+#ifndef SHORTESTPATHTREE_HPP_
+#define SHORTESTPATHTREE_HPP_
+
+#include <list>
+#include <vector>
+#include <utility>
+#include <boost/unordered_map.hpp>
+#include <boost/shared_ptr.hpp>
+#include "Network.hpp"
+
+//! \brief A reverse shortest path tree rooted at a node.
+/*!
+  The tree gives the distance from any node of the network to its root. It is
+  grown lazily: a Dijkstra search runs on the reverse routing graph from the
+  root, and is only resumed when the distance of a node not settled yet is
+  requested. The memory used by the tree is proportional to the part of the
+  network explored so far.
+ */
+class ShortestPathTree {
+
+private:
+
+  //! Label of a node reached by the search.
+  struct Label {
+    float dist;      //!< tentative distance to the root
+    bool  settled;   //!< true if the distance is the shortest one
+  };
+
+  typedef std::pair<float, int> Entry;   //!< entry of the priority queue (distance, node index)
+
+  const RoutingGraph *             _reverse;  //!< reverse routing graph
+  int                              _root;     //!< index of the root node
+  boost::unordered_map<int, Label> _labels;   //!< labels of the reached nodes
+  std::vector<Entry>               _queue;    //!< priority queue of the search (binary heap, lazy deletion)
+
+public:
+
+  //! Constructor.
+  /*!
+    \param reverse the reverse routing graph of the network (see Network::getReverseGraph())
+    \param root the index of the root node
+   */
+  ShortestPathTree(const RoutingGraph & reverse, int root);
+
+  //! Destructor.
+  virtual ~ShortestPathTree() {};
+
+  //! Return the distance from a node to the root, growing the tree if necessary.
+  /*!
+    \param v a node index
+
+    \return the distance from the node to the root, the largest float if the root is not reachable
+   */
+  float distanceToRoot(int v);
+
+  //! Return the index of the root node.
+  /*!
+    \return a node index
+   */
+  int getRoot() const {
+    return _root;
+  }
+
+  //! Return an estimate of the memory used by the tree.
+  /*!
+    \return a number of bytes
+   */
+  size_t getMemory() const;
+
+};
+
+
+//! \brief A cache of reverse shortest path trees rooted at the households' houses.
+/*!
+  The members of a household all go back to the same house: the tree rooted at
+  the house is built at the first return trip of a member and shared by the
+  others. The expected users of a tree are registered beforehand (see expect())
+  and the tree is evicted as soon as the last one is done (see release()). The
+  least recently used trees are also evicted when the memory used by the cache
+  exceeds its budget (they are rebuilt if needed).
+ */
+class ShortestPathTreeCache {
+
+private:
+
+  //! A tree of the cache.
+  struct CacheEntry {
+    boost::shared_ptr<ShortestPathTree> tree;     //!< the tree (NULL if not built or evicted)
+    int                                 pending;  //!< number of users not done yet
+    size_t                              memory;   //!< memory used by the tree at its last use
+    std::list<int>::iterator            lru;      //!< position of the root in the least recently used list
+  };
+
+  const Network &                       _network;    //!< road network
+  size_t                                _budget;     //!< maximum memory used by the trees (bytes)
+  size_t                                _memory;     //!< memory currently used by the trees (bytes)
+  boost::unordered_map<int, CacheEntry> _entries;    //!< trees by root node index
+  std::list<int>                        _lru;        //!< roots of the built trees, most recently used first
+  unsigned long                         _n_queries;  //!< number of distance queries
+  unsigned long                         _n_built;    //!< number of trees built
+  unsigned long                         _n_evicted;  //!< number of trees evicted because of the memory budget
+
+  //! Evict the tree of a root.
+  /*!
+    \param root a root node index
+   */
+  void evict(int root);
+
+public:
+
+  //! Constructor.
+  /*!
+    \param network the road network
+    \param budget the maximum memory used by the trees (in bytes)
+   */
+  ShortestPathTreeCache(const Network & network, size_t budget);
+
+  //! Destructor.
+  virtual ~ShortestPathTreeCache() {};
+
+  //! Register a future user of the tree rooted at a node.
+  /*!
+    \param root_id the id of the root node (e.g. a house)
+   */
+  void expect(long root_id);
+
+  //! Signal that a user of the tree rooted at a node is done.
+  /*!
+    The tree is evicted when every registered user is done.
+
+    \param root_id the id of the root node
+   */
+  void release(long root_id);
+
+  //! Compute the distance between a node and a root node.
+  /*!
+    \param source_id the id of the source node
+    \param root_id the id of the root node
+
+    \return the distance from the source node to the root node
+   */
+  float getDistance(long source_id, long root_id);
+
+  //! Compute the distances between a set of nodes and a root node.
+  /*!
+    The distances are given by a single search, the tree rooted at the node if it
+    has been registered (see expect()), a search on the reverse graph otherwise.
+
+    \param source_ids the ids of the source nodes
+    \param root_id the id of the root node
+
+    \return the distance from each source node to the root node
+   */
+  std::vector<float> getDistances(const std::vector<long> & source_ids, long root_id);
+
+  //! Return the number of distance queries answered by the cache.
+  /*!
+    \return a number of queries
+   */
+  unsigned long getNbQueries() const {
+    return _n_queries;
+  }
+
+  //! Return the number of trees built.
+  /*!
+    \return a number of trees
+   */
+  unsigned long getNbBuilt() const {
+    return _n_built;
+  }
+
+  //! Return the number of trees evicted because of the memory budget.
+  /*!
+    \return a number of trees
+   */
+  unsigned long getNbEvicted() const {
+    return _n_evicted;
+  }
+
+};
+
+#endif /* SHORTESTPATHTREE_HPP_ */
@@ -0,0 +1,165 @@
+/****************************************************************
+ * SPATIALGRID.HPP
+ *
+ * This file contains the spatial index of the nodes of the road
+ * network (uniform grid over the bounding box of the network).
+ *
+ * Authors: J. Barthelemy
+ * Date   : 18 october 2013
+ ****************************************************************/
+
+/*! \file SpatialGrid.hpp
+ *  \brief Uniform grid over the nodes of the road network (nearest nodes, radius, box and sampling queries).
+ */
+
+#ifndef SPATIALGRID_HPP_
+#define SPATIALGRID_HPP_
+
+#include <vector>
+#include "Network.hpp"
+
+//! \brief A uniform grid over the nodes of the road network.
+/*!
+  The bounding box of the network is split into square cells holding about the
+  same number of nodes on average. The nodes are stored cell by cell (row by
+  row), with their coordinates, so that the nodes of a row of cells are
+  contiguous: the nearest nodes of a point, the nodes within a radius or a box
+  are found by scanning the cells around the point only.
+
+  The grid also gives the smallest ratio between the length of a link and the
+  euclidean distance between its nodes (at most 1): the network distance
+  between two nodes is at least this ratio times their euclidean distance, so
+  every node at a given network distance from a source lies in a disk around
+  the source (see Network::getDestFromSource()).
+ */
+class SpatialGrid {
+
+private:
+
+  double             _x0;           //!< x coordinate of the lower left corner of the grid
+  double             _y0;           //!< y coordinate of the lower left corner of the grid
+  double             _cell_size;    //!< side of a cell (unit: meters)
+  int                _nx;           //!< number of columns of cells
+  int                _ny;           //!< number of rows of cells
+  std::vector<int>   _cell_first;   //!< first node of each cell, row by row (size nx * ny + 1)
+  std::vector<int>   _nodes;        //!< node indices, by cell
+  std::vector<float> _xs;           //!< x coordinate of the nodes relative to the corner of the grid, by cell
+  std::vector<float> _ys;           //!< y coordinate of the nodes relative to the corner of the grid, by cell
+  double             _min_ratio;    //!< smallest ratio between the length of a link and the euclidean distance between its nodes
+
+  //! Return the column of the cell of an x coordinate (clamped to the grid).
+  int column(double x) const;
+
+  //! Return the row of the cell of a y coordinate (clamped to the grid).
+  int row(double y) const;
+
+  //! Add the nodes of a cell to the nearest nodes found so far (max-heap of at most k nodes).
+  void scanCell(int cx, int cy, double x, double y, unsigned int k, std::vector< std::pair<double, int> > & heap) const;
+
+public:
+
+  //! Constructor.
+  SpatialGrid() : _x0(0.0), _y0(0.0), _cell_size(1.0), _nx(0), _ny(0), _cell_first(1, 0), _nodes(), _xs(), _ys(), _min_ratio(1.0) {};
+
+  //! Destructor.
+  virtual ~SpatialGrid() {};
+
+  //! Build the grid over the nodes of a road network.
+  /*!
+    The grid covers the bounding box of the network (see Network::getMinX()),
+    extended to the nodes lying outside of it if any.
+
+    \param network the road network
+    \param nodesByCell the average number of nodes by cell
+   */
+  void build(const Network & network, double nodesByCell);
+
+  //! Return the nearest node of a point.
+  /*!
+    \param x the x coordinate of the point
+    \param y the y coordinate of the point
+
+    \return a node index in the routing graph, -1 if the network has no node
+   */
+  int nearest(double x, double y) const;
+
+  //! Return the k nearest nodes of a point.
+  /*!
+    \param x the x coordinate of the point
+    \param y the y coordinate of the point
+    \param k the number of nodes
+
+    \return the node indices in the routing graph, by increasing distance from the point (fewer than k if the network is smaller)
+   */
+  std::vector<int> nearest(double x, double y, int k) const;
+
+  //! Return the nodes within a radius of a point.
+  /*!
+    \param x the x coordinate of the point
+    \param y the y coordinate of the point
+    \param radius the radius (unit: meters)
+
+    \return the node indices in the routing graph (in no particular order)
+   */
+  std::vector<int> withinRadius(double x, double y, double radius) const;
+
+  //! Return the nodes within a box.
+  /*!
+    \param xMin the smallest x coordinate of the box
+    \param yMin the smallest y coordinate of the box
+    \param xMax the largest x coordinate of the box
+    \param yMax the largest y coordinate of the box
+
+    \return the node indices in the routing graph (in no particular order)
+   */
+  std::vector<int> withinBox(double xMin, double yMin, double xMax, double yMax) const;
+
+  //! Draw a node uniformly among the nodes of the cells intersecting a square.
+  /*!
+    The cells may hold nodes outside of the square: the caller checks the
+    position of the node drawn (rejection sampling).
+
+    \param x the x coordinate of the center of the square
+    \param y the y coordinate of the center of the square
+    \param halfSide half the side of the square (unit: meters)
+    \param rng a uniform random generator
+
+    \return a node index in the routing graph, -1 if the cells are empty
+   */
+  int draw(double x, double y, double halfSide, Ranq1 & rng) const;
+
+  //! Return the smallest ratio between the length of a link and the euclidean distance between its nodes.
+  /*!
+    \return a ratio in [0, 1]: the network distance between two nodes is at least the ratio times their euclidean distance
+   */
+  double getMinRatio() const {
+    return _min_ratio;
+  }
+
+  //! Return the side of a cell.
+  /*!
+    \return a length (unit: meters)
+   */
+  double getCellSize() const {
+    return _cell_size;
+  }
+
+  //! Return the number of columns of cells.
+  /*!
+    \return a number of cells
+   */
+  int getNbColumns() const {
+    return _nx;
+  }
+
+  //! Return the number of rows of cells.
+  /*!
+    \return a number of cells
+   */
+  int getNbRows() const {
+    return _ny;
+  }
+
+};
+
+#endif /* SPATIALGRID_HPP_ */
@@ -45,43 +45,23 @@ Activity::Activity(char aType, long nodeId, bool start, float startTime) : _type
   map<char, int> codebook = Data::getInstance()->getMapActCharToInt();
   this->_type_num = codebook[aType];
 
-  // getting the road network's nodes
-  Network net = Data::getInstance()->getNetwork();
-  map<long, Node> nodes = net.getNodes();
-
   // Computation of the activity destination.
   if( start == true ) {
 
     // ... computation of the distance of the trip.
-    dist_param param = Data::getInstance()->getActDistParDist(this->_type_num);
-    this->_distance = 0.0;
-
-    while( this->_distance < 1.0 ) {
-      this->_distance = RandomGenerators::getInstance()->lognorm_dev.dev(param.mu, param.sigma, param.max);
-    }
+    this->_distance = Activity::drawTripDistance(this->_type_num);
 
-    // ... computation of the duration of the trip
-    dist_param_mixture duration_trip_dist_par = Data::getInstance()->getDurationCondiDistTripParDist(this->_distance);
-    this->_dur_trip = RandomGenerators::getInstance()->mixt_lognorm_dev.dev(duration_trip_dist_par.mu, duration_trip_dist_par.sigma, duration_trip_dist_par.p, duration_trip_dist_par.max);
-    
-    // ... update starting time to take account of trip duration
-    startTime = startTime + this->_dur_trip;
-
-    // ... duration of the activity given the starting time
-    dist_param_mixture duration_dist_par = Data::getInstance()->getActDurationCondiStartParDist(this->_type_num, startTime);
-    this->_duration = RandomGenerators::getInstance()->mixt_lognorm_dev.dev(duration_dist_par.mu, duration_dist_par.sigma, duration_dist_par.p, duration_dist_par.max);
-
-    // ... ending time
-    this->_end_time = this->_duration + startTime;
+    // ... duration of the trip and of the activity, ending time
+    this->initTrip(startTime);
 
     // ... selection of a destination node id.
-    this->_nodeId = net.getDestFromSource(nodeId, this->_distance);
+    this->_nodeId = Data::getInstance()->getRoutingService().sampleDestination(nodeId, this->_distance);
 
   // Activity takes place at current node: no destination and trip duration.
   } else {
 
-    dist_param_mixture duration_dist_par = Data::getInstance()->getActDurationCondiStartParDist(this->_type_num, startTime);
-    this->_duration = RandomGenerators::getInstance()->mixt_lognorm_dev.dev(duration_dist_par.mu, duration_dist_par.sigma, duration_dist_par.p, duration_dist_par.max);
+    const dist_param_mixture & duration_dist_par = Data::getInstance()->getActDurationCondiStartParDist(this->_type_num, startTime);
+    this->_duration = RandomGenerators::getInstance()->mixt_lognorm_batch.dev(duration_dist_par);
     this->_end_time = this->_duration + startTime;
 
     // node where the activity is taking place ...
@@ -95,15 +75,95 @@ Activity::Activity(char aType, long nodeId, bool start, float startTime) : _type
 
 }
 
+// This constructor generate an activity of a given type whose destination and trip are known
+Activity::Activity(char aType, long destNode, float distance, float durTrip, float startTime) : _type(aType), _distance(distance), _dur_trip(durTrip), _nodeId(destNode) {
+
+  // getting code-book to compute integer coding of the activity
+  map<char, int> codebook = Data::getInstance()->getMapActCharToInt();
+  this->_type_num = codebook[aType];
+
+  // duration of the activity, ending time
+  this->initDuration(startTime + durTrip);
+
+}
+
+// Draw the distance of the trip to an activity of a given type
+float Activity::drawTripDistance(int aTypeNum) {
+
+  dist_param param = Data::getInstance()->getActDistParDist(aTypeNum);
+  float distance = 0.0;
+
+  while( distance < 1.0 ) {
+    distance = RandomGenerators::getInstance()->lognorm_dev.dev(param.mu, param.sigma, param.max);
+  }
+
+  return distance;
+
+}
+
+// Draw the durations of independent trips of given distances at once
+void Activity::drawTripDurations(const vector<float> & distances, vector<float> & durations) {
+
+  vector<dist_param_mixture> params;   // distribution of each trip longer than 1 meter...
+  vector<unsigned int>       trips;    // ... and its index
+  for (unsigned int i = 0; i < distances.size(); i++) {
+    if ( distances[i] > 1.0 ) {
+      params.push_back(Data::getInstance()->getDurationCondiDistTripParDist(distances[i]));
+      trips.push_back(i);
+    }
+  }
+
+  vector<float> draws(params.size());
+  if ( !params.empty() ) RandomGenerators::getInstance()->mixt_lognorm_batch.devs(&params[0], &draws[0], params.size());
+
+  durations.assign(distances.size(), 0.0);
+  for (unsigned int j = 0; j < trips.size(); j++) durations[trips[j]] = draws[j];
+
+}
+
+// Draw the house departure times of the individuals whose first activity has a given type
+void Activity::drawHouseDepartures(int aNextTypeNum, float * endTimes, int n) {
+
+  // drawn in minutes, staying at least one second
+  const dist_param_mixture & tdep_par_dist = Data::getInstance()->getActHouseTDepParDist(aNextTypeNum);
+  RandomGenerators::getInstance()->mixt_lognorm_batch.devs(tdep_par_dist, endTimes, n, 1.0 / 60.0);
+  for (int i = 0; i < n; i++) endTimes[i] *= 60.0;
+
+}
+
+// Compute the duration of the trip, the duration and the ending time of the activity
+void Activity::initTrip(float startTime) {
+
+  // ... computation of the duration of the trip
+  dist_param_mixture duration_trip_dist_par = Data::getInstance()->getDurationCondiDistTripParDist(this->_distance);
+  this->_dur_trip = RandomGenerators::getInstance()->mixt_lognorm_batch.dev(duration_trip_dist_par);
+
+  // ... update starting time to take account of trip duration
+  this->initDuration(startTime + this->_dur_trip);
+
+}
+
+// Compute the duration and the ending time of the activity
+void Activity::initDuration(float startTime) {
+
+  // ... duration of the activity given the starting time
+  const dist_param_mixture & duration_dist_par = Data::getInstance()->getActDurationCondiStartParDist(this->_type_num, startTime);
+  this->_duration = RandomGenerators::getInstance()->mixt_lognorm_batch.dev(duration_dist_par);
+
+  // ... ending time
+  this->_end_time = this->_duration + startTime;
+
+}
+
 // Constructor of the first activity performed by an Individual
 Activity::Activity(long nodeId, int nextActivityType) : _type('m'), _type_num(2), _nodeId(nodeId) {
 
   // House departure time
 
-  dist_param_mixture tdep_par_dist = Data::getInstance()->getActHouseTDepParDist(nextActivityType);
+  const dist_param_mixture & tdep_par_dist = Data::getInstance()->getActHouseTDepParDist(nextActivityType);
   this->_end_time = 0.0;
   while( this->_end_time < 1.0 ) { // staying at least one second
-    this->_end_time = RandomGenerators::getInstance()->mixt_lognorm_dev.dev(tdep_par_dist.mu, tdep_par_dist.sigma, tdep_par_dist.p, tdep_par_dist.max) * 60.0;
+    this->_end_time = RandomGenerators::getInstance()->mixt_lognorm_batch.dev(tdep_par_dist) * 60.0;
   }
   this->_duration = this->_end_time;
 
@@ -114,21 +174,36 @@ Activity::Activity(long nodeId, int nextActivityType) : _type('m'), _type_num(2)
 
 }
 
+// Constructor of the first activity performed by an Individual, the house departure time being known
+Activity::Activity(long nodeId, float endTime) : _type('m'), _type_num(2), _end_time(endTime), _duration(endTime), _distance(0.0), _dur_trip(0.0), _nodeId(nodeId) {
+
+}
+
 // Constructor of the last activity performed by an Individual
 Activity::Activity(long startNode, long endNode) {
 
+  // Duration of the trip
+
+  dist_param_mixture duration_trip_dist_par = Data::getInstance()->getDurationCondiDistTripParDist(Data::getInstance()->getRoutingService().getDistance(startNode,endNode));
+  this->initReturnHome(endNode, RandomGenerators::getInstance()->mixt_lognorm_batch.dev(duration_trip_dist_par));
+
+}
+
+// Constructor of the last activity performed by an Individual, the trip duration being known
+Activity::Activity(long, long endNode, float durTrip) {
+
+  this->initReturnHome(endNode, durTrip);
+
+}
+
+// Initialization of the last activity performed by an Individual
+void Activity::initReturnHome(long endNode, float durTrip) {
+
   this->_type     = 'm';     // returning home: character coding
   this->_type_num = 2;       // returning home: integer coding
   this->_end_time = -1;      // last activity of the chain -> no end time
   this->_duration = -1;      // last activity of the chain -> no duration
-
-
-  // Duration of the trip
-
-  Network net = Data::getInstance()->getNetwork();
-  float distance = net.getDistanceNodes(startNode,endNode);   // distance between startNode and endNode
-  dist_param_mixture duration_trip_dist_par = Data::getInstance()->getDurationCondiDistTripParDist(distance);
-  this->_dur_trip = RandomGenerators::getInstance()->mixt_lognorm_dev.dev(duration_trip_dist_par.mu, duration_trip_dist_par.sigma, duration_trip_dist_par.p, duration_trip_dist_par.max);
+  this->_dur_trip = durTrip; // duration of the trip
 
   // Extraction of x and y coordinate.
 
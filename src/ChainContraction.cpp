@@ -0,0 +1,153 @@
+/****************************************************************
+ * CHAINCONTRACTION.CPP
+ *
+ * This file contains all the definitions of the methods of
+ * ChainContraction.hpp (see this file for methods' documentation)
+ *
+ * Authors: J. Barthelemy
+ * Date   : 16 october 2013
+ ****************************************************************/
+
+#include "../include/ChainContraction.hpp"
+#include <algorithm>
+
+
+using namespace std;
+
+namespace {
+
+  // Check whether a node only describes the shape of a road: two distinct neighbours a and b,
+  // a link a -> v if and only if a link v -> b, a link b -> v if and only if a link v -> a
+  bool isShapeNode(const RoutingGraph & g, const RoutingGraph & reverse, int v) {
+
+    int n_out = g.endOut(v) - g.beginOut(v);
+    int n_in  = reverse.endOut(v) - reverse.beginOut(v);
+    if ( n_out < 1 || n_out > 2 || n_in != n_out ) return false;
+
+    int out[2], in[2];
+    for (int k = 0; k < n_out; k++) {
+      out[k] = g.getTarget(g.beginOut(v) + k);
+      in[k]  = reverse.getTarget(reverse.beginOut(v) + k);
+      if ( out[k] == v || in[k] == v ) return false;
+    }
+
+    if ( n_out == 1 ) return out[0] != in[0];                              // one-way road
+    if ( out[0] == out[1] || in[0] == in[1] ) return false;                // parallel links
+    return ( out[0] == in[0] && out[1] == in[1] ) || ( out[0] == in[1] && out[1] == in[0] );   // two-way road
+
+  }
+
+  // Link leaving a shape node towards its neighbour other than the previous node of the chain
+  int nextLink(const RoutingGraph & g, int prev, int v) {
+
+    for (int e = g.beginOut(v); e < g.endOut(v); e++) {
+      if ( g.getTarget(e) != prev ) return e;
+    }
+    return -1;
+
+  }
+
+}
+
+// Collapse the chains of interior nodes of a routing graph
+void ChainContraction::build(const RoutingGraph & g, const RoutingGraph & reverse) {
+
+  int n = g.getNbNodes();
+
+  // Interior nodes (i.e. shape nodes)
+  vector<char> interior(n, 0);
+  for (int v = 0; v < n; v++) {
+    interior[v] = isShapeNode(g, reverse, v) ? 1 : 0;
+  }
+
+  // A cycle made of shape nodes only is not reached by any chain: one of its nodes is kept as a core node
+  vector<char> visited(n, 0);
+  for (int h = 0; h < n; h++) {
+    if ( interior[h] ) continue;
+    for (int e = g.beginOut(h); e < g.endOut(h); e++) {
+      for (int prev = h, v = g.getTarget(e); interior[v] && !visited[v]; ) {
+        visited[v] = 1;
+        int next = g.getTarget(nextLink(g, prev, v));
+        prev = v;
+        v    = next;
+      }
+    }
+  }
+  for (int c = 0; c < n; c++) {
+    if ( !interior[c] || visited[c] ) continue;
+    interior[c] = 0;
+    for (int e = g.beginOut(c); e < g.endOut(c); e++) {
+      for (int prev = c, v = g.getTarget(e); interior[v] && !visited[v]; ) {
+        visited[v] = 1;
+        int next = g.getTarget(nextLink(g, prev, v));
+        prev = v;
+        v    = next;
+      }
+    }
+  }
+
+  // Links of the core graph, by increasing source node (i.e. in the order of the CSR arrays),
+  // each chain of interior nodes being replaced by a single link
+  vector<long>  ids(n);
+  vector<int>   sources;
+  vector<int>   targets;
+  vector<float> lengths;
+  vector<int>   link_first(1, 0);
+  vector<int>   link_nodes;
+  vector<float> link_offsets;
+  float         max_length = 0.0;
+  for (int h = 0; h < n; h++) {
+    ids[h] = g.getId(h);
+    if ( interior[h] ) continue;
+    for (int e = g.beginOut(h); e < g.endOut(h); e++) {
+      int   prev   = h;
+      int   v      = g.getTarget(e);
+      float length = g.getLength(e);
+      while ( interior[v] ) {
+        link_nodes.push_back(v);
+        link_offsets.push_back(length);
+        int f = nextLink(g, prev, v);
+        length += g.getLength(f);
+        prev = v;
+        v    = g.getTarget(f);
+      }
+      if ( (int) link_nodes.size() > link_first.back() ) max_length = max(max_length, length);
+      sources.push_back(h);
+      targets.push_back(v);
+      lengths.push_back(length);
+      link_first.push_back(link_nodes.size());
+    }
+  }
+
+  // Contracted links of each interior node (one by direction of travel)
+  vector<int> node_first(n + 1, 0);
+  for (unsigned int pos = 0; pos < link_nodes.size(); pos++) node_first[link_nodes[pos] + 1]++;
+  for (int i = 0; i < n; i++) node_first[i + 1] += node_first[i];
+  vector<int> node_links(link_nodes.size());
+  vector<int> node_positions(link_nodes.size());
+  vector<int> next_pos(node_first.begin(), node_first.end() - 1);
+  for (unsigned int e = 0; e + 1 < link_first.size(); e++) {
+    for (int pos = link_first[e]; pos < link_first[e + 1]; pos++) {
+      node_links[next_pos[link_nodes[pos]]]       = e;
+      node_positions[next_pos[link_nodes[pos]]++] = pos;
+    }
+  }
+
+  int nb_interior = 0;
+  for (int i = 0; i < n; i++) {
+    if ( interior[i] ) nb_interior++;
+  }
+
+  this->_core.build(ids, sources, targets, lengths);
+  this->_link_sources.take(sources);
+  this->_link_first.take(link_first);
+  this->_link_nodes.take(link_nodes);
+  this->_link_offsets.take(link_offsets);
+  this->_node_first.take(node_first);
+  this->_node_links.take(node_links);
+  this->_node_positions.take(node_positions);
+  this->_max_length  = max_length;
+  this->_nb_interior = nb_interior;
+  this->_checksum    = g.getChecksum();
+
+}
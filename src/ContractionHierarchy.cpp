@@ -0,0 +1,369 @@
+/****************************************************************
+ * CONTRACTIONHIERARCHY.CPP
+ *
+ * This file contains all the definitions of the methods of
+ * ContractionHierarchy.hpp (see this file for methods' documentation)
+ *
+ * Authors: J. Barthelemy
+ * Date   : 19 september 2013
+ ****************************************************************/
+
+#include "../include/ContractionHierarchy.hpp"
+#include <fstream>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+
+
+using namespace std;
+
+const char         CH_FILE_MAGIC[4]      = {'V', 'B', 'C', 'H'};  // first bytes of a cache file
+const unsigned int CH_FILE_VERSION       = 1;                     // version of the cache file format
+const int          CH_WITNESS_SETTLED    = 500;                   // maximum number of nodes settled by a witness search
+const int          CH_SIMULATION_SETTLED = 50;                    // idem when estimating the importance of a node
+
+namespace {
+
+  // An arc of the graph being contracted
+  struct ContractionArc {
+    int   node;    // neighbour node index
+    float length;  // length of the arc
+  };
+
+  // Entry of the priority queue of a witness search (distance, node)
+  typedef pair<float, int> WitnessEntry;
+
+  // Graph being contracted: adjacency lists restricted to the nodes not contracted yet
+  class ContractionGraph {
+
+  public:
+
+    vector< vector<ContractionArc> > out;        // outgoing arcs of each node
+    vector< vector<ContractionArc> > in;         // incoming arcs of each node
+    vector<int>                      deleted;    // number of contracted neighbours of each node
+    vector<int>                      level;      // upper bound of the depth of each node in the hierarchy
+
+    // Constructor
+    ContractionGraph(const RoutingGraph & g) : out(g.getNbNodes()), in(g.getNbNodes()), deleted(g.getNbNodes(), 0), level(g.getNbNodes(), 0),
+                                               _dist(g.getNbNodes(), 0.0), _stamp(g.getNbNodes(), 0), _generation(0), _heap() {
+      for (int i = 0; i < g.getNbNodes(); i++) {
+        for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+          if (g.getTarget(e) != i) addArc(i, g.getTarget(e), g.getLength(e));
+        }
+      }
+    }
+
+    // Add an arc, or shorten it if the nodes are already linked
+    void addArc(int u, int w, float length) {
+      if ( !updateArc(out[u], w, length) ) {
+        ContractionArc a = {w, length};
+        out[u].push_back(a);
+      }
+      if ( !updateArc(in[w], u, length) ) {
+        ContractionArc a = {u, length};
+        in[w].push_back(a);
+      }
+    }
+
+    // Compute the shortcuts required to contract a node
+    int shortcuts(int v, vector<int> * from, vector<int> * to, vector<float> * lengths, int max_settled) {
+
+      int n_shortcuts = 0;
+      float max_out = 0.0;
+      for (unsigned int j = 0; j < out[v].size(); j++) max_out = max(max_out, out[v][j].length);
+
+      for (unsigned int i = 0; i < in[v].size(); i++) {
+        int u = in[v][i].node;
+        witnessSearch(u, v, in[v][i].length + max_out, max_settled);
+        for (unsigned int j = 0; j < out[v].size(); j++) {
+          int   w   = out[v][j].node;
+          float via = in[v][i].length + out[v][j].length;
+          if ( w != u && witnessDist(w) > via ) {
+            n_shortcuts++;
+            if (from != NULL) {
+              from->push_back(u);
+              to->push_back(w);
+              lengths->push_back(via);
+            }
+          }
+        }
+      }
+
+      return n_shortcuts;
+
+    }
+
+    // Importance of a node: edge difference (estimated with short witness searches), number of contracted neighbours and depth
+    int priority(int v) {
+      int edge_diff = shortcuts(v, NULL, NULL, NULL, CH_SIMULATION_SETTLED) - (int) (in[v].size() + out[v].size());
+      return 2 * edge_diff + deleted[v] + level[v];
+    }
+
+    // Remove a node from the adjacency lists of its neighbours
+    void remove(int v) {
+      for (unsigned int j = 0; j < out[v].size(); j++) {
+        removeArc(in[out[v][j].node], v);
+        deleted[out[v][j].node]++;
+        level[out[v][j].node] = max(level[out[v][j].node], level[v] + 1);
+      }
+      for (unsigned int i = 0; i < in[v].size(); i++) {
+        removeArc(out[in[v][i].node], v);
+        deleted[in[v][i].node]++;
+        level[in[v][i].node] = max(level[in[v][i].node], level[v] + 1);
+      }
+      vector<ContractionArc>().swap(out[v]);
+      vector<ContractionArc>().swap(in[v]);
+    }
+
+  private:
+
+    vector<float>        _dist;        // tentative distances of the witness search
+    vector<unsigned int> _stamp;       // generation at which the distance of each node was set
+    unsigned int         _generation;  // number of the current witness search
+    vector<WitnessEntry> _heap;        // priority queue of the witness search
+
+    // Shorten an arc if it exists in a list
+    static bool updateArc(vector<ContractionArc> & arcs, int node, float length) {
+      for (unsigned int k = 0; k < arcs.size(); k++) {
+        if (arcs[k].node == node) {
+          arcs[k].length = min(arcs[k].length, length);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // Remove the arcs to a node from a list
+    static void removeArc(vector<ContractionArc> & arcs, int node) {
+      for (unsigned int k = 0; k < arcs.size(); ) {
+        if (arcs[k].node == node) {
+          arcs[k] = arcs.back();
+          arcs.pop_back();
+        } else {
+          k++;
+        }
+      }
+    }
+
+    // Distance found by the last witness search
+    float witnessDist(int w) const {
+      return ( _stamp[w] == _generation ) ? _dist[w] : numeric_limits<float>::max();
+    }
+
+    // Local Dijkstra search from u avoiding v, bounded in distance and in number of settled nodes
+    void witnessSearch(int u, int v, float max_dist, int max_settled) {
+
+      _generation++;
+      _dist[u]  = 0.0;
+      _stamp[u] = _generation;
+      _heap.clear();
+      _heap.push_back(WitnessEntry(0.0, u));
+
+      int n_settled = 0;
+      while ( !_heap.empty() && n_settled < max_settled ) {
+        WitnessEntry top = _heap.front();
+        pop_heap(_heap.begin(), _heap.end(), greater<WitnessEntry>());
+        _heap.pop_back();
+        if ( top.first > _dist[top.second] ) continue;   // outdated entry
+        if ( top.first > max_dist ) break;
+        n_settled++;
+        const vector<ContractionArc> & arcs = out[top.second];
+        for (unsigned int k = 0; k < arcs.size(); k++) {
+          int   w = arcs[k].node;
+          float d = top.first + arcs[k].length;
+          if ( w != v && d < witnessDist(w) ) {
+            _dist[w]  = d;
+            _stamp[w] = _generation;
+            _heap.push_back(WitnessEntry(d, w));
+            push_heap(_heap.begin(), _heap.end(), greater<WitnessEntry>());
+          }
+        }
+      }
+
+    }
+
+  };
+
+}
+
+// Build the contraction hierarchy
+void ContractionHierarchy::build(const RoutingGraph & g) {
+
+  int n = g.getNbNodes();
+  ContractionGraph cg(g);
+
+  // Links of the hierarchy, collected when their least important node is contracted
+  vector<int>   up_from, up_to, down_from, down_to;
+  vector<float> up_length, down_length;
+  vector<int>   sc_from, sc_to;
+  vector<float> sc_length;
+
+  // Initial importance of the nodes
+  typedef pair<int, int> entry;
+  priority_queue<entry, vector<entry>, greater<entry> > queue;
+  vector<int> importance(n);
+  for (int v = 0; v < n; v++) {
+    importance[v] = cg.priority(v);
+    queue.push(entry(importance[v], v));
+  }
+
+  // Contraction of the nodes by increasing importance (lazy updates)
+  vector<bool> contracted(n, false);
+  this->_nb_shortcuts = 0;
+  while ( !queue.empty() ) {
+
+    int v = queue.top().second;
+    int p = queue.top().first;
+    queue.pop();
+    if ( contracted[v] || p != importance[v] ) continue;   // outdated entry
+
+    // ... the importance may have increased since the node has been pushed
+    importance[v] = cg.priority(v);
+    if ( !queue.empty() && importance[v] > queue.top().first ) {
+      queue.push(entry(importance[v], v));
+      continue;
+    }
+
+    // ... adding the shortcuts between its neighbours
+    sc_from.clear();
+    sc_to.clear();
+    sc_length.clear();
+    cg.shortcuts(v, &sc_from, &sc_to, &sc_length, CH_WITNESS_SETTLED);
+    for (unsigned int k = 0; k < sc_from.size(); k++) {
+      cg.addArc(sc_from[k], sc_to[k], sc_length[k]);
+    }
+    this->_nb_shortcuts += sc_from.size();
+
+    // ... its remaining links go to more important nodes
+    for (unsigned int j = 0; j < cg.out[v].size(); j++) {
+      up_from.push_back(v);
+      up_to.push_back(cg.out[v][j].node);
+      up_length.push_back(cg.out[v][j].length);
+    }
+    for (unsigned int i = 0; i < cg.in[v].size(); i++) {
+      down_from.push_back(v);
+      down_to.push_back(cg.in[v][i].node);
+      down_length.push_back(cg.in[v][i].length);
+    }
+
+    // ... and the importance of its neighbours is updated
+    vector<int> neighbours;
+    for (unsigned int j = 0; j < cg.out[v].size(); j++) neighbours.push_back(cg.out[v][j].node);
+    for (unsigned int i = 0; i < cg.in[v].size(); i++)  neighbours.push_back(cg.in[v][i].node);
+    sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    cg.remove(v);
+    contracted[v] = true;
+    for (unsigned int k = 0; k < neighbours.size(); k++) {
+      importance[neighbours[k]] = cg.priority(neighbours[k]);
+      queue.push(entry(importance[neighbours[k]], neighbours[k]));
+    }
+
+  }
+
+  // Upward and downward graphs
+  vector<long> ids(n);
+  for (int i = 0; i < n; i++) ids[i] = g.getId(i);
+  this->_up.build(ids, up_from, up_to, up_length);
+  this->_down.build(ids, down_from, down_to, down_length);
+  this->_checksum = g.getChecksum();
+
+}
+
+// Write the hierarchy to a cache file
+bool ContractionHierarchy::save(const std::string & filename) const {
+
+  ofstream file(filename.c_str(), ios::out | ios::binary);
+  if (!file) return false;
+
+  file.write(CH_FILE_MAGIC, sizeof(CH_FILE_MAGIC));
+  file.write((const char *) &CH_FILE_VERSION, sizeof(CH_FILE_VERSION));
+  file.write((const char *) &this->_checksum, sizeof(this->_checksum));
+  file.write((const char *) &this->_nb_shortcuts, sizeof(this->_nb_shortcuts));
+  this->_up.write(file);
+  this->_down.write(file);
+
+  return (bool) file;
+
+}
+
+// Read the hierarchy from a cache file
+bool ContractionHierarchy::load(const std::string & filename, const RoutingGraph & g) {
+
+  ifstream file(filename.c_str(), ios::in | ios::binary);
+  if (!file) return false;
+
+  char magic[sizeof(CH_FILE_MAGIC)];
+  unsigned int version = 0;
+  unsigned long long checksum = 0;
+  file.read(magic, sizeof(magic));
+  file.read((char *) &version, sizeof(version));
+  file.read((char *) &checksum, sizeof(checksum));
+  if ( !file || memcmp(magic, CH_FILE_MAGIC, sizeof(magic)) != 0 || version != CH_FILE_VERSION || checksum != g.getChecksum() ) return false;
+
+  file.read((char *) &this->_nb_shortcuts, sizeof(this->_nb_shortcuts));
+  if ( !file || !this->_up.read(file) || !this->_down.read(file) ) return false;
+  if ( this->_up.getNbNodes() != g.getNbNodes() || this->_down.getNbNodes() != g.getNbNodes() ) return false;
+
+  this->_checksum = checksum;
+  return true;
+
+}
+
+// Bidirectional upward search of the distance between two nodes
+float ContractionHierarchy::distance(int source, int dest) const {
+
+  if (source == dest) return 0.0;
+
+  DijkstraWorkspace<BinaryHeapQueue> & fwd = DijkstraWorkspace<BinaryHeapQueue>::local(2);   // forward search from the source
+  DijkstraWorkspace<BinaryHeapQueue> & bwd = DijkstraWorkspace<BinaryHeapQueue>::local(3);   // backward search from the destination
+  fwd.init(this->_up);
+  bwd.init(this->_down);
+  fwd.relax(source, 0.0);
+  bwd.relax(dest, 0.0);
+
+  float best = numeric_limits<float>::max();   // length of the shortest path found so far
+  bool fwd_active = true;
+  bool bwd_active = true;
+
+  while (fwd_active || bwd_active) {
+
+    // ... a search stops as soon as it can not improve the shortest path found
+    fwd_active = fwd_active && fwd.hasNext() && fwd.nextDist() < best;
+    bwd_active = bwd_active && bwd.hasNext() && bwd.nextDist() < best;
+
+    // ... the search with the closest frontier goes first
+    bool forward = fwd_active && ( !bwd_active || fwd.nextDist() <= bwd.nextDist() );
+    if (!forward && !bwd_active) break;
+
+    DijkstraWorkspace<BinaryHeapQueue> & ws    = forward ? fwd : bwd;
+    DijkstraWorkspace<BinaryHeapQueue> & other = forward ? bwd : fwd;
+    const RoutingGraph & g       = forward ? this->_up : this->_down;
+    const RoutingGraph & reverse = forward ? this->_down : this->_up;
+
+    float d = ws.nextDist();
+    int   i = ws.next();
+
+    // ... the searches meet
+    float d_other = other.getDist(i);
+    if ( d_other < numeric_limits<float>::max() ) best = min(best, d + d_other);
+
+    // ... stall on demand: the node is reached by a shorter path through a more important node
+    bool stalled = false;
+    for (int e = reverse.beginOut(i); e < reverse.endOut(i) && !stalled; e++) {
+      float d_upper = ws.getDist(reverse.getTarget(e));
+      stalled = ( d_upper < numeric_limits<float>::max() && d_upper + reverse.getLength(e) < d );
+    }
+    if (stalled) continue;
+
+    for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+      int j = g.getTarget(e);
+      if ( ws.isSettled(j) == false ) ws.relax(j, d + g.getLength(e));
+    }
+
+  }
+
+  return best;
+
+}
@@ -9,12 +9,46 @@
  ****************************************************************/
 
 #include "../include/Data.hpp"
+#include "../include/ChainContraction.hpp"
+#include "../include/ContractionHierarchy.hpp"
+#include "../include/DetourTable.hpp"
+#include "../include/HubLabels.hpp"
+#include "../include/LandmarkTable.hpp"
+#include "../include/SpatialGrid.hpp"
+#include "../include/DistanceRingIndex.hpp"
+#include <cstring>
+#include <unistd.h>
+#include <boost/bind.hpp>
+#include <boost/mpi/collectives.hpp>
+#include <boost/mpi/environment.hpp>
+#include <boost/serialization/string.hpp>
 
 using namespace std;
 using namespace repast;
 using namespace tinyxml2;
 using namespace boost;
 
+const int ACT_START_TIME_MAX = 172800;   // largest starting time of the activities tabulated (48 hours, in seconds)
+const int AGE_CLASS_FIRST[]  = { 0, 6, 18, 40, 60, 111 };   // first age of each age class (and end of the last one)
+const int NB_AGE_CLASSES     = 5;        // number of age classes
+
+namespace {
+
+  // Build the alias tables of an age distribution restricted to each age class
+  vector<AliasTable> ageClassAlias(const vector<long> & ageDis) {
+
+    vector<AliasTable> result(NB_AGE_CLASSES);
+    for( int c = 0; c < NB_AGE_CLASSES; c++ ) {
+      int first = min(AGE_CLASS_FIRST[c], (int) ageDis.size());
+      int last  = min(AGE_CLASS_FIRST[c + 1], (int) ageDis.size());
+      if ( first < last ) result[c].build(&ageDis[first], last - first);
+    }
+    return result;
+
+  }
+
+}
+
 void Data::read_mun_age_men() {
 
   vector<long> age_dis;                                           // age distribution
@@ -34,6 +68,7 @@ void Data::read_mun_age_men() {
       mun_id = age_dis[0];                                        // extracting municipality id
       age_dis.erase(age_dis.begin());                             // ... and deleting it from the age distribution vector
       _mun_age_men.insert(make_pair(mun_id, age_dis));            // saving data
+      _mun_age_men_alias.insert(make_pair(mun_id, ageClassAlias(age_dis)));
     }
     file.close();
   } else {
@@ -61,6 +96,7 @@ void Data::read_mun_age_women() {
       mun_id = age_dis[0];                         // extracting municipality id
       age_dis.erase(age_dis.begin()); // ... and deleting it from the age distribution vector
       _mun_age_women.insert(make_pair(mun_id, age_dis));          // saving data
+      _mun_age_women_alias.insert(make_pair(mun_id, ageClassAlias(age_dis)));
     }
     file.close();
   } else {
@@ -125,18 +161,71 @@ void Data::read_birth_age() {
 
 }
 
-void Data::read_node_ins() {
+void Data::init_shared_memory() {
 
-  if (RepastProcess::instance()->rank() == 0) {
-    cout << "... reading municipalities' nodes" << endl;
+  mpi::communicator world;
+
+  // processes running on the same computing node have the same processor name
+  string         host = mpi::environment::processor_name();
+  vector<string> hosts;
+  mpi::all_gather(world, host, hosts);
+  int color = find(hosts.begin(), hosts.end(), host) - hosts.begin();
+
+  this->_node_comm = world.split(color);
+  this->_shared    = ( this->_props.getProperty("par.shared_memory") == "y" ) && ( this->_node_comm.size() > 1 );
+
+  if (RepastProcess::instance()->rank() == 0 && this->_shared) {
+    cout << "... sharing read-only data between the " << this->_node_comm.size() << " processes of the node" << endl;
   }
 
-  int          ins;
-  long         node_id;
-  vector<long> data;
-  string       a_line;
-  string       filename = this->_props.getProperty("file.node_ins");
-  ifstream     file(filename.c_str(), ios::in);
+}
+
+boost::shared_ptr<SharedSegment> Data::share_image(const string & aLabel, const vector<char> & aImage) {
+
+  boost::shared_ptr<SharedSegment> segment;
+  bool first = ( this->_node_comm.rank() == 0 );
+
+  // the first process creates and fills the segment, named after its process id...
+  unsigned long long info[3] = {aImage.size(), (unsigned long long) getpid(), 0};   // size, process id, segment created
+  if (first) {
+    string name = "/vbel-" + lexical_cast<string>(info[1]) + "-" + aLabel;
+    segment = boost::shared_ptr<SharedSegment>(new SharedSegment(name, aImage.size()));
+    if (segment->isOpen()) {
+      memcpy(segment->getData(), &aImage[0], aImage.size());
+      info[2] = 1;
+    }
+  }
+  mpi::broadcast(this->_node_comm, info, 3, 0);
+  if (info[2] == 0) return boost::shared_ptr<SharedSegment>();
+
+  // ... the others map it...
+  if (!first) {
+    string name = "/vbel-" + lexical_cast<string>(info[1]) + "-" + aLabel;
+    segment = boost::shared_ptr<SharedSegment>(new SharedSegment(name));
+  }
+
+  // ... and its name is removed once every process has mapped it
+  bool mapped = mpi::all_reduce(this->_node_comm, segment->isOpen() && segment->getSize() == info[0], std::logical_and<bool>());
+  if (first) segment->unlink();
+  if (!mapped) segment.reset();
+  return segment;
+
+}
+
+// Comparison of (ins code, node id) pairs by ins code
+static bool insBefore(const pair<int, long> & a, const pair<int, long> & b) {
+  return a.first < b.first;
+}
+
+// Read the municipalities' nodes file and group the nodes by ins code (keeping the file order within a municipality)
+static void read_node_ins_file(const string & filename, vector<int> & codes, vector<int> & offsets, vector<long> & nodes) {
+
+  int                      ins;
+  long                     node_id;
+  vector<long>             data;
+  string                   a_line;
+  vector<pair<int, long> > ins_node;
+  ifstream                 file(filename.c_str(), ios::in);
 
   // file reading
   if (file) {
@@ -144,14 +233,74 @@ void Data::read_node_ins() {
       data = split<long>(a_line, ";");                            // reading a data line
       node_id = data[0];                                          // extracting id of the current node
       ins = data[1];                                              // extracting ins code of the municipality
-      _map_ins_node.insert(make_pair(ins, node_id));              // saving data
-      _map_node_ins.insert(make_pair(node_id, ins));
+      ins_node.push_back(make_pair(ins, node_id));                // saving data
     }
     file.close();
   } else {
     cerr << "Could not open " << filename << endl;
   }
 
+  // grouping
+  stable_sort(ins_node.begin(), ins_node.end(), insBefore);
+  codes.clear();
+  offsets.clear();
+  nodes.resize(ins_node.size());
+  for (unsigned int k = 0; k < ins_node.size(); k++) {
+    if (k == 0 || ins_node[k].first != ins_node[k-1].first) {
+      codes.push_back(ins_node[k].first);
+      offsets.push_back(k);
+    }
+    nodes[k] = ins_node[k].second;
+  }
+  offsets.push_back(ins_node.size());
+
+}
+
+void Data::read_node_ins() {
+
+  if (RepastProcess::instance()->rank() == 0) {
+    cout << "... reading municipalities' nodes" << endl;
+  }
+
+  string       filename = this->_props.getProperty("file.node_ins");
+  vector<int>  codes;                                             // ins codes
+  vector<int>  offsets;                                           // first node of each ins code
+  vector<long> nodes;                                             // nodes grouped by ins code
+
+  if (this->isNodeReader()) read_node_ins_file(filename, codes, offsets, nodes);
+
+  // with shared data, the index built by the first process of the node is mapped by every process
+  if (this->_shared) {
+
+    vector<char> image;
+    if (this->isNodeReader()) {
+      unsigned long long sizes[2] = {codes.size(), nodes.size()};
+      appendArray(image, sizes, 2);
+      appendArray(image, codes.empty() ? (const int *) NULL : &codes[0], codes.size());
+      appendArray(image, &offsets[0], offsets.size());
+      appendArray(image, nodes.empty() ? (const long *) NULL : &nodes[0], nodes.size());
+    }
+
+    boost::shared_ptr<SharedSegment> segment = this->share_image("ins", image);
+    if (segment) {
+      const char * data = segment->getData();
+      size_t       pos  = 0;
+      const unsigned long long * sizes = locateArray<unsigned long long>(data, segment->getSize(), pos, 2);
+      this->_ins_codes.view(locateArray<int>(data, segment->getSize(), pos, sizes[0]), sizes[0], segment);
+      this->_ins_offsets.view(locateArray<int>(data, segment->getSize(), pos, sizes[0] + 1), sizes[0] + 1, segment);
+      this->_ins_nodes.view(locateArray<long>(data, segment->getSize(), pos, sizes[1]), sizes[1], segment);
+      return;
+    }
+
+    // ... the sharing failed, every process reads the file
+    if (!this->isNodeReader()) read_node_ins_file(filename, codes, offsets, nodes);
+
+  }
+
+  this->_ins_codes.take(codes);
+  this->_ins_offsets.take(offsets);
+  this->_ins_nodes.take(nodes);
+
 }
 
 void Data::read_activity_cdb() {
@@ -194,102 +343,396 @@ void Data::read_activity_cdb() {
 
 }
 
+void Data::index_ins_node_draws() {
+
+  int n_ins = this->_ins_codes.size();
+  this->_ins_draw_offsets.assign(n_ins + 1, 0);
+  this->_ins_draw_nodes.clear();
+
+  for (int k = 0; k < n_ins; k++) {
+
+    // keeping the nodes of the largest strongly connected component, unless the municipality has none
+    for (int i = this->_ins_offsets[k]; i < this->_ins_offsets[k+1]; i++) {
+      int index = this->_network.getGraph().getIndex(this->_ins_nodes[i]);
+      if (index >= 0 && this->_network.isInLargestComponentIndex(index)) this->_ins_draw_nodes.push_back(this->_ins_nodes[i]);
+    }
+    if ((int) this->_ins_draw_nodes.size() == this->_ins_draw_offsets[k]) {
+      for (int i = this->_ins_offsets[k]; i < this->_ins_offsets[k+1]; i++) this->_ins_draw_nodes.push_back(this->_ins_nodes[i]);
+    }
+    this->_ins_draw_offsets[k+1] = this->_ins_draw_nodes.size();
+
+  }
+
+}
+
 void Data::read_network() {
 
   if (RepastProcess::instance()->rank() == 0) {
     cout << "... reading network" << endl;
   }
 
-  // Loading XML file containing the network data.
-  string filename = this->_props.getProperty("file.network");
-  XMLDocument doc(filename.c_str());
-  doc.loadFile(filename.c_str());
+  // Mapping the binary network file if any (see vbel-netconvert), parsing the XML file otherwise
+  string filename     = this->_props.getProperty("file.network");
+  string filename_bin = this->_props.getProperty("file.network_bin");
+  bool   mapped       = !filename_bin.empty() && this->_network.readBinary(filename_bin);
+
+  if ( mapped ) {
+    if (RepastProcess::instance()->rank() == 0) {
+      cout << "    Network mapped from " << filename_bin << endl;
+      // ... the nodes keep the order of the file, reordering them would copy the network in every process
+      string order = nodeOrderToString(nodeOrderFromString(this->_props.getProperty("routing.node_order"), ORDER_ID));
+      if ( order != nodeOrderToString(this->_network.getNodeOrder()) ) {
+        cerr << "Nodes of " << filename_bin << " ordered by " << nodeOrderToString(this->_network.getNodeOrder()) << " instead of "
+             << order << " (see vbel-netconvert)" << endl;
+      }
+    }
+  } else {
 
-  // Parsing the node data
-  XMLElement * ele = doc.FirstChildElement("network")->FirstChildElement(
-      "nodes")->FirstChildElement("node");
-  const XMLAttribute * attr;
+    if ( !filename_bin.empty() && RepastProcess::instance()->rank() == 0 ) {
+      cerr << "Could not map " << filename_bin << ", reading " << filename << " instead (see vbel-netconvert)" << endl;
+    }
 
-  long id;
-  double x;
-  double y;
-  int ins;
+    if (this->isNodeReader()) this->read_network_xml();
 
-  double x_min = std::numeric_limits<float>::max();
-  double y_min = std::numeric_limits<float>::max();
-  double x_max = std::numeric_limits<float>::min();
-  double y_max = std::numeric_limits<float>::min();
+    // with shared data, the network parsed by the first process of the node is mapped by every process
+    if (this->_shared) {
 
-  while (ele) {
+      vector<char> image;
+      if (this->isNodeReader()) this->_network.writeBinary(image);
 
-    // reading id
-    attr = ele->FirstAttribute();
-    id = attr->IntValue();
+      Network network;
+      boost::shared_ptr<SharedSegment> segment = this->share_image("network", image);
+      if (segment && network.readBinary(segment->getData(), segment->getSize(), segment)) {
+        this->_network = network;
+        if (RepastProcess::instance()->rank() == 0) {
+          cout << "    Network shared by the processes of the node (" << segment->getSize() / 1048576 << " MB)" << endl;
+        }
+      }
+      // ... the sharing failed, every process parses the file
+      else if (!this->isNodeReader()) {
+        this->read_network_xml();
+      }
 
-    // reading x coordinate
-    attr = attr->Next();
-    x = attr->DoubleValue();
+    }
 
-    // determining min and max x coordinates
-    if( x < x_min ) x_min = x; else if( x > x_max ) x_max = x;
+  }
 
-    // reading y coordinate
-    attr = attr->Next();
-    y = attr->DoubleValue();
+  // Connected components (unreachable destinations, sampling restricted to the largest component)
+  this->_network.labelComponents();
 
-    // determining min and max y coordinates;
-    if( y < y_min ) y_min = y; else if( y > y_max ) y_max = y;
+  // Chains of shape nodes collapsed into single links for the Dijkstra searches
+  if (this->_props.getProperty("routing.contract_chains") == "y") this->_network.contractChains();
 
-    // finding ins code
-    ins = this->_map_node_ins[id];
+  // Spatial index of the nodes over the bounding box of the network
+  if (this->_props.getProperty("routing.spatial_grid") == "y") {
+    double nodes_by_cell = 4.0;
+    if (!this->_props.getProperty("routing.spatial_grid_nodes").empty()) {
+      nodes_by_cell = lexical_cast<double>(this->_props.getProperty("routing.spatial_grid_nodes"));
+    }
+    boost::shared_ptr<SpatialGrid> grid(new SpatialGrid());
+    grid->build(this->_network, nodes_by_cell);
+    this->_network.setSpatialGrid(grid);
+  }
 
-    // adding the node to the network
-    Node currNode(id, x, y, ins);
-    this->_network.addNode(currNode);
+  // Priority queue used by the network searches
+  this->_network.setQueueType(queueTypeFromString(this->_props.getProperty("routing.queue"), QUEUE_RADIX));
 
-    ele = ele->NextSiblingElement("node");
+  // Bidirectional point to point searches
+  this->_network.setBidirectional(this->_props.getProperty("routing.bidirectional") == "y");
 
+  if (RepastProcess::instance()->rank() == 0) {
+    cout << "    Network bounding box: x min " << this->_network.getMinX() << ", x max " << this->_network.getMaxX()
+         << ", y min " << this->_network.getMinY() << ", y max " << this->_network.getMaxY() << endl;
+    cout << "    Routing graph: " << this->_network.getGraph().getNbNodes() << " nodes, " << this->_network.getGraph().getNbLinks() << " links, "
+         << queueTypeToString(this->_network.getQueueType()) << " queue" << ( this->_network.isBidirectional() ? ", bidirectional searches" : "" )
+         << ", nodes ordered by " << nodeOrderToString(this->_network.getNodeOrder()) << endl;
+    cout << "    Strongly connected components: " << this->_network.getNbComponents() << ", the largest one has "
+         << this->_network.getLargestComponentSize() << " nodes ("
+         << 100.0 * this->_network.getLargestComponentSize() / std::max(this->_network.getNbNodes(), 1) << "%)" << endl;
+    if (this->_network.getChainContraction()) {
+      const ChainContraction & chains = *this->_network.getChainContraction();
+      cout << "    Contracted chains: " << chains.getNbInterior() << " shape nodes, the Dijkstra searches run on "
+           << chains.getCore().getNbLinks() << " links (longest contracted link " << chains.getMaxLength() << " m)" << endl;
+    }
+    if (this->_network.getSpatialGrid()) {
+      const SpatialGrid & grid = *this->_network.getSpatialGrid();
+      cout << "    Spatial grid: " << grid.getNbColumns() << " x " << grid.getNbRows() << " cells of " << grid.getCellSize()
+           << " m (smallest link length / euclidean distance ratio " << grid.getMinRatio() << ")" << endl;
+    }
   }
 
-  // Parsing the link data
-  ele = doc.FirstChildElement("network")->FirstChildElement("links")->FirstChildElement("link");
+}
 
-  long start_node;
-  long end_node;
-  float length;
+void Data::read_network_xml() {
 
-  while (ele) {
+  // ins code of the nodes
+  map<long, int> node_ins;
+  for (unsigned int k = 0; k < this->_ins_codes.size(); k++) {
+    for (int i = this->_ins_offsets[k]; i < this->_ins_offsets[k+1]; i++) {
+      node_ins.insert(make_pair(this->_ins_nodes[i], this->_ins_codes[k]));
+    }
+  }
 
-    // reading id
-    attr = ele->FirstAttribute();
-    id = attr->IntValue();
+  string filename = this->_props.getProperty("file.network");
+  if ( !this->_network.readXml(filename, node_ins) ) {
+    cerr << "Could not open " << filename << endl;
+  }
 
-    // reading starting node id
-    attr = attr->Next();
-    start_node = attr->IntValue();
+  // Order of the nodes in memory
+  NodeOrder order = nodeOrderFromString(this->_props.getProperty("routing.node_order"), ORDER_ID);
+  if ( order != this->_network.getNodeOrder() ) this->_network.reorder(order);
 
-    // reading ending node id
-    attr = attr->Next();
-    end_node = attr->IntValue();
+}
 
-    // ... and adding it to the list of end node of start node
-    this->_network.addLinkOutToNode(start_node, id);
+bool Data::share_routing_index(const string & filename, const string & name,
+                               const boost::function<bool ()> & load, const boost::function<void ()> & build,
+                               const boost::function<void ()> & rebuild, const boost::function<bool ()> & save) {
 
-    // reading lenght
-    attr = attr->Next();
-    length = attr->FloatValue();
+  int rank = RepastProcess::instance()->rank();
+  bool built = false;
 
-    // adding the link to the network
-    Link currLink(id, start_node, end_node, length);
-    this->_network.addLink(currLink);
+  // The first process builds the index if the cache file is missing or outdated...
+  if (rank == 0 && !load()) {
+    cout << "    Building " << name << " (" << filename << " missing or outdated)" << endl;
+    build();
+    built = true;
+    if (!save()) {
+      cerr << "Unable to write the " << name << " file " << filename << endl;
+    }
+  }
 
-    // moving to next link
-    ele = ele->NextSiblingElement("link");
+  // ... and the other ones read it
+  RepastProcess::instance()->getCommunicator()->barrier();
+  if (rank != 0 && !load()) {
+    rebuild();
+    built = true;
+  }
+
+  return built;
+
+}
 
+float Data::verify_routing_index(int & nbChecked) {
+
+  nbChecked = 0;
+  if (!this->_props.getProperty("routing.ch_verify").empty()) {
+    nbChecked = lexical_cast<int>(this->_props.getProperty("routing.ch_verify"));
   }
 
+  // Checking some random distances against the Dijkstra search on the first process...
+  const RoutingGraph & graph = this->_network.getGraph();
+  float max_error = 0.0;
   if (RepastProcess::instance()->rank() == 0) {
-    cout << "    Network bounding box: x min " << x_min << ", x max " << x_max << ", y min " << y_min << ", y max " << y_max << endl;
+    Ranq1 rng(0);
+    for (int q = 0; q < nbChecked && graph.getNbNodes() > 0; q++) {
+      long  source = graph.getId(rng.int32() % graph.getNbNodes());
+      long  dest   = graph.getId(rng.int32() % graph.getNbNodes());
+      float d      = this->_network.getDistanceNodes(source, dest);
+      float d_dij  = this->_network.getDistanceNodesDijkstra(source, dest);
+      if (d != d_dij) max_error = std::max(max_error, (float) fabs(d - d_dij) / std::max(d_dij, (float) 1.0));
+    }
+  }
+
+  // ... which decides for all of them
+  boost::mpi::broadcast(*RepastProcess::instance()->getCommunicator(), max_error, 0);
+
+  return max_error;
+
+}
+
+void Data::read_contraction_hierarchy() {
+
+  if (this->_props.getProperty("routing.ch") != "y") return;
+
+  int rank = RepastProcess::instance()->rank();
+  if (rank == 0) {
+    cout << "... reading contraction hierarchy" << endl;
+  }
+
+  const RoutingGraph & graph = this->_network.getGraph();
+  string filename = this->_props.getProperty("file.network") + ".ch";
+  boost::shared_ptr<ContractionHierarchy> ch(new ContractionHierarchy());
+  boost::function<void ()> build = boost::bind(&ContractionHierarchy::build, ch.get(), boost::cref(graph));
+  this->share_routing_index(filename, "contraction hierarchy",
+                            boost::bind(&ContractionHierarchy::load, ch.get(), filename, boost::cref(graph)),
+                            build, build,
+                            boost::bind(&ContractionHierarchy::save, ch.get(), filename));
+
+  this->_network.setContractionHierarchy(ch);
+  int n_verify = 0;
+  float max_error = this->verify_routing_index(n_verify);
+  if (max_error > 1e-4) {
+    if (rank == 0) cerr << "Contraction hierarchy distances differ from Dijkstra's ones (relative error " << max_error << "), hierarchy disabled" << endl;
+    this->_network.setContractionHierarchy(boost::shared_ptr<const ContractionHierarchy>());
+  }
+
+  if (rank == 0) {
+    cout << "    Contraction hierarchy: " << ch->getNbShortcuts() << " shortcuts";
+    if (n_verify > 0) cout << ", " << n_verify << " distances checked (max relative error " << max_error << ")";
+    cout << endl;
+  }
+
+}
+
+void Data::read_hub_labels() {
+
+  if (this->_props.getProperty("routing.hub_labels") != "y") return;
+
+  int rank = RepastProcess::instance()->rank();
+  const boost::shared_ptr<const ContractionHierarchy> & ch = this->_network.getContractionHierarchy();
+  if (!ch) {
+    if (rank == 0) cerr << "Hub labels require a contraction hierarchy (routing.ch), hub labels disabled" << endl;
+    return;
+  }
+  if (rank == 0) {
+    cout << "... reading hub labels" << endl;
+  }
+
+  const RoutingGraph & graph = this->_network.getGraph();
+  string filename = this->_props.getProperty("file.network") + ".hl";
+  int nb_threads = 1;
+  if (!this->_props.getProperty("routing.hub_labels_threads").empty()) {
+    nb_threads = std::max(1, lexical_cast<int>(this->_props.getProperty("routing.hub_labels_threads")));
+  }
+  boost::shared_ptr<HubLabels> labels(new HubLabels());
+
+  // only the first process checkpoints its build, an interrupted one is resumed from the .part file
+  bool built = this->share_routing_index(filename, "hub labels with " + lexical_cast<string>(nb_threads) + " threads",
+                                         boost::bind(&HubLabels::load, labels.get(), filename, boost::cref(graph)),
+                                         boost::bind(&HubLabels::build, labels.get(), boost::cref(*ch), nb_threads, filename + ".part"),
+                                         boost::bind(&HubLabels::build, labels.get(), boost::cref(*ch), nb_threads, string()),
+                                         boost::bind(&HubLabels::save, labels.get(), filename));
+  if (rank == 0 && built) labels->writeStatistics(cout, "    ");
+
+  this->_network.setHubLabels(labels);
+  int n_verify = 0;
+  float max_error = this->verify_routing_index(n_verify);
+  if (max_error > 1e-4) {
+    if (rank == 0) cerr << "Hub labels distances differ from Dijkstra's ones (relative error " << max_error << "), hub labels disabled" << endl;
+    this->_network.setHubLabels(boost::shared_ptr<const HubLabels>());
+  }
+
+  if (rank == 0) {
+    cout << "    Hub labels: " << labels->getAverageSize() << " hubs by label on average (max " << labels->getMaxSize() << "), "
+         << labels->getNbBytes() / (1024 * 1024) << " MB";
+    if (n_verify > 0) cout << ", " << n_verify << " distances checked (max relative error " << max_error << ")";
+    cout << endl;
+  }
+
+}
+
+void Data::read_landmarks() {
+
+  // the contraction hierarchy answers the distance queries without landmarks
+  if (this->_props.getProperty("routing.alt") != "y" || this->_network.getContractionHierarchy()) return;
+
+  int rank = RepastProcess::instance()->rank();
+  if (rank == 0) {
+    cout << "... reading landmark distance tables" << endl;
+  }
+
+  const RoutingGraph & graph = this->_network.getGraph();
+  string filename = this->_props.getProperty("file.network") + ".alt";
+  int nb_landmarks = 16;
+  if (!this->_props.getProperty("routing.alt_landmarks").empty()) {
+    nb_landmarks = lexical_cast<int>(this->_props.getProperty("routing.alt_landmarks"));
+  }
+  boost::shared_ptr<LandmarkTable> landmarks(new LandmarkTable());
+  boost::function<void ()> build = boost::bind(&LandmarkTable::build, landmarks.get(), boost::cref(graph),
+                                               boost::cref(this->_network.getReverseGraph()), nb_landmarks);
+  this->share_routing_index(filename, "landmark tables of " + lexical_cast<string>(nb_landmarks) + " landmarks",
+                            boost::bind(&LandmarkTable::load, landmarks.get(), filename, boost::cref(graph), nb_landmarks),
+                            build, build,
+                            boost::bind(&LandmarkTable::save, landmarks.get(), filename));
+
+  this->_network.setLandmarkTable(landmarks);
+  int n_verify = 0;
+  float max_error = this->verify_routing_index(n_verify);
+  if (max_error > 1e-4) {
+    if (rank == 0) cerr << "Landmark distances differ from Dijkstra's ones (relative error " << max_error << "), landmarks disabled" << endl;
+    this->_network.setLandmarkTable(boost::shared_ptr<const LandmarkTable>());
+  }
+
+  if (rank == 0) {
+    cout << "    Landmarks: " << landmarks->getNbLandmarks() << " landmarks";
+    if (n_verify > 0) cout << ", " << n_verify << " distances checked (max relative error " << max_error << ")";
+    cout << endl;
+  }
+
+}
+
+void Data::read_detour_factors() {
+
+  if (this->_props.getProperty("routing.fast_distance") != "y") return;
+
+  int rank = RepastProcess::instance()->rank();
+  if (rank == 0) {
+    cout << "... calibrating fast distance detour factors" << endl;
+  }
+
+  int n_sources = 2;
+  int n_min     = 2;
+  int n_checks  = 1000;
+  if (!this->_props.getProperty("routing.fast_distance_sources").empty()) {
+    n_sources = lexical_cast<int>(this->_props.getProperty("routing.fast_distance_sources"));
+  }
+  if (!this->_props.getProperty("routing.fast_distance_min_samples").empty()) {
+    n_min = lexical_cast<int>(this->_props.getProperty("routing.fast_distance_min_samples"));
+  }
+  if (!this->_props.getProperty("routing.fast_distance_checks").empty()) {
+    n_checks = lexical_cast<int>(this->_props.getProperty("routing.fast_distance_checks"));
+  }
+  boost::shared_ptr<DetourTable> detours(new DetourTable());
+  detours->init(this->_network);
+
+  // Each process samples a share of the origin municipalities (one generator by municipality, so that
+  // the factors do not depend on the number of processes)...
+  mpi::communicator * comm = RepastProcess::instance()->getCommunicator();
+  int n_mun = detours->getNbMunicipalities();
+  for (int mun = rank; mun < n_mun; mun += RepastProcess::instance()->worldSize()) {
+    Ranq1 rng(mun + 1);
+    detours->addSamples(this->_network, mun, n_sources, rng);
+  }
+
+  // ... and the samples are added
+  vector<double> & sums   = detours->getSampleSums();
+  vector<double> & counts = detours->getSampleCounts();
+  if (!sums.empty()) {
+    vector<double> total(sums.size());
+    mpi::all_reduce(*comm, &sums[0], sums.size(), &total[0], std::plus<double>());
+    sums.swap(total);
+    mpi::all_reduce(*comm, &counts[0], counts.size(), &total[0], std::plus<double>());
+    counts.swap(total);
+  }
+  detours->computeFactors(n_min);
+  this->_routing.setDetourTable(detours);
+
+  // Measuring the error of the approximate distances
+  if (rank == 0) {
+    Ranq1 rng(0);
+    vector<float> errors = detours->measureErrors(this->_network, n_checks, rng);
+    double mean = 0.0;
+    for (unsigned int k = 0; k < errors.size(); k++) mean += errors[k];
+    if (!errors.empty()) mean /= errors.size();
+    const double levels[] = {0.5, 0.9, 0.95, 0.99, 1.0};
+    vector<float> quantiles;
+    for (int l = 0; l < 5; l++) {
+      quantiles.push_back(errors.empty() ? 0.0 : errors[std::min(errors.size() - 1, (size_t) (levels[l] * errors.size()))]);
+    }
+
+    cout << "    Fast distances: " << detours->getNbCalibrated() << " / " << n_mun * n_mun << " pairs of municipalities calibrated"
+         << " (network detour factor " << detours->getGlobalFactor() << ")" << endl;
+    cout << "    Relative error on " << errors.size() << " random distances: mean " << mean << ", median " << quantiles[0]
+         << ", 90% " << quantiles[1] << ", 95% " << quantiles[2] << ", 99% " << quantiles[3] << ", max " << quantiles[4] << endl;
+
+    ofstream log_file("../logs/log_fast_distance.csv", ios::out | ios::app);
+    if ( log_file.tellp() == 0 ) {  // header of a new log file
+      log_file << "network;n_sources;n_calibrated;detour_factor;n_queries;mean_error;median_error;p90_error;p95_error;p99_error;max_error" << endl;
+    }
+    log_file << this->_props.getProperty("file.network") << ";" << n_sources << ";" << detours->getNbCalibrated() << ";" << detours->getGlobalFactor()
+             << ";" << errors.size() << ";" << mean;
+    for (int l = 0; l < 5; l++) log_file << ";" << quantiles[l];
+    log_file << endl;
   }
 
 }
@@ -344,6 +787,53 @@ void Data::read_distribution_parameters_distance() {
 
 
 
+void Data::read_ring_index() {
+
+  if (this->_props.getProperty("routing.ring_index") != "y") return;
+
+  if (RepastProcess::instance()->rank() == 0) {
+    cout << "... reading distance ring index" << endl;
+  }
+
+  // The rings cover the largest distance that can be drawn for an activity
+  float radius = 0.0;
+  for (map<int, dist_param>::const_iterator it = this->_map_act_dist_par_dist.begin(); it != this->_map_act_dist_par_dist.end(); it++) {
+    radius = std::max(radius, it->second.max);
+  }
+
+  int    min_uses = 3;
+  double budget   = 256.0;
+  if (!this->_props.getProperty("routing.ring_index_min_uses").empty()) {
+    min_uses = lexical_cast<int>(this->_props.getProperty("routing.ring_index_min_uses"));
+  }
+  if (!this->_props.getProperty("routing.ring_index_mb").empty()) {
+    budget = lexical_cast<double>(this->_props.getProperty("routing.ring_index_mb"));
+  }
+  boost::shared_ptr<DistanceRingIndex> rings(new DistanceRingIndex(radius, min_uses, (size_t) (budget * 1024.0 * 1024.0)));
+
+  string filename = this->_props.getProperty("file.network") + ".rings";
+  bool loaded = rings->load(filename, this->_network.getGraph());
+  this->_network.setDistanceRingIndex(rings);
+
+  if (RepastProcess::instance()->rank() == 0) {
+    if (loaded) cout << "    Distance ring index: " << rings->getNbRings() << " source nodes read from " << filename << endl;
+    else        cout << "    Distance ring index: empty (" << filename << " missing or outdated)" << endl;
+  }
+
+}
+
+void Data::save_ring_index() const {
+
+  const boost::shared_ptr<DistanceRingIndex> & rings = this->_network.getDistanceRingIndex();
+  if (!rings || !rings->isModified()) return;
+
+  string filename = this->_props.getProperty("file.network") + ".rings";
+  if (!rings->save(filename, this->_network.getGraph())) {
+    cerr << "Unable to write the distance ring index file " << filename << endl;
+  }
+
+}
+
 void Data::read_distribution_parameters_start_duration(){
 
   if (RepastProcess::instance()->rank() == 0 ) {
@@ -374,8 +864,7 @@ void Data::read_distribution_parameters_start_duration(){
       size    = (int) data[1];
 
       dist_param_mixture_2d dist;        // parameter of the mixture of bivariate distribution performed
-      dist.components.resize(size);
-      dist.p.resize(size);
+      dist.resize(size);
 
       #ifdef DEBUGVBDATA
         cout << "DATA for " << codeInt << endl;
@@ -411,6 +900,7 @@ void Data::read_distribution_parameters_start_duration(){
         cout << " max     " << dist.max[0] << " " << dist.max[1] << endl;
       #endif
 
+      dist.buildAlias();
       this->_map_act_start_x_dur.insert(make_pair(codeInt,dist));
 
     }
@@ -423,6 +913,70 @@ void Data::read_distribution_parameters_start_duration(){
 
 }
 
+namespace {
+
+  // Mixture of the second variable of a mixture of bivariate normal distributions, conditional to a value of the first one
+  void conditionalMixture(const dist_param_mixture_2d & dist, float x, dist_param_mixture & result) {
+
+    result.resize(dist.size);
+    result.max = dist.max[1];
+
+    for( int i = 0; i < dist.size; i++ ) {
+
+      result.p[i]          = dist.p[i];
+      result.alias_prob[i] = dist.alias_prob[i];
+      result.alias[i]      = dist.alias[i];
+
+      float mu_1     = dist.components[i].mu[0];
+      float mu_2     = dist.components[i].mu[1];
+      float sigma_11 = dist.components[i].sigma[0];
+      float sigma_12 = dist.components[i].sigma[1];
+      float sigma_22 = dist.components[i].sigma[2];
+
+      result.mu[i]    = mu_2 + (sigma_12 / sigma_11) * (x - mu_1);
+      result.sigma[i] = sigma_22 - ( ( sigma_12 * sigma_12) / sigma_11 );
+
+    }
+
+  }
+
+}
+
+void Data::tabulate_act_duration_condi_start() {
+
+  this->_act_start_bin     = 60;
+  if (!this->_props.getProperty("par.act_start_bin").empty()) {
+    this->_act_start_bin = max(lexical_cast<int>(this->_props.getProperty("par.act_start_bin")), 1);
+  }
+  this->_act_start_nb_bins = ( ACT_START_TIME_MAX + this->_act_start_bin - 1 ) / this->_act_start_bin;
+
+  // One row of bins by activity type read, indexed by the integer coding of the activity
+  int max_code = -1;
+  for( map<int, dist_param_mixture_2d>::const_iterator it = this->_map_act_start_x_dur.begin(); it != this->_map_act_start_x_dur.end(); ++it ) {
+    max_code = max(max_code, it->first);
+  }
+  this->_act_dur_condi_start_row.assign(max_code + 1, -1);
+  this->_act_dur_condi_start.clear();
+  this->_act_dur_condi_start.resize(this->_map_act_start_x_dur.size() * this->_act_start_nb_bins);
+
+  int row = 0;
+  for( map<int, dist_param_mixture_2d>::const_iterator it = this->_map_act_start_x_dur.begin(); it != this->_map_act_start_x_dur.end(); ++it ) {
+    if ( it->first < 0 ) continue;
+    this->_act_dur_condi_start_row[it->first] = row;
+    for( int b = 0; b < this->_act_start_nb_bins; b++ ) {
+      conditionalMixture(it->second, log((b + 0.5) * this->_act_start_bin), this->_act_dur_condi_start[row + b]);  // log transform for the starting time
+    }
+    row += this->_act_start_nb_bins;
+  }
+
+  if (RepastProcess::instance()->rank() == 0 ) {
+    cout << "... tabulating activities duration distribution parameters conditional to the starting time" << endl;
+    cout << "    Bins: " << this->_map_act_start_x_dur.size() << " activity types x " << this->_act_start_nb_bins
+         << " starting times of " << this->_act_start_bin << " s" << endl;
+  }
+
+}
+
 void Data::read_distribution_parameters_distance_x_duration_trip() {
 
   if (RepastProcess::instance()->rank() == 0 ) {
@@ -447,8 +1001,7 @@ void Data::read_distribution_parameters_distance_x_duration_trip() {
      data = split<float>(a_line, ";");
      size = (int) data[0];               // size of the mixture
 
-     dist.components.resize(size);       // memory reservation
-     dist.p.resize(size);
+     dist.resize(size);                  // number of components
 
      for( int i = 0; i < size; i++ ) {
 
@@ -481,6 +1034,7 @@ void Data::read_distribution_parameters_distance_x_duration_trip() {
        cout << " max     " << dist.max[0] << " " << dist.max[1] << endl;
      #endif
 
+     dist.buildAlias();
      this->_act_dist_x_dur_trip_dist = dist;
 
      // closing file
@@ -491,7 +1045,17 @@ void Data::read_distribution_parameters_distance_x_duration_trip() {
 
 }
 
+void Data::init_duration_condi_dist_trip() {
 
+  const dist_param_mixture_2d & dist = this->_act_dist_x_dur_trip_dist;
+
+  // Parameters at log(distance) = 0, only the means depend on the distance
+  conditionalMixture(dist, 0.0, this->_trip_dur_condi_dist);
+  for( int i = 0; i < dist.size; i++ ) {
+    this->_trip_dur_slope[i] = dist.components[i].sigma[1] / dist.components[i].sigma[0];  // S_12 / S_11
+  }
+
+}
 
 void Data::read_distribution_parameters_house_tdep() {
 
@@ -522,9 +1086,7 @@ void Data::read_distribution_parameters_house_tdep() {
       codeInt    = (int) data[0];         // integer code of purpose
       size       = (int) data[1];         // size of the mixture
 
-      dist.mu.resize(size);
-      dist.sigma.resize(size);
-      dist.p.resize(size);
+      dist.resize(size);
 
       for( int i = 0; i < size; i++ ) {
         dist.mu[i]    = data[2+i];        // vector of means
@@ -535,6 +1097,7 @@ void Data::read_distribution_parameters_house_tdep() {
       dist.max = data[2+3*size];          // upper bound
 
       // adding the distribution parameters to the simulation data
+      dist.buildAlias();
       this->_map_act_tdep_par_dist.insert(make_pair(codeInt, dist));
 
     }
@@ -619,6 +1182,18 @@ vector<long int> Data::getMunAge(int municipality, char gender) {
 
 }
 
+int Data::drawMunAge(int municipality, char gender, int ageClass) {
+
+  const map<int, vector<AliasTable> > & tables = ( gender == 'M' ) ? this->_mun_age_men_alias : this->_mun_age_women_alias;
+  map<int, vector<AliasTable> >::const_iterator it = tables.find(municipality);
+  if ( it == tables.end() || ageClass < 0 || ageClass >= NB_AGE_CLASSES || it->second[ageClass].empty() ) {
+    cerr << "No age distribution for municipality " << municipality << " and age class " << ageClass << endl;
+    return -1;
+  }
+  return AGE_CLASS_FIRST[ageClass] + it->second[ageClass].draw(RandomGenerators::getInstance()->fast_unif.doub());
+
+}
+
 float Data::getDeathProba(char gender, int age) {
 
   if (gender == 'M') { return _death_age_men[age];   }                         // Men
@@ -638,11 +1213,12 @@ vector<long> Data::getNodesIdFromIns(int aIns) {
 
   vector<long> result;
 
-  typedef multimap<int, long>::const_iterator Iter;
-  pair<Iter, Iter> it = this->_map_ins_node.equal_range(aIns);
-
-  for (Iter i = it.first; i != it.second; i++) {
-    result.push_back(i->second);
+  const int * it = lower_bound(this->_ins_codes.begin(), this->_ins_codes.end(), aIns);
+  if (it != this->_ins_codes.end() && *it == aIns) {
+    int k = it - this->_ins_codes.begin();
+    for (int i = this->_ins_offsets[k]; i < this->_ins_offsets[k+1]; i++) {
+      result.push_back(this->_ins_nodes[i]);
+    }
   }
 
   return result;
@@ -651,18 +1227,17 @@ vector<long> Data::getNodesIdFromIns(int aIns) {
 
 long Data::getOneNodeIdFromIns(int aIns) {
 
-  long result = -1;
-  vector<long> list_node_id = this->getNodesIdFromIns(aIns);
-
-  try {
-    result = list_node_id[draw_discrete(list_node_id)];
-  }
-  catch ( const std::exception & e )
-  {
-    std::cerr << e.what() << "- no nodes for ins " << aIns << endl;
+  const int * it = lower_bound(this->_ins_codes.begin(), this->_ins_codes.end(), aIns);
+  if (it == this->_ins_codes.end() || *it != aIns) {
+    cerr << "No nodes for ins " << aIns << endl;
+    return -1;
   }
 
-  return result;
+  // uniform draw among the nodes kept by index_ins_node_draws()
+  int k = it - this->_ins_codes.begin();
+  int n = this->_ins_draw_offsets[k+1] - this->_ins_draw_offsets[k];
+  int i = std::min((int) (RandomGenerators::getInstance()->fast_unif.doub() * n), n - 1);
+  return this->_ins_draw_nodes[this->_ins_draw_offsets[k] + i];
 
 }
 
@@ -672,60 +1247,20 @@ dist_param Data::getActDistParDist(int aActivityType) {
 
 }
 
-dist_param_mixture Data::getActHouseTDepParDist(int aActivityType ) {
+const dist_param_mixture & Data::getActHouseTDepParDist(int aActivityType ) {
 
   return this->_map_act_tdep_par_dist[aActivityType];
 
 }
 
-dist_param_mixture Data::getActDurationCondiStartParDist(int aActivityType, int aStartTime) {
-
-  dist_param_mixture result;
-
-  result.mu.resize(this->_map_act_start_x_dur[aActivityType].p.size());
-  result.sigma.resize(this->_map_act_start_x_dur[aActivityType].p.size());
-
-  result.max = this->_map_act_start_x_dur[aActivityType].max[1];
-  result.p   = this->_map_act_start_x_dur[aActivityType].p;
-
-  for( unsigned int i = 0; i < this->_map_act_start_x_dur[aActivityType].p.size(); i++ ) {
-
-    float mu_1     = this->_map_act_start_x_dur[aActivityType].components[i].mu[0];
-    float mu_2     = this->_map_act_start_x_dur[aActivityType].components[i].mu[1];
-    float sigma_11 = this->_map_act_start_x_dur[aActivityType].components[i].sigma[0];
-    float sigma_12 = this->_map_act_start_x_dur[aActivityType].components[i].sigma[1];
-    float sigma_22 = this->_map_act_start_x_dur[aActivityType].components[i].sigma[2];
-
-    result.mu[i]    = mu_2 + (sigma_12 / sigma_11) * (log(aStartTime) - mu_1);  // log transform for aStartTime
-    result.sigma[i] = sigma_22 - ( ( sigma_12 * sigma_12) / sigma_11 );
-
-  }
-
-  return result;
-
-}
-
-dist_param_mixture Data::getDurationCondiDistTripParDist(int aDistance) {
-
-  dist_param_mixture result;
-
-  result.mu.resize(this->_act_dist_x_dur_trip_dist.p.size());
-  result.sigma.resize(this->_act_dist_x_dur_trip_dist.p.size());
-
-  result.max = this->_act_dist_x_dur_trip_dist.max[1];
-  result.p   = this->_act_dist_x_dur_trip_dist.p;
-
-  for( unsigned int i = 0; i < this->_act_dist_x_dur_trip_dist.p.size(); i++ ) {
-
-    float mu_1     = this->_act_dist_x_dur_trip_dist.components[i].mu[0];
-    float mu_2     = this->_act_dist_x_dur_trip_dist.components[i].mu[1];
-    float sigma_11 = this->_act_dist_x_dur_trip_dist.components[i].sigma[0];
-    float sigma_12 = this->_act_dist_x_dur_trip_dist.components[i].sigma[1];
-    float sigma_22 = this->_act_dist_x_dur_trip_dist.components[i].sigma[2];
+dist_param_mixture Data::getDurationCondiDistTripParDist(int aDistance) const {
 
-    result.mu[i]    = mu_2 + (sigma_12 / sigma_11) * (log(aDistance) - mu_1);  // log transform for aDistance
-    result.sigma[i] = sigma_22 - ( ( sigma_12 * sigma_12) / sigma_11 );
+  // log transform for aDistance, the distances under 1 meter are taken as 1 meter
+  float x = log((double) max(aDistance, 1));
 
+  dist_param_mixture result(this->_trip_dur_condi_dist);
+  for( int i = 0; i < result.size; i++ ) {
+    result.mu[i] += this->_trip_dur_slope[i] * x;
   }
 
   return result;
@@ -0,0 +1,180 @@
+/****************************************************************
+ * DETOURTABLE.CPP
+ *
+ * This file contains all the definitions of the methods of
+ * DetourTable.hpp (see this file for methods' documentation)
+ *
+ * Authors: J. Barthelemy
+ * Date   : 18 october 2013
+ ****************************************************************/
+
+#include "../include/DetourTable.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+
+using namespace std;
+
+const double DETOUR_MIN_EUCLIDEAN = 50.0;   // euclidean distance (meters) below which a pair of nodes is not sampled
+const int    DETOUR_NODE_DRAWS    = 10;     // number of draws of a node in the largest component before accepting any node
+
+namespace {
+
+  // Draw a node of a municipality, in the largest component of the network if possible
+  int drawNode(const Network & network, const vector<int> & nodes, int first, int last, Ranq1 & rng) {
+
+    int i = nodes[first + rng.int32() % (last - first)];
+    for (int k = 1; k < DETOUR_NODE_DRAWS && !network.isInLargestComponentIndex(i); k++) {
+      i = nodes[first + rng.int32() % (last - first)];
+    }
+    return i;
+
+  }
+
+}
+
+// Index the municipalities of the nodes of a road network
+void DetourTable::init(const Network & network) {
+
+  const RoutingGraph & g = network.getGraph();
+  int n = g.getNbNodes();
+
+  this->_ins.clear();
+  for (int i = 0; i < n; i++) {
+    if ( network.getNodeInsIndex(i) > 0 ) this->_ins.push_back(network.getNodeInsIndex(i));
+  }
+  sort(this->_ins.begin(), this->_ins.end());
+  this->_ins.erase(unique(this->_ins.begin(), this->_ins.end()), this->_ins.end());
+  int m = this->_ins.size();
+
+  this->_node_mun.assign(n, -1);
+  this->_mun_first.assign(m + 1, 0);
+  for (int i = 0; i < n; i++) {
+    if ( network.getNodeInsIndex(i) <= 0 ) continue;
+    this->_node_mun[i] = lower_bound(this->_ins.begin(), this->_ins.end(), network.getNodeInsIndex(i)) - this->_ins.begin();
+    this->_mun_first[this->_node_mun[i] + 1]++;
+  }
+  for (int k = 0; k < m; k++) this->_mun_first[k + 1] += this->_mun_first[k];
+  this->_mun_nodes.resize(this->_mun_first[m]);
+  vector<int> next_pos(this->_mun_first.begin(), this->_mun_first.end() - 1);
+  for (int i = 0; i < n; i++) {
+    if ( this->_node_mun[i] >= 0 ) this->_mun_nodes[next_pos[this->_node_mun[i]]++] = i;
+  }
+
+  this->_log_sums.assign((size_t) m * m, 0.0);
+  this->_counts.assign((size_t) m * m, 0.0);
+  this->_factors.assign((size_t) m * m, 1.0);
+  this->_global_factor = 1.0;
+  this->_nb_calibrated = 0;
+
+}
+
+// Sample the detour ratios from the nodes of a municipality
+void DetourTable::addSamples(const Network & network, int mun, int nbSources, Ranq1 & rng) {
+
+  const RoutingGraph & g = network.getGraph();
+  int m = this->_ins.size();
+  if ( this->_mun_first[mun] == this->_mun_first[mun + 1] ) return;
+
+  vector<int>  targets(m);
+  vector<long> target_ids(m);
+  for (int q = 0; q < nbSources; q++) {
+
+    // ... a search from a node of the municipality to a node of every municipality
+    int source = drawNode(network, this->_mun_nodes, this->_mun_first[mun], this->_mun_first[mun + 1], rng);
+    for (int k = 0; k < m; k++) {
+      targets[k]    = drawNode(network, this->_mun_nodes, this->_mun_first[k], this->_mun_first[k + 1], rng);
+      target_ids[k] = g.getId(targets[k]);
+    }
+    vector<float> dists = network.getDistancesFromSource(g.getId(source), target_ids);
+
+    // ... giving the ratio between the network and the euclidean distances of every pair
+    for (int k = 0; k < m; k++) {
+      double euclidean = hypot(network.getNodeXIndex(targets[k]) - network.getNodeXIndex(source),
+                               network.getNodeYIndex(targets[k]) - network.getNodeYIndex(source));
+      if ( dists[k] == numeric_limits<float>::max() || euclidean < DETOUR_MIN_EUCLIDEAN ) continue;
+      this->_log_sums[(size_t) mun * m + k] += log(dists[k] / euclidean);
+      this->_counts[(size_t) mun * m + k]   += 1.0;
+    }
+
+  }
+
+}
+
+// Compute the detour factors from the samples
+void DetourTable::computeFactors(int minSamples) {
+
+  int    m = this->_ins.size();
+  double min_count = max(minSamples, 1);
+
+  // Factor of the whole network...
+  double total_sum = 0.0, total_count = 0.0;
+  for (size_t p = 0; p < this->_counts.size(); p++) {
+    total_sum   += this->_log_sums[p];
+    total_count += this->_counts[p];
+  }
+  this->_global_factor = ( total_count > 0.0 ) ? exp(total_sum / total_count) : 1.0;
+
+  // ... of each origin municipality and of each pair of municipalities
+  this->_nb_calibrated = 0;
+  for (int o = 0; o < m; o++) {
+    double row_sum = 0.0, row_count = 0.0;
+    for (int d = 0; d < m; d++) {
+      row_sum   += this->_log_sums[(size_t) o * m + d];
+      row_count += this->_counts[(size_t) o * m + d];
+    }
+    float origin_factor = ( row_count >= min_count ) ? exp(row_sum / row_count) : this->_global_factor;
+    for (int d = 0; d < m; d++) {
+      size_t p = (size_t) o * m + d;
+      if ( this->_counts[p] >= min_count ) {
+        this->_factors[p] = exp(this->_log_sums[p] / this->_counts[p]);
+        this->_nb_calibrated++;
+      } else {
+        this->_factors[p] = origin_factor;
+      }
+    }
+  }
+
+}
+
+// Measure the relative errors of the approximate distances
+vector<float> DetourTable::measureErrors(const Network & network, int nbQueries, Ranq1 & rng) const {
+
+  const RoutingGraph & g = network.getGraph();
+  vector<float> errors;
+  for (int q = 0; q < nbQueries && g.getNbNodes() > 0; q++) {
+    int   source = rng.int32() % g.getNbNodes();
+    int   dest   = rng.int32() % g.getNbNodes();
+    float exact  = network.getDistanceNodes(g.getId(source), g.getId(dest));
+    if ( exact == numeric_limits<float>::max() || exact <= 0.0 ) continue;
+    errors.push_back(fabs(this->distanceIndex(network, source, dest) - exact) / exact);
+  }
+  sort(errors.begin(), errors.end());
+  return errors;
+
+}
+
+// Approximate the distance between two nodes
+float DetourTable::distance(const Network & network, long source_id, long dest_id) const {
+
+  int source = network.getGraph().getIndex(source_id);
+  int dest   = network.getGraph().getIndex(dest_id);
+  if (source < 0 || dest < 0) throw std::out_of_range("DetourTable::distance: unknown node id");
+  if (!network.mayReach(source_id, dest_id)) return numeric_limits<float>::max();
+  return this->distanceIndex(network, source, dest);
+
+}
+
+// Approximate the distance between two nodes (node indices)
+float DetourTable::distanceIndex(const Network & network, int source, int dest) const {
+
+  double euclidean = hypot(network.getNodeXIndex(dest) - network.getNodeXIndex(source),
+                           network.getNodeYIndex(dest) - network.getNodeYIndex(source));
+  int o = this->_node_mun[source];
+  int d = this->_node_mun[dest];
+  if ( o < 0 || d < 0 ) return euclidean * this->_global_factor;
+  return euclidean * this->_factors[(size_t) o * this->_ins.size() + d];
+
+}
@@ -0,0 +1,178 @@
+/****************************************************************
+ * DISTANCERINGINDEX.CPP
+ *
+ * This file contains all the definitions of the methods of
+ * DistanceRingIndex.hpp (see this file for methods' documentation)
+ *
+ * Authors: J. Barthelemy
+ * Date   : 27 september 2013
+ ****************************************************************/
+
+#include "../include/DistanceRingIndex.hpp"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+
+using namespace std;
+
+const char         RING_FILE_MAGIC[4] = {'V', 'B', 'R', 'I'};  // first bytes of an index file
+const unsigned int RING_FILE_VERSION  = 2;                     // version of the index file format
+
+// Constructor
+DistanceRingIndex::DistanceRingIndex(float radius, int minUses, size_t budget) : _radius(radius), _min_uses(minUses),
+    _budget(budget), _memory(0), _rings(), _uses(), _modified(false), _mutex() {
+}
+
+// Build the ring of a source node: Dijkstra search up to the radius
+void DistanceRingIndex::build(const Network & network, int source) {
+
+  const RoutingGraph & g = network.getGraph();
+  DijkstraWorkspace<RadixHeapQueue> & ws = DijkstraWorkspace<RadixHeapQueue>::local();
+
+  ws.init(g);
+  ws.relax(source, 0.0);
+  while( ws.hasNext() && ws.nextDist() <= this->_radius ) {
+    float d = ws.nextDist();
+    int   i = ws.next();
+    for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+      int j = g.getTarget(e);
+      if ( ws.isSettled(j) == false ) ws.relax(j, d + g.getLength(e));
+    }
+  }
+
+  // the settled nodes are already sorted by distance (keeping those of the largest component if any)
+  const vector<int> & settled = ws.getSettledOrder();
+  bool largest = false;
+  for (unsigned int k = 0; k < settled.size() && !largest; k++) largest = network.isInLargestComponentIndex(settled[k]);
+  vector<RingEntry> & ring = this->_rings[source];
+  ring.reserve(settled.size());
+  for (unsigned int k = 0; k < settled.size(); k++) {
+    if ( largest && !network.isInLargestComponentIndex(settled[k]) ) continue;
+    RingEntry entry = {ws.getDist(settled[k]), settled[k]};
+    ring.push_back(entry);
+  }
+  if (largest) vector<RingEntry>(ring).swap(ring);   // releasing the entries reserved for the filtered nodes
+
+  this->_memory  += ring.size() * sizeof(RingEntry);
+  this->_modified = true;
+
+}
+
+// Draw a destination node at a given distance from a source node
+bool DistanceRingIndex::sample(const Network & network, int source, float dist, Ranq1 & rng, long & dest) {
+
+  const RoutingGraph & g = network.getGraph();
+
+  // the source node is already indexed
+  {
+    boost::shared_lock<boost::shared_mutex> lock(this->_mutex);
+    boost::unordered_map<int, vector<RingEntry> >::const_iterator it = this->_rings.find(source);
+    if (it != this->_rings.end()) return this->sampleRing(g, it->second, dist, rng, dest);
+  }
+
+  // indexing the source node if it is used often enough
+  boost::unique_lock<boost::shared_mutex> lock(this->_mutex);
+  boost::unordered_map<int, vector<RingEntry> >::const_iterator it = this->_rings.find(source);
+  if (it == this->_rings.end()) {
+    int & uses = this->_uses[source];
+    uses++;
+    if (uses < this->_min_uses || this->_memory >= this->_budget) return false;
+    this->_uses.erase(source);
+    this->build(network, source);
+    it = this->_rings.find(source);
+  }
+  return this->sampleRing(g, it->second, dist, rng, dest);
+
+}
+
+// Draw a destination node in a ring
+bool DistanceRingIndex::sampleRing(const RoutingGraph & g, const vector<RingEntry> & ring, float dist, Ranq1 & rng, long & dest) const {
+
+  // nodes whose distance lies in ]dist - epsilon, dist + epsilon[, epsilon being increased until one is found
+  float epsilon = 250.0;
+  while (true) {
+
+    vector<RingEntry>::const_iterator first = upper_bound(ring.begin(), ring.end(), dist - epsilon, DistanceRingIndex::distBefore);
+    vector<RingEntry>::const_iterator last  = lower_bound(first, ring.end(), dist + epsilon, DistanceRingIndex::distAfter);
+    if (last > first) {
+      unsigned int index = rng.int32() % (last - first);
+      dest = g.getId(first[index].node);
+      return true;
+    }
+
+    // ... the ring does not contain the nodes farther than the radius
+    if (dist + epsilon > this->_radius) return false;
+    epsilon = epsilon * 2.0;
+
+  }
+
+}
+
+// Write the index to a binary file
+bool DistanceRingIndex::save(const std::string & filename, const RoutingGraph & g) const {
+
+  boost::shared_lock<boost::shared_mutex> lock(this->_mutex);
+
+  ofstream file(filename.c_str(), ios::out | ios::binary);
+  if (!file) return false;
+
+  unsigned long long checksum = g.getChecksum();
+  unsigned long long n_rings  = this->_rings.size();
+  file.write(RING_FILE_MAGIC, sizeof(RING_FILE_MAGIC));
+  file.write((const char *) &RING_FILE_VERSION, sizeof(RING_FILE_VERSION));
+  file.write((const char *) &checksum, sizeof(checksum));
+  file.write((const char *) &this->_radius, sizeof(this->_radius));
+  file.write((const char *) &n_rings, sizeof(n_rings));
+
+  for (boost::unordered_map<int, vector<RingEntry> >::const_iterator it = this->_rings.begin(); it != this->_rings.end(); it++) {
+    unsigned long long size = it->second.size();
+    file.write((const char *) &it->first, sizeof(int));
+    file.write((const char *) &size, sizeof(size));
+    if (size > 0) file.write((const char *) &it->second[0], size * sizeof(RingEntry));
+  }
+
+  return (bool) file;
+
+}
+
+// Read an index written by save()
+bool DistanceRingIndex::load(const std::string & filename, const RoutingGraph & g) {
+
+  boost::unique_lock<boost::shared_mutex> lock(this->_mutex);
+
+  ifstream file(filename.c_str(), ios::in | ios::binary);
+  if (!file) return false;
+
+  char magic[sizeof(RING_FILE_MAGIC)];
+  unsigned int version = 0;
+  unsigned long long checksum = 0;
+  float radius = 0.0;
+  unsigned long long n_rings = 0;
+  file.read(magic, sizeof(magic));
+  file.read((char *) &version, sizeof(version));
+  file.read((char *) &checksum, sizeof(checksum));
+  file.read((char *) &radius, sizeof(radius));
+  file.read((char *) &n_rings, sizeof(n_rings));
+  if ( !file || memcmp(magic, RING_FILE_MAGIC, sizeof(magic)) != 0 || version != RING_FILE_VERSION
+       || checksum != g.getChecksum() || radius != this->_radius ) return false;
+
+  for (unsigned long long r = 0; r < n_rings && this->_memory < this->_budget; r++) {
+    int source = 0;
+    unsigned long long size = 0;
+    file.read((char *) &source, sizeof(source));
+    file.read((char *) &size, sizeof(size));
+    if ( !file || source < 0 || source >= g.getNbNodes() || size > (unsigned long long) g.getNbNodes() ) return false;
+    vector<RingEntry> & ring = this->_rings[source];
+    ring.resize(size);
+    if (size > 0) file.read((char *) &ring[0], size * sizeof(RingEntry));
+    if ( !file ) {
+      this->_rings.erase(source);
+      return false;
+    }
+    this->_memory += size * sizeof(RingEntry);
+  }
+
+  return true;
+
+}
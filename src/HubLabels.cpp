@@ -0,0 +1,496 @@
+/****************************************************************
+ * HUBLABELS.CPP
+ *
+ * This file contains all the definitions of the methods of
+ * HubLabels.hpp (see this file for methods' documentation)
+ *
+ * Authors: J. Barthelemy
+ * Date   : 17 october 2013
+ ****************************************************************/
+
+#include "../include/HubLabels.hpp"
+#include "../include/ContractionHierarchy.hpp"
+#include "../include/MappedFile.hpp"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+
+using namespace std;
+
+const char         HUB_FILE_MAGIC[4]       = {'V', 'B', 'H', 'L'};  // first bytes of a cache file
+const char         HUB_CHECKPOINT_MAGIC[4] = {'V', 'B', 'H', 'P'};  // first bytes of a checkpoint file
+const unsigned int HUB_FILE_VERSION        = 1;                     // version of the cache and checkpoint file formats
+const double       HUB_CHECKPOINT_SECONDS  = 600.0;                 // minimum time between two checkpoints
+
+namespace {
+
+  // Header of a cache file
+  struct HubFileHeader {
+    char               magic[4];     // HUB_FILE_MAGIC
+    unsigned int       version;      // HUB_FILE_VERSION
+    unsigned long long nb_nodes;     // number of nodes of the routing graph
+    unsigned long long checksum;     // checksum of the routing graph
+    unsigned long long nb_entries;   // number of hubs of all the labels
+    unsigned long long max_size;     // number of hubs of the largest label
+    unsigned long long fwd_size;     // size of the compressed forward labels (bytes)
+    unsigned long long bwd_size;     // size of the compressed backward labels (bytes)
+  };
+
+  // Header of a checkpoint file, followed by the size of each label (0 if not computed yet) and the labels
+  struct HubCheckpointHeader {
+    char               magic[4];     // HUB_CHECKPOINT_MAGIC
+    unsigned int       version;      // HUB_FILE_VERSION
+    unsigned long long nb_nodes;     // number of nodes of the routing graph
+    unsigned long long checksum;     // checksum of the routing graph
+    unsigned long long nb_levels;    // number of levels of the hierarchy whose labels are computed
+    unsigned long long fwd_size;     // size of the compressed forward labels (bytes)
+    unsigned long long bwd_size;     // size of the compressed backward labels (bytes)
+  };
+
+  // An entry of a label (hub, distance)
+  typedef pair<int, float> LabelEntry;
+
+  // Append a variable length integer (7 bits by byte, the highest bit set if more bytes follow)
+  void appendVarint(vector<unsigned char> & bytes, unsigned int x) {
+    while (x >= 128) {
+      bytes.push_back((unsigned char) ((x & 127) | 128));
+      x >>= 7;
+    }
+    bytes.push_back((unsigned char) x);
+  }
+
+  // Read a variable length integer
+  unsigned int readVarint(const unsigned char * & p) {
+    unsigned int x = 0;
+    int shift = 0;
+    while (*p & 128) {
+      x |= (unsigned int) (*p++ & 127) << shift;
+      shift += 7;
+    }
+    x |= (unsigned int) (*p++) << shift;
+    return x;
+  }
+
+  // Compress a label sorted by hub
+  void encodeLabel(const vector<LabelEntry> & label, vector<unsigned char> & bytes) {
+    bytes.clear();
+    appendVarint(bytes, label.size());
+    int previous = 0;
+    for (unsigned int k = 0; k < label.size(); k++) {
+      appendVarint(bytes, label[k].first - previous);
+      previous = label[k].first;
+      unsigned char dist[sizeof(float)];
+      memcpy(dist, &label[k].second, sizeof(float));
+      bytes.insert(bytes.end(), dist, dist + sizeof(float));
+    }
+  }
+
+  // Sequential reader of a compressed label
+  class LabelReader {
+
+  public:
+
+    // Constructor: reading the first hub
+    LabelReader(const unsigned char * bytes) : _p(bytes), _left(0), _hub(0), _dist(0.0), _valid(true) {
+      _left = readVarint(_p);
+      next();
+    }
+
+    // Check whether the reader is on a hub (false once the label is read)
+    bool valid() const {
+      return _valid;
+    }
+
+    // Current hub and its distance
+    int hub() const {
+      return _hub;
+    }
+    float dist() const {
+      return _dist;
+    }
+
+    // Move to the next hub
+    void next() {
+      if (_left == 0) {
+        _valid = false;
+        return;
+      }
+      _hub += readVarint(_p);
+      memcpy(&_dist, _p, sizeof(float));
+      _p += sizeof(float);
+      _left--;
+    }
+
+  private:
+
+    const unsigned char * _p;      // next byte to read
+    unsigned int          _left;   // number of hubs left
+    int                   _hub;    // current hub
+    float                 _dist;   // distance of the current hub
+    bool                  _valid;  // false once every hub is read
+
+  };
+
+  // Number of hubs of a compressed label
+  unsigned int labelSize(const unsigned char * bytes) {
+    return readVarint(bytes);
+  }
+
+  // Smallest sum of distances over the hubs common to two compressed labels
+  float mergeLabels(const unsigned char * a, const unsigned char * b) {
+    float best = numeric_limits<float>::max();
+    LabelReader ra(a), rb(b);
+    while (ra.valid() && rb.valid()) {
+      if (ra.hub() < rb.hub()) {
+        ra.next();
+      } else if (rb.hub() < ra.hub()) {
+        rb.next();
+      } else {
+        best = min(best, ra.dist() + rb.dist());
+        ra.next();
+        rb.next();
+      }
+    }
+    return best;
+  }
+
+  // Idem, the first label being decoded
+  float mergeLabels(const vector<LabelEntry> & a, const unsigned char * b) {
+    float best = numeric_limits<float>::max();
+    unsigned int k = 0;
+    LabelReader rb(b);
+    while (k < a.size() && rb.valid()) {
+      if (a[k].first < rb.hub()) {
+        k++;
+      } else if (rb.hub() < a[k].first) {
+        rb.next();
+      } else {
+        best = min(best, a[k].second + rb.dist());
+        k++;
+        rb.next();
+      }
+    }
+    return best;
+  }
+
+  // Labels being computed (shared by the threads)
+  class LabelBuilder {
+
+  public:
+
+    const RoutingGraph &            up;      // upward graph of the hierarchy
+    const RoutingGraph &            down;    // downward graph of the hierarchy
+    vector< vector<unsigned char> > fwd;     // compressed forward label of each node (empty if not computed yet)
+    vector< vector<unsigned char> > bwd;     // compressed backward label of each node
+
+    // Constructor
+    LabelBuilder(const RoutingGraph & upGraph, const RoutingGraph & downGraph) : up(upGraph), down(downGraph),
+        fwd(upGraph.getNbNodes()), bwd(upGraph.getNbNodes()) {};
+
+    // Compute the labels of the nodes nodes[first], nodes[first + step], ...
+    void run(const vector<int> * nodes, unsigned int first, unsigned int step) {
+      vector<LabelEntry> work, label;
+      for (unsigned int k = first; k < nodes->size(); k += step) {
+        int v = (*nodes)[k];
+        computeLabel(this->up, v, this->fwd, this->bwd, work, label, this->fwd[v]);
+        computeLabel(this->down, v, this->bwd, this->fwd, work, label, this->bwd[v]);
+      }
+    }
+
+  private:
+
+    // Label of a node merged from the labels of its upper neighbours, without the hubs reached by a
+    // shorter path through another hub (checked against the opposite labels of the hubs)
+    static void computeLabel(const RoutingGraph & g, int v, const vector< vector<unsigned char> > & own,
+                             const vector< vector<unsigned char> > & opposite, vector<LabelEntry> & work,
+                             vector<LabelEntry> & label, vector<unsigned char> & bytes) {
+
+      work.clear();
+      work.push_back(LabelEntry(v, 0.0));
+      for (int e = g.beginOut(v); e < g.endOut(v); e++) {
+        for (LabelReader r(&own[g.getTarget(e)][0]); r.valid(); r.next()) {
+          work.push_back(LabelEntry(r.hub(), g.getLength(e) + r.dist()));
+        }
+      }
+
+      // ... shortest distance to each hub
+      sort(work.begin(), work.end());
+      label.clear();
+      for (unsigned int k = 0; k < work.size(); k++) {
+        if (label.empty() || label.back().first != work[k].first) label.push_back(work[k]);
+      }
+
+      // ... pruning
+      unsigned int n = 0;
+      for (unsigned int k = 0; k < label.size(); k++) {
+        if ( label[k].first == v || mergeLabels(label, &opposite[label[k].first][0]) >= label[k].second ) work[n++] = label[k];
+      }
+      work.resize(n);
+      encodeLabel(work, bytes);
+
+    }
+
+  };
+
+  // Write the labels computed so far to a checkpoint file (written aside, then renamed)
+  bool saveCheckpoint(const string & filename, const LabelBuilder & builder, unsigned long long checksum, unsigned long long nbLevels) {
+
+    size_t n = builder.fwd.size();
+    HubCheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HUB_CHECKPOINT_MAGIC, sizeof(HUB_CHECKPOINT_MAGIC));
+    header.version   = HUB_FILE_VERSION;
+    header.nb_nodes  = n;
+    header.checksum  = checksum;
+    header.nb_levels = nbLevels;
+
+    vector<unsigned int>  fwd_sizes(n), bwd_sizes(n);
+    vector<unsigned char> fwd_bytes, bwd_bytes;
+    for (size_t i = 0; i < n; i++) {
+      fwd_sizes[i] = builder.fwd[i].size();
+      bwd_sizes[i] = builder.bwd[i].size();
+      fwd_bytes.insert(fwd_bytes.end(), builder.fwd[i].begin(), builder.fwd[i].end());
+      bwd_bytes.insert(bwd_bytes.end(), builder.bwd[i].begin(), builder.bwd[i].end());
+    }
+    header.fwd_size = fwd_bytes.size();
+    header.bwd_size = bwd_bytes.size();
+
+    vector<char> image;
+    appendArray(image, &header, 1);
+    appendArray(image, fwd_sizes.empty() ? NULL : &fwd_sizes[0], n);
+    appendArray(image, bwd_sizes.empty() ? NULL : &bwd_sizes[0], n);
+    appendArray(image, fwd_bytes.empty() ? NULL : &fwd_bytes[0], fwd_bytes.size());
+    appendArray(image, bwd_bytes.empty() ? NULL : &bwd_bytes[0], bwd_bytes.size());
+
+    string temporary = filename + ".tmp";
+    ofstream file(temporary.c_str(), ios::out | ios::binary);
+    if (!file) return false;
+    file.write(&image[0], image.size());
+    file.close();
+    return file && rename(temporary.c_str(), filename.c_str()) == 0;
+
+  }
+
+  // Read the labels computed by an interrupted construction, return the number of levels they cover (0 if none)
+  unsigned long long loadCheckpoint(const string & filename, LabelBuilder & builder, unsigned long long checksum) {
+
+    MappedFile file(filename);
+    if ( !file.isOpen() ) return 0;
+
+    size_t pos = 0;
+    size_t n   = builder.fwd.size();
+    const HubCheckpointHeader * header = locateArray<HubCheckpointHeader>(file.getData(), file.getSize(), pos, 1);
+    if ( header == NULL || memcmp(header->magic, HUB_CHECKPOINT_MAGIC, sizeof(HUB_CHECKPOINT_MAGIC)) != 0 || header->version != HUB_FILE_VERSION
+         || header->checksum != checksum || header->nb_nodes != n ) return 0;
+
+    const unsigned int  * fwd_sizes = locateArray<unsigned int>(file.getData(), file.getSize(), pos, n);
+    const unsigned int  * bwd_sizes = locateArray<unsigned int>(file.getData(), file.getSize(), pos, n);
+    const unsigned char * fwd_bytes = locateArray<unsigned char>(file.getData(), file.getSize(), pos, header->fwd_size);
+    const unsigned char * bwd_bytes = locateArray<unsigned char>(file.getData(), file.getSize(), pos, header->bwd_size);
+    if ( bwd_bytes == NULL ) return 0;
+
+    for (size_t i = 0; i < n; i++) {
+      builder.fwd[i].assign(fwd_bytes, fwd_bytes + fwd_sizes[i]);
+      builder.bwd[i].assign(bwd_bytes, bwd_bytes + bwd_sizes[i]);
+      fwd_bytes += fwd_sizes[i];
+      bwd_bytes += bwd_sizes[i];
+    }
+    return header->nb_levels;
+
+  }
+
+}
+
+// Compute the labels from a contraction hierarchy
+void HubLabels::build(const ContractionHierarchy & ch, int nbThreads, const std::string & checkpoint) {
+
+  const RoutingGraph & up   = ch.getUpwardGraph();
+  const RoutingGraph & down = ch.getDownwardGraph();
+  int n = up.getNbNodes();
+
+  // Level of each node: 0 for the nodes without upper neighbours, else one more than the
+  // highest level of its upper neighbours (the nodes are leveled from the top of the hierarchy)
+  vector<int> n_upper(n, 0);
+  vector<int> lower_first(n + 1, 0);
+  for (int v = 0; v < n; v++) {
+    n_upper[v] = (up.endOut(v) - up.beginOut(v)) + (down.endOut(v) - down.beginOut(v));
+    for (int e = up.beginOut(v); e < up.endOut(v); e++) lower_first[up.getTarget(e) + 1]++;
+    for (int e = down.beginOut(v); e < down.endOut(v); e++) lower_first[down.getTarget(e) + 1]++;
+  }
+  for (int v = 0; v < n; v++) lower_first[v + 1] += lower_first[v];
+  vector<int> lower(lower_first[n]);
+  vector<int> next_pos(lower_first.begin(), lower_first.end() - 1);
+  for (int v = 0; v < n; v++) {
+    for (int e = up.beginOut(v); e < up.endOut(v); e++) lower[next_pos[up.getTarget(e)]++] = v;
+    for (int e = down.beginOut(v); e < down.endOut(v); e++) lower[next_pos[down.getTarget(e)]++] = v;
+  }
+
+  vector<int> level(n, 0);
+  vector<int> order;              // nodes by increasing level
+  order.reserve(n);
+  for (int v = 0; v < n; v++) {
+    if (n_upper[v] == 0) order.push_back(v);
+  }
+  for (unsigned int k = 0; k < order.size(); k++) {
+    int w = order[k];
+    for (int j = lower_first[w]; j < lower_first[w + 1]; j++) {
+      int v = lower[j];
+      level[v] = max(level[v], level[w] + 1);
+      if (--n_upper[v] == 0) order.push_back(v);
+    }
+  }
+
+  // Labels by level, resumed from the checkpoint
+  LabelBuilder builder(up, down);
+  unsigned long long first_level = checkpoint.empty() ? 0 : loadCheckpoint(checkpoint, builder, ch.getChecksum());
+  int nb_threads = max(nbThreads, 1);
+  time_t last_checkpoint = time(NULL);
+
+  vector<int> nodes;
+  for (unsigned int first = 0, last = 0; first < order.size(); first = last) {
+
+    nodes.clear();
+    while (last < order.size() && level[order[last]] == level[order[first]]) nodes.push_back(order[last++]);
+    if ((unsigned long long) level[order[first]] < first_level) continue;
+
+    // ... the nodes of a level only depend on the labels of the upper levels
+    if (nb_threads == 1 || nodes.size() < 1000) {
+      builder.run(&nodes, 0, 1);
+    } else {
+      boost::thread_group threads;
+      for (int t = 0; t < nb_threads; t++) threads.create_thread(boost::bind(&LabelBuilder::run, &builder, &nodes, t, nb_threads));
+      threads.join_all();
+    }
+
+    if ( !checkpoint.empty() && last < order.size() && difftime(time(NULL), last_checkpoint) > HUB_CHECKPOINT_SECONDS ) {
+      saveCheckpoint(checkpoint, builder, ch.getChecksum(), level[order[first]] + 1);
+      last_checkpoint = time(NULL);
+    }
+
+  }
+
+  // Compressed labels
+  vector<unsigned long long> fwd_offsets(n + 1, 0), bwd_offsets(n + 1, 0);
+  vector<unsigned char>      fwd_bytes, bwd_bytes;
+  this->_nb_entries = 0;
+  this->_max_size   = 0;
+  for (int v = 0; v < n; v++) {
+    fwd_bytes.insert(fwd_bytes.end(), builder.fwd[v].begin(), builder.fwd[v].end());
+    bwd_bytes.insert(bwd_bytes.end(), builder.bwd[v].begin(), builder.bwd[v].end());
+    fwd_offsets[v + 1] = fwd_bytes.size();
+    bwd_offsets[v + 1] = bwd_bytes.size();
+    unsigned int n_fwd = labelSize(&builder.fwd[v][0]);
+    unsigned int n_bwd = labelSize(&builder.bwd[v][0]);
+    this->_nb_entries += n_fwd + n_bwd;
+    this->_max_size = max(this->_max_size, (int) max(n_fwd, n_bwd));
+    vector<unsigned char>().swap(builder.fwd[v]);
+    vector<unsigned char>().swap(builder.bwd[v]);
+  }
+
+  this->_nb_nodes = n;
+  this->_fwd_offsets.take(fwd_offsets);
+  this->_bwd_offsets.take(bwd_offsets);
+  this->_fwd_bytes.take(fwd_bytes);
+  this->_bwd_bytes.take(bwd_bytes);
+  this->_checksum = ch.getChecksum();
+
+  if (!checkpoint.empty()) remove(checkpoint.c_str());
+
+}
+
+// Write the labels to a cache file
+bool HubLabels::save(const std::string & filename) const {
+
+  HubFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, HUB_FILE_MAGIC, sizeof(HUB_FILE_MAGIC));
+  header.version    = HUB_FILE_VERSION;
+  header.nb_nodes   = this->_nb_nodes;
+  header.checksum   = this->_checksum;
+  header.nb_entries = this->_nb_entries;
+  header.max_size   = this->_max_size;
+  header.fwd_size   = this->_fwd_bytes.size();
+  header.bwd_size   = this->_bwd_bytes.size();
+
+  vector<char> image;
+  appendArray(image, &header, 1);
+  appendArray(image, this->_fwd_offsets.begin(), this->_fwd_offsets.size());
+  appendArray(image, this->_bwd_offsets.begin(), this->_bwd_offsets.size());
+  appendArray(image, this->_fwd_bytes.begin(), this->_fwd_bytes.size());
+  appendArray(image, this->_bwd_bytes.begin(), this->_bwd_bytes.size());
+
+  ofstream file(filename.c_str(), ios::out | ios::binary);
+  if (!file) return false;
+  file.write(&image[0], image.size());
+  return (bool) file;
+
+}
+
+// Read the labels from a cache file
+bool HubLabels::load(const std::string & filename, const RoutingGraph & g) {
+
+  boost::shared_ptr<MappedFile> file(new MappedFile(filename));
+  if ( !file->isOpen() ) return false;
+
+  size_t pos = 0;
+  const HubFileHeader * header = locateArray<HubFileHeader>(file->getData(), file->getSize(), pos, 1);
+  if ( header == NULL || memcmp(header->magic, HUB_FILE_MAGIC, sizeof(HUB_FILE_MAGIC)) != 0 || header->version != HUB_FILE_VERSION
+       || header->checksum != g.getChecksum() || header->nb_nodes != (unsigned long long) g.getNbNodes() ) return false;
+
+  size_t n = header->nb_nodes;
+  const unsigned long long * fwd_offsets = locateArray<unsigned long long>(file->getData(), file->getSize(), pos, n + 1);
+  const unsigned long long * bwd_offsets = locateArray<unsigned long long>(file->getData(), file->getSize(), pos, n + 1);
+  const unsigned char      * fwd_bytes   = locateArray<unsigned char>(file->getData(), file->getSize(), pos, header->fwd_size);
+  const unsigned char      * bwd_bytes   = locateArray<unsigned char>(file->getData(), file->getSize(), pos, header->bwd_size);
+  if ( bwd_bytes == NULL || fwd_offsets[n] != header->fwd_size || bwd_offsets[n] != header->bwd_size ) return false;
+
+  this->_nb_nodes   = n;
+  this->_fwd_offsets.view(fwd_offsets, n + 1, file);
+  this->_bwd_offsets.view(bwd_offsets, n + 1, file);
+  this->_fwd_bytes.view(fwd_bytes, header->fwd_size, file);
+  this->_bwd_bytes.view(bwd_bytes, header->bwd_size, file);
+  this->_nb_entries = header->nb_entries;
+  this->_max_size   = header->max_size;
+  this->_checksum   = header->checksum;
+  return true;
+
+}
+
+// Distance between two nodes: merge of the forward label of the source and the backward label of the destination
+float HubLabels::distance(int source, int dest) const {
+
+  if (source == dest) return 0.0;
+  return mergeLabels(this->_fwd_bytes.begin() + this->_fwd_offsets[source], this->_bwd_bytes.begin() + this->_bwd_offsets[dest]);
+
+}
+
+// Write the statistics of the label sizes
+void HubLabels::writeStatistics(std::ostream & out, const std::string & indent) const {
+
+  // histogram of the label sizes, by power of two
+  vector<long> histogram;
+  for (int v = 0; v < this->_nb_nodes; v++) {
+    unsigned int sizes[2] = {labelSize(this->_fwd_bytes.begin() + this->_fwd_offsets[v]), labelSize(this->_bwd_bytes.begin() + this->_bwd_offsets[v])};
+    for (int k = 0; k < 2; k++) {
+      unsigned int bin = 0;
+      while ((1u << bin) < sizes[k]) bin++;
+      if (bin >= histogram.size()) histogram.resize(bin + 1, 0);
+      histogram[bin]++;
+    }
+  }
+
+  out << indent << "Hub labels: " << 2 * this->_nb_nodes << " labels, " << this->getAverageSize() << " hubs by label on average, "
+      << this->_max_size << " at most, " << this->getNbBytes() / 1048576.0 << " MB ("
+      << ( this->_nb_entries > 0 ? (double) this->getNbBytes() / this->_nb_entries : 0.0 ) << " bytes by hub)" << endl;
+  out << indent << "Label sizes:";
+  for (unsigned int bin = 0; bin < histogram.size(); bin++) {
+    if (histogram[bin] > 0) out << " <= " << (1u << bin) << ": " << histogram[bin] << ";";
+  }
+  out << endl;
+
+}
@@ -114,41 +114,7 @@ void Individual::aging() {
 
 void Individual::initAge() {
 
-  vector<long int> age_dis = Data::getInstance()->getMunAge(this->_municipality,
-      this->_gender);
-
-  int low = 0;
-  int up = 0;
-
-  switch (this->_age_class) {
-    case 0: {
-      low = 0;
-      up = 5;
-      break;
-    }
-    case 1: {
-      low = 6;
-      up = 17;
-      break;
-    }
-    case 2: {
-      low = 18;
-      up = 39;
-      break;
-    }
-    case 3: {
-      low = 40;
-      up = 59;
-      break;
-    }
-    case 4: {
-      low = 60;
-      up = 110;
-      break;
-    }
-  }
-
-  this->_age = draw_discrete(age_dis, low, up);
+  this->_age = Data::getInstance()->drawMunAge(this->_municipality, this->_gender, this->_age_class);
 
 }
 
@@ -0,0 +1,286 @@
+/****************************************************************
+ * LANDMARKTABLE.CPP
+ *
+ * This file contains all the definitions of the methods of
+ * LandmarkTable.hpp (see this file for methods' documentation)
+ *
+ * Authors: J. Barthelemy
+ * Date   : 14 october 2013
+ ****************************************************************/
+
+#include "../include/LandmarkTable.hpp"
+#include "../include/MappedFile.hpp"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+
+using namespace std;
+
+const char         LANDMARK_FILE_MAGIC[4] = {'V', 'B', 'L', 'M'};  // first bytes of a cache file
+const unsigned int LANDMARK_FILE_VERSION  = 1;                     // version of the cache file format
+const int          LANDMARK_MAX           = 64;                    // maximum number of landmarks
+
+namespace {
+
+  // Header of a cache file
+  struct LandmarkFileHeader {
+    char               magic[4];       // LANDMARK_FILE_MAGIC
+    unsigned int       version;        // LANDMARK_FILE_VERSION
+    int                nb_landmarks;   // number of landmarks
+    int                nb_requested;   // number of landmarks requested (more than nb_landmarks if the network is too small)
+    unsigned long long nb_nodes;       // number of nodes of the routing graph
+    unsigned long long checksum;       // checksum of the routing graph
+  };
+
+  // Distances from a node to every node of a graph (the largest float for the nodes not reachable)
+  void fullSearch(const RoutingGraph & g, int source, DijkstraWorkspace<BinaryHeapQueue> & ws, vector<float> & dist) {
+
+    ws.init(g);
+    ws.relax(source, 0.0);
+    while ( ws.hasNext() ) {
+      float d = ws.nextDist();
+      int   i = ws.next();
+      for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+        int j = g.getTarget(e);
+        if ( ws.isSettled(j) == false ) ws.relax(j, d + g.getLength(e));
+      }
+    }
+    for (int i = 0; i < g.getNbNodes(); i++) dist[i] = ws.getDist(i);
+
+  }
+
+  // Lower bound of the distance from a node to the destination of a query (triangle inequality)
+  class LandmarkPotential {
+
+  public:
+
+    // Constructor: selecting the landmarks connected to the destination
+    LandmarkPotential(int nbLandmarks, const float * from, const float * to, int dest) : _k(nbLandmarks), _from(from), _to(to),
+        _n_fwd(0), _n_bwd(0), _n_out(0) {
+      const float inf = numeric_limits<float>::max();
+      for (int k = 0; k < _k; k++) {
+        float d_lt = from[dest * _k + k];   // distance from the landmark to the destination
+        float d_tl = to[dest * _k + k];     // distance from the destination to the landmark
+        if (d_lt < inf) {
+          _fwd[_n_fwd] = k;
+          _fwd_dist[_n_fwd++] = d_lt;
+        } else {
+          _out[_n_out++] = k;
+        }
+        if (d_tl < inf) {
+          _bwd[_n_bwd] = k;
+          _bwd_dist[_n_bwd++] = d_tl;
+        }
+      }
+    }
+
+    // Potential of a node, negative if the node can not reach the destination
+    float operator()(int v) const {
+
+      const float   inf  = numeric_limits<float>::max();
+      const float * from = _from + v * _k;
+      const float * to   = _to + v * _k;
+
+      // ... a node reachable from a landmark which does not reach the destination can not reach it either
+      for (int a = 0; a < _n_out; a++) {
+        if (from[_out[a]] < inf) return -1.0;
+      }
+
+      float h = 0.0;
+      for (int a = 0; a < _n_fwd; a++) {
+        if (from[_fwd[a]] < inf) h = max(h, _fwd_dist[a] - from[_fwd[a]]);
+      }
+      // ... a node which does not reach a landmark reached by the destination can not reach it either
+      for (int b = 0; b < _n_bwd; b++) {
+        if (to[_bwd[b]] == inf) return -1.0;
+        h = max(h, to[_bwd[b]] - _bwd_dist[b]);
+      }
+      return h;
+
+    }
+
+  private:
+
+    int           _k;                       // number of landmarks
+    const float * _from;                    // distance tables (see LandmarkTable)
+    const float * _to;
+    int           _fwd[LANDMARK_MAX];       // landmarks reaching the destination...
+    float         _fwd_dist[LANDMARK_MAX];  // ... and their distance to it
+    int           _bwd[LANDMARK_MAX];       // landmarks reached by the destination...
+    float         _bwd_dist[LANDMARK_MAX];  // ... and their distance from it
+    int           _out[LANDMARK_MAX];       // landmarks not reaching the destination
+    int           _n_fwd;
+    int           _n_bwd;
+    int           _n_out;
+
+  };
+
+}
+
+// Select the landmarks and compute their distance tables
+void LandmarkTable::build(const RoutingGraph & g, const RoutingGraph & reverse, int nbLandmarks) {
+
+  const float inf = numeric_limits<float>::max();
+  int n = g.getNbNodes();
+  int k_max = min(min(nbLandmarks, LANDMARK_MAX), n);
+
+  vector<int>   landmarks;
+  vector<float> from((size_t) n * max(k_max, 0), inf);
+  vector<float> to((size_t) n * max(k_max, 0), inf);
+  vector<float> dist(n);
+  vector<float> nearest(n, inf);   // distance from (or to) the closest landmark selected so far
+  DijkstraWorkspace<BinaryHeapQueue> ws;
+
+  // The first landmark is the node farthest from an arbitrary node with outgoing links...
+  int next = -1;
+  for (int i = 0; i < n && next < 0; i++) {
+    if (g.beginOut(i) < g.endOut(i)) next = i;
+  }
+  if (k_max > 0 && next >= 0) {
+    fullSearch(g, next, ws, dist);
+    for (int i = 0; i < n; i++) {
+      if (dist[i] < inf && dist[i] > dist[next]) next = i;
+    }
+  }
+
+  // ... and the next ones are the nodes farthest from the landmarks already selected
+  while ( next >= 0 && (int) landmarks.size() < k_max ) {
+
+    int k = landmarks.size();
+    landmarks.push_back(next);
+
+    fullSearch(g, next, ws, dist);
+    for (int i = 0; i < n; i++) {
+      from[(size_t) i * k_max + k] = dist[i];
+      nearest[i] = min(nearest[i], dist[i]);
+    }
+    fullSearch(reverse, next, ws, dist);
+    for (int i = 0; i < n; i++) {
+      to[(size_t) i * k_max + k] = dist[i];
+      nearest[i] = min(nearest[i], dist[i]);
+    }
+
+    next = -1;
+    for (int i = 0; i < n; i++) {
+      if ( nearest[i] > 0.0 && nearest[i] < inf && (next < 0 || nearest[i] > nearest[next]) ) next = i;
+    }
+
+    // ... or, once every node connected to a landmark is one, a node of another part of the network
+    for (int i = 0; i < n && next < 0; i++) {
+      if ( nearest[i] == inf && g.beginOut(i) < g.endOut(i) ) next = i;
+    }
+
+  }
+
+  // Less landmarks may have been found than requested (e.g. very small network)
+  int k = landmarks.size();
+  if (k < k_max) {
+    vector<float> from_k((size_t) n * k), to_k((size_t) n * k);
+    for (int i = 0; i < n; i++) {
+      copy(from.begin() + (size_t) i * k_max, from.begin() + (size_t) i * k_max + k, from_k.begin() + (size_t) i * k);
+      copy(to.begin() + (size_t) i * k_max, to.begin() + (size_t) i * k_max + k, to_k.begin() + (size_t) i * k);
+    }
+    from.swap(from_k);
+    to.swap(to_k);
+  }
+
+  this->_nb_landmarks = k;
+  this->_nb_requested = nbLandmarks;
+  this->_nb_nodes     = n;
+  this->_landmarks.take(landmarks);
+  this->_from.take(from);
+  this->_to.take(to);
+  this->_checksum = g.getChecksum();
+
+}
+
+// Write the tables to a cache file
+bool LandmarkTable::save(const std::string & filename) const {
+
+  LandmarkFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, LANDMARK_FILE_MAGIC, sizeof(LANDMARK_FILE_MAGIC));
+  header.version      = LANDMARK_FILE_VERSION;
+  header.nb_landmarks = this->_nb_landmarks;
+  header.nb_requested = this->_nb_requested;
+  header.nb_nodes     = this->_nb_nodes;
+  header.checksum     = this->_checksum;
+
+  vector<char> image;
+  appendArray(image, &header, 1);
+  appendArray(image, this->_landmarks.begin(), this->_landmarks.size());
+  appendArray(image, this->_from.begin(), this->_from.size());
+  appendArray(image, this->_to.begin(), this->_to.size());
+
+  ofstream file(filename.c_str(), ios::out | ios::binary);
+  if (!file) return false;
+  file.write(&image[0], image.size());
+  return (bool) file;
+
+}
+
+// Read the tables from a cache file
+bool LandmarkTable::load(const std::string & filename, const RoutingGraph & g, int nbLandmarks) {
+
+  boost::shared_ptr<MappedFile> file(new MappedFile(filename));
+  if ( !file->isOpen() ) return false;
+
+  size_t pos = 0;
+  const LandmarkFileHeader * header = locateArray<LandmarkFileHeader>(file->getData(), file->getSize(), pos, 1);
+  if ( header == NULL || memcmp(header->magic, LANDMARK_FILE_MAGIC, sizeof(LANDMARK_FILE_MAGIC)) != 0 || header->version != LANDMARK_FILE_VERSION
+       || header->checksum != g.getChecksum() || header->nb_nodes != (unsigned long long) g.getNbNodes()
+       || header->nb_requested != nbLandmarks || header->nb_landmarks < 0 || header->nb_landmarks > LANDMARK_MAX ) return false;
+
+  size_t k = header->nb_landmarks;
+  size_t n = header->nb_nodes;
+  const int   * landmarks = locateArray<int>(file->getData(), file->getSize(), pos, k);
+  const float * from      = locateArray<float>(file->getData(), file->getSize(), pos, n * k);
+  const float * to        = locateArray<float>(file->getData(), file->getSize(), pos, n * k);
+  if ( to == NULL ) return false;
+
+  this->_nb_landmarks = k;
+  this->_nb_requested = nbLandmarks;
+  this->_nb_nodes     = n;
+  this->_landmarks.view(landmarks, k, file);
+  this->_from.view(from, n * k, file);
+  this->_to.view(to, n * k, file);
+  this->_checksum = header->checksum;
+  return true;
+
+}
+
+// A* search of the distance between two nodes
+float LandmarkTable::distance(const RoutingGraph & g, int source, int dest) const {
+
+  if (source == dest) return 0.0;
+
+  const float inf = numeric_limits<float>::max();
+  LandmarkPotential potential(this->_nb_landmarks, this->_from.begin(), this->_to.begin(), dest);
+  float h = potential(source);
+  if (h < 0.0) return inf;
+
+  // the keys (distance + potential) are not monotone up to rounding errors, hence the binary heap
+  DijkstraWorkspace<BinaryHeapQueue> & ws = DijkstraWorkspace<BinaryHeapQueue>::local(2);
+  ws.init(g);
+  ws.relax(source, 0.0, h);
+
+  while ( ws.hasNext() ) {
+
+    int   i = ws.next();
+    float d = ws.getDist(i);
+    if (i == dest) return d;
+
+    for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+      int   j   = g.getTarget(e);
+      float d_j = d + g.getLength(e);
+      if ( ws.isSettled(j) || d_j >= ws.getDist(j) ) continue;
+      float h_j = potential(j);
+      if ( h_j >= 0.0 ) ws.relax(j, d_j, d_j + h_j);
+    }
+
+  }
+
+  return inf;
+
+}
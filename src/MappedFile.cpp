@@ -0,0 +1,45 @@
+/****************************************************************
+ * MAPPEDFILE.CPP
+ *
+ * This file contains all the definitions of the methods of
+ * MappedFile.hpp (see this file for methods' documentation)
+ *
+ * Authors: J. Barthelemy
+ * Date   : 7 october 2013
+ ****************************************************************/
+
+#include "../include/MappedFile.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+using namespace std;
+
+// Constructor: mapping the whole file
+MappedFile::MappedFile(const string & filename) : _data(NULL), _size(0) {
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void * data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data != MAP_FAILED) {
+      this->_data = (const char *) data;
+      this->_size = st.st_size;
+    }
+  }
+
+  // the mapping remains valid once the file is closed
+  close(fd);
+
+}
+
+// Destructor: releasing the mapping
+MappedFile::~MappedFile() {
+
+  if (this->_data != NULL) munmap((void *) this->_data, this->_size);
+
+}
@@ -420,11 +420,73 @@ void Model::computeActivityChains() {
 
   repast::SharedContext<Individual>::const_local_iterator it_beg = agents.localBegin();   // initial individual agent
   repast::SharedContext<Individual>::const_local_iterator it_end = agents.localEnd();     // final individual agent
-  Network net = Data::getInstance()->getNetwork();                                        // road network
+  const RoutingService & routing = Data::getInstance()->getRoutingService();              // routing service on the road network
+
+  // Shortest path trees rooted at the houses, shared by the members of a household (not needed if the
+  // distances are approximated, see RoutingService::isApproximate())
+
+  double tree_budget = 64.0;                                                              // memory budget of the trees (MB)
+  if ( !this->_props.getProperty("routing.tree_cache_mb").empty() ) tree_budget = strToDouble(this->_props.getProperty("routing.tree_cache_mb"));
+  ShortestPathTreeCache house_trees(routing.getNetwork(), (size_t) (tree_budget * 1024.0 * 1024.0));
+  for (repast::SharedContext<Individual>::const_local_iterator it = it_beg; it != it_end && !routing.isApproximate(); it++) {
+    if ( (*it)->getAgeClass() > 0 && (*it)->getActChain().size() > 0 ) house_trees.expect((*it)->getHouse());
+  }
+
+  // Localizing the activities: every destination is drawn from the node of the previous activity. The k-th
+  // destinations of all the individuals are drawn together, with a single search by distinct source node
+  // (e.g. the houses shared by the members of a household, see RoutingService::sampleDestinations())
+
+  char act_home = this->_props.getProperty("par.act_home")[0];                            // type of the activities taking place at the house
+  vector< vector<Activity> > act_chains;                                                  // initial activities of each individual (empty if skipped)
+  vector< vector<long> >     act_nodes;                                                   // node of each activity of each individual
+  vector< vector<float> >    act_dists;                                                   // distance of the trip to each activity (but going back to the house)
+  unsigned int               max_n_act = 0;                                               // largest number of activities of an individual
+  for (repast::SharedContext<Individual>::const_local_iterator it = it_beg; it != it_end; it++) {
+    if ( (*it)->getAgeClass() > 0 && (*it)->getActChain().size() > 0 ) act_chains.push_back((*it)->getActChain());
+    else act_chains.push_back(vector<Activity>());
+    act_nodes.push_back(vector<long>(act_chains.back().size(), (*it)->getHouse()));
+    act_dists.push_back(vector<float>(act_chains.back().size(), 0.0));
+    max_n_act = std::max(max_n_act, (unsigned int) act_chains.back().size());
+  }
+
+  vector<long>         sources;                                                           // source node of each destination request
+  vector<float>        dists;                                                             // distance of each destination request
+  vector<unsigned int> requesters;                                                        // individual of each destination request
+  for (unsigned int k = 1; k + 1 < max_n_act; k++) {
+    sources.clear();
+    dists.clear();
+    requesters.clear();
+    for (unsigned int a = 0; a < act_chains.size(); a++) {
+      // ... the activities at the house stay at the house
+      if ( k + 1 >= act_chains[a].size() || act_chains[a][k].getType() == act_home ) continue;
+      act_dists[a][k] = Activity::drawTripDistance(act_chains[a][k].getTypeNum());
+      sources.push_back(act_nodes[a][k-1]);
+      dists.push_back(act_dists[a][k]);
+      requesters.push_back(a);
+    }
+    vector<long> dests = routing.sampleDestinations(sources, dists);
+    for (unsigned int r = 0; r < requesters.size(); r++) act_nodes[requesters[r]][k] = dests[r];
+  }
+
+  // The house departure times are independent: they are drawn at once for all the individuals whose first
+  // activity has the same type (see Activity::drawHouseDepartures())
+
+  map<int, vector<unsigned int> > departures_by_type;                                      // individuals by type of their first activity
+  for (unsigned int a = 0; a < act_chains.size(); a++) {
+    if ( act_chains[a].size() > 1 ) departures_by_type[act_chains[a][1].getTypeNum()].push_back(a);
+  }
+  vector<float> house_departures(act_chains.size(), 0.0);                                  // house departure time of each individual
+  vector<float> departures;
+  for (map<int, vector<unsigned int> >::const_iterator it = departures_by_type.begin(); it != departures_by_type.end(); ++it) {
+    departures.resize(it->second.size());
+    Activity::drawHouseDepartures(it->first, &departures[0], departures.size());
+    for (unsigned int i = 0; i < it->second.size(); i++) house_departures[it->second[i]] = departures[i];
+  }
 
   #ifdef DEBUGVB
     unsigned long debug_n_agents_done = 0;
   #endif
+  unsigned int n_agent = 0;                                                               // rank of the current individual
 
   // Main loop over every individuals
 
@@ -442,78 +504,106 @@ void Model::computeActivityChains() {
 
       // Variables
 
-      vector<Activity> act_chain_vect = (*it_beg)->getActChain();    // vector of initial activities
+      const vector<Activity> & act_chain_vect = act_chains[n_agent]; // vector of initial activities
       vector<Activity> final_act_chain_vect;                         // vector of final, fully characterized, activities
-      long start_act_node = (*it_beg)->getHouse();                   // starting place of the activity chain (the household's house)
+      long house = (*it_beg)->getHouse();                            // starting place of the activity chain (the household's house)
+      unsigned int n_act = act_chain_vect.size();                    // number of activities, including leaving and returning home
       float distance = 0;                                            // distance to reach next activity
       float dur_trip = 0;                                            // duration trip to next activity
-      bool start = false;                                            // flag set to 'false' if activity = staying home, 'true' otherwise
+
+      // Localized activities...
+
+      const vector<long>  & act_node = act_nodes[n_agent];           // node of each activity
+      const vector<float> & act_dist = act_dists[n_agent];           // distance of the trip to each activity (but going back to the house)
+      vector<long>          return_nodes;                            // nodes left to go back to the house
+
+      for (unsigned int k = 1; k < n_act - 1; k++) {
+        if( act_chain_vect[k].getType() == act_home ) return_nodes.push_back(act_node[k-1]);
+      }
+      return_nodes.push_back(act_node[n_act-2]);
+
+      // ... and the distances of every trip back to the house are given by a single search
+
+      vector<float> return_dist = routing.isApproximate() ? routing.distancesTo(house, return_nodes) : house_trees.getDistances(return_nodes, house);
+      unsigned int n_return = 0;                                     // number of trips back to the house already generated
+
+      // The distances being known, the durations of the trips are drawn at once...
+
+      vector<float> trip_dist;                                       // distance of the trip to each activity but the first one
+      vector<float> trip_dur;                                        // ... and its duration
+      for (unsigned int k = 1; k < n_act - 1; k++) {
+        trip_dist.push_back(act_chain_vect[k].getType() == act_home ? return_dist[n_return++] : act_dist[k]);
+      }
+      trip_dist.push_back(return_dist[n_return]);
+      Activity::drawTripDurations(trip_dist, trip_dur);
+      n_return = 0;
+
+      // ... while the duration of each activity depends on its starting time (pre-drawing their normal draws)
+
+      RandomGenerators::getInstance()->mixt_lognorm_batch.reserve(n_act);
 
       // Generating the first activity: being at home
 
-      Activity home(start_act_node, act_chain_vect[1].getTypeNum());
+      Activity home(house, house_departures[n_agent]);
       final_act_chain_vect.push_back(home);
       float startTime = home.getEndTime();                           // ... leaving home time (seconds)
 
       // Generating all but last activities
 
-      for (unsigned int k = 1; k < act_chain_vect.size() - 1; k++) {
+      for (unsigned int k = 1; k < n_act - 1; k++) {
 
         // ... going back to the house
-        //if( act_chain_vect[k].getType() == 'm' ) {
-        if( act_chain_vect[k].getType() == this->_props.getProperty("par.act_home")[0] ) {
-
-          start              = false;
-          long prev_act_node = start_act_node;
-          start_act_node     = (*it_beg)->getHouse();
-          distance           = net.getDistanceNodes(start_act_node,prev_act_node);
-
-          // check if distance performed > 1m and compute trip duration...
-          if ( distance > 1.0 ) {
-            dist_param_mixture duration_trip_dist_par = Data::getInstance()->getDurationCondiDistTripParDist(distance);
-            dur_trip = RandomGenerators::getInstance()->mixt_lognorm_dev.dev(duration_trip_dist_par.mu, duration_trip_dist_par.sigma, duration_trip_dist_par.p, duration_trip_dist_par.max);
-          }
-          // ... otherwise trip duration is set to 0
-          else {
-            dur_trip = 0.0;
-          }
+        if( act_chain_vect[k].getType() == act_home ) {
+
+          // trip duration already drawn (0 if distance performed <= 1m)
+          distance  = return_dist[n_return++];
+          dur_trip  = trip_dur[k-1];
           startTime = startTime + dur_trip;
 
+          // staying at the house, adding the characteristics not initialized by the constructor
+          Activity curr_act(act_chain_vect[k].getType(), house, false, startTime);
+          curr_act.setDistance(distance);
+          curr_act.setDurationTrip(dur_trip);
+          final_act_chain_vect.push_back(curr_act);
+          startTime = curr_act.getEndTime();                           // ... starting time of the next activity is given by the ending time of the current activity
+
         }
-        // ... others activities
+        // ... others activities, at their already drawn destination
         else {
-          start = true;
-        }
 
-        // activity generation ( size of the act_chain is decremented by 2 because we don't take into account the house returning and leaving house
-        Activity curr_act(act_chain_vect[k].getType(), start_act_node, start, startTime); // ... calling Activity constructor
+          Activity curr_act(act_chain_vect[k].getType(), act_node[k], act_dist[k], trip_dur[k-1], startTime);
+          final_act_chain_vect.push_back(curr_act);
+          startTime = curr_act.getEndTime();
 
-        // if returning home, adding the characteristics not initialized by the constructor
-        if( start == false) {
-          curr_act.setDistance(distance);
-          curr_act.setDurationTrip(dur_trip);
         }
 
-        final_act_chain_vect.push_back(curr_act);                      // ... adding the resulting activity to the vector of activities
-        start_act_node = curr_act.getNodeId();                         // ... the starting node of next activity is the destination node of the current activity
-        startTime = curr_act.getEndTime();                             // ... starting time of the next activity is given by the ending time of the current activity
-
       }
 
       // Generating last activity, i.e. returning home
 
-      Activity returnHouse(start_act_node, (*it_beg)->getHouse());     // creating the returning home activity
+      Activity returnHouse(act_node[n_act-2], house, trip_dur[n_act-2]);     // creating the returning home activity
       final_act_chain_vect.push_back(returnHouse);                     // ... and adding it to the activity chain of the current individual
 
       // Updating activity chain of current individual
 
       (*it_beg)->setActChain(final_act_chain_vect);
+      house_trees.release(house);                                      // ... the household's tree is evicted once every member is done
 
     }
 
     // Next individual
 
     it_beg++;
+    n_agent++;
+
+  }
+
+  if ( this->_props.getProperty("par.debug") == "y" ) {
+
+    ostringstream screen_output;
+    screen_output << "... house trees of process " << this->_proc << ": " << house_trees.getNbQueries() << " queries, "
+                  << house_trees.getNbBuilt() << " trees built, " << house_trees.getNbEvicted() << " evicted (memory budget)" << endl;
+    cout << screen_output.str();
 
   }
 
@@ -829,8 +919,8 @@ void Model::writeActivityChains() {
 
         xel_act = doc->newElement("act");
         xel_act->SetAttribute("type",(*it_beg)->getActChain()[i].getType());
-        xel_act->SetAttribute("x",(double)Data::getInstance()->getNetwork().getNodes().at((*it_beg)->getActChain()[i].getNodeId()).getX() );
-        xel_act->SetAttribute("y",(double)Data::getInstance()->getNetwork().getNodes().at((*it_beg)->getActChain()[i].getNodeId()).getY() );
+        xel_act->SetAttribute("x",(double)Data::getInstance()->getNetwork().getNodeX((*it_beg)->getActChain()[i].getNodeId()) );
+        xel_act->SetAttribute("y",(double)Data::getInstance()->getNetwork().getNodeY((*it_beg)->getActChain()[i].getNodeId()) );
         xel_act->SetAttribute("end_time",secToTime((*it_beg)->getActChain()[i].getEndTime()).c_str());
         plan->insertEndChild(xel_act);
 
@@ -851,8 +941,8 @@ void Model::writeActivityChains() {
       unsigned int last =  (*it_beg)->getActChain().size() -1;
       xel_act = doc->newElement("act");
       xel_act->SetAttribute("type","m");
-      xel_act->SetAttribute("x",(double)Data::getInstance()->getNetwork().getNodes().at((*it_beg)->getActChain()[last].getNodeId()).getX());
-      xel_act->SetAttribute("y",(double)Data::getInstance()->getNetwork().getNodes().at((*it_beg)->getActChain()[last].getNodeId()).getY());
+      xel_act->SetAttribute("x",(double)Data::getInstance()->getNetwork().getNodeX((*it_beg)->getActChain()[last].getNodeId()));
+      xel_act->SetAttribute("y",(double)Data::getInstance()->getNetwork().getNodeY((*it_beg)->getActChain()[last].getNodeId()));
 
       file2 << (*it_beg)->getActChain()[last].getTypeNum() << " " << (*it_beg)->getActChain()[last].getDistance() << " " << (*it_beg)->getActChain()[last].getDurationTrip() << " ";
       file2 << (*it_beg)->getActChain()[last].getDuration() << " " << ( (*it_beg)->getActChain()[last-1].getEndTime() + (*it_beg)->getActChain()[last].getDurationTrip() ) << " ";
@@ -906,7 +996,7 @@ void Model::saveActivityLocalizationAndTime(){
     for( unsigned int i = 0; i < (*it_beg)->getActChain().size(); i++ ) {
 
       // municipality of the activity
-      mun_ins = Data::getInstance()->getNetwork().getNodes().at((*it_beg)->getActChain()[i].getNodeId()).getIns();
+      mun_ins = Data::getInstance()->getNetwork().getNodeIns((*it_beg)->getActChain()[i].getNodeId());
 
       // if no correct mun_ins is found due to incorrect data (or node outside Belgium), current activity is discarded
       if ( mun_ins != 0 ) {
@@ -1028,8 +1118,8 @@ void Model::saveODMatrix(){
     for( unsigned int i = 1; i < (*it_beg)->getActChain().size() ; i++ ) {
 
       // municipalities of the trip
-      mun_ins_start = Data::getInstance()->getNetwork().getNodes().at((*it_beg)->getActChain()[i-1].getNodeId()).getIns();
-      mun_ins_end   = Data::getInstance()->getNetwork().getNodes().at((*it_beg)->getActChain()[i].getNodeId()).getIns();
+      mun_ins_start = Data::getInstance()->getNetwork().getNodeIns((*it_beg)->getActChain()[i-1].getNodeId());
+      mun_ins_end   = Data::getInstance()->getNetwork().getNodeIns((*it_beg)->getActChain()[i].getNodeId());
 
       // if no correct mun_ins_start and mun_ins_end are found due to incorrect data (or node outside Belgium), current activity is discarded
       if ( mun_ins_start > 0  && mun_ins_end > 0 ) {
@@ -9,9 +9,213 @@
  ****************************************************************/
 
 #include "../include/Network.hpp"
+#include "../include/ChainContraction.hpp"
+#include "../include/ContractionHierarchy.hpp"
+#include "../include/DistanceRingIndex.hpp"
+#include "../include/HubLabels.hpp"
+#include "../include/LandmarkTable.hpp"
+#include "../include/MappedFile.hpp"
+#include "../include/SpatialGrid.hpp"
+#include "../include/tinyxml2.hpp"
+#include <ctime>
+#include <fstream>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 
 using namespace std;
+using namespace tinyxml2;
+
+const char         NETWORK_FILE_MAGIC[4] = {'V', 'B', 'N', 'W'};  // first bytes of a binary network file
+const unsigned int NETWORK_FILE_VERSION  = 2;                     // version of the binary network file format
+const int          GRID_SAMPLE_DRAWS     = 256;                   // number of candidates drawn from the spatial grid before searching
+const int          GRID_SAMPLE_QUERIES   = 32;                    // number of candidates checked with the hub labels before searching
+const double       GRID_MIN_RATIO        = 0.5;                   // smallest link length / euclidean distance ratio for which the grid prefilters
+
+// Header of a binary network file, followed by the arrays (each one aligned on 8 bytes):
+// ids (N), offsets (N+1), targets (M), lengths (M), reverse offsets (N+1), reverse targets (M),
+// reverse lengths (M), x (N), y (N), ins codes (N), sorted ids (S) and their index (S)
+struct NetworkFileHeader {
+  char               magic[4];
+  unsigned int       version;
+  unsigned int       long_size;            // size of the node ids
+  unsigned int       node_order;           // order of the nodes (see NodeOrder)
+  unsigned long long n_nodes;
+  unsigned long long n_links;
+  double             bbox[4];              // x min, x max, y min, y max
+  float              length_bounds[4];     // min and max link lengths of the graph and of its reverse
+  unsigned long long checksums[2];         // checksums of the graph and of its reverse
+  unsigned long long n_sorted;             // size of the translation table of the ids (S, N or 0 if the ids are increasing)
+};
+
+namespace {
+
+  // Hardware counter of the cache misses of the calling thread (Linux perf events)
+  class CacheMissCounter {
+
+  public:
+
+    // Constructor: opening the counter (disabled)
+    CacheMissCounter() : _fd(-1) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.type           = PERF_TYPE_HARDWARE;
+      attr.size           = sizeof(attr);
+      attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+      attr.disabled       = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      _fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    // Destructor: closing the counter
+    ~CacheMissCounter() {
+      if (_fd >= 0) close(_fd);
+    }
+
+    // Check whether the counter is available (e.g. not forbidden by perf_event_paranoid)
+    bool isOpen() const {
+      return _fd >= 0;
+    }
+
+    // Reset and enable the counter
+    void start() {
+      if (_fd < 0) return;
+      ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    // Disable the counter and return its value (-1 if not available)
+    long long stop() {
+      long long count = -1;
+      if (_fd < 0) return count;
+      ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(_fd, &count, sizeof(count)) != sizeof(count)) count = -1;
+      return count;
+    }
+
+  private:
+
+    int _fd;   // file descriptor of the counter (-1 if not available)
+
+  };
+
+  // Position of a point on a Hilbert curve filling a 2^16 x 2^16 grid
+  unsigned long long hilbertKey(unsigned int x, unsigned int y) {
+
+    const unsigned int side = 1 << 16;
+    unsigned long long key = 0;
+    for (unsigned int s = side / 2; s > 0; s /= 2) {
+      unsigned int rx = (x & s) > 0;
+      unsigned int ry = (y & s) > 0;
+      key += (unsigned long long) s * s * ((3 * rx) ^ ry);
+      // ... rotating the quadrant
+      if (ry == 0) {
+        if (rx == 1) {
+          x = side - 1 - x;
+          y = side - 1 - y;
+        }
+        swap(x, y);
+      }
+    }
+    return key;
+
+  }
+
+  // Permute an array indexed by node (perm[k] is the former index of the node of new index k)
+  template <typename T> void permuteArray(ConstArray<T> & a, const vector<int> & perm) {
+
+    if (a.empty()) return;
+    vector<T> v(perm.size());
+    for (unsigned int k = 0; k < perm.size(); k++) v[k] = a[perm[k]];
+    a.take(v);
+
+  }
+
+  // Distance from the source of a search on the graph with contracted chains to an interior node: the
+  // shortest distance through the contracted links containing the node, from the source of the link if
+  // it is settled or from the source of the search if it precedes the node on the link (direct)
+  template <class Queue> float chainDistance(const ChainContraction & cc, const DijkstraWorkspace<Queue> & ws, int source, int v,
+                                             int & link, bool & direct) {
+
+    float best = numeric_limits<float>::max();
+    link   = -1;
+    direct = false;
+    for (int k = cc.beginLinks(v); k < cc.endLinks(v); k++) {
+      int   e   = cc.getNodeLink(k);
+      int   h   = cc.getLinkSource(e);
+      float off = cc.getInteriorOffset(cc.getNodePosition(k));
+      if ( ws.isSettled(h) && ws.getDist(h) + off < best ) {
+        best   = ws.getDist(h) + off;
+        link   = e;
+        direct = false;
+      }
+      for (int ks = cc.beginLinks(source); ks < cc.endLinks(source); ks++) {
+        if ( cc.getNodeLink(ks) == e && cc.getNodePosition(ks) < cc.getNodePosition(k)
+             && off - cc.getInteriorOffset(cc.getNodePosition(ks)) < best ) {
+          best   = off - cc.getInteriorOffset(cc.getNodePosition(ks));
+          link   = e;
+          direct = true;
+        }
+      }
+    }
+    return best;
+
+  }
+
+  // Nodes at a distance in ]lo, hi[ from the source of a search on the graph with contracted chains, once
+  // every node of the core graph closer than hi is settled (optionally restricted to the largest component)
+  template <class Queue> void collectChainBand(const Network & network, const ChainContraction & cc, const DijkstraWorkspace<Queue> & ws,
+                                               int source, float lo, float hi, bool largest, vector< pair<float, int> > & result) {
+
+    const RoutingGraph & g       = cc.getCore();
+    const vector<int>  & settled = ws.getSettledOrder();
+    int  link;
+    bool direct;
+
+    // ... the source node itself if it is an interior node (the core nodes are settled)
+    if ( cc.isInterior(source) && lo < 0.0 && ( !largest || network.isInLargestComponentIndex(source) ) ) {
+      result.push_back(make_pair(0.0f, source));
+    }
+
+    // ... the settled nodes in the band, and the interior nodes of their contracted links, whose
+    //     distance is interpolated along the link (counted once, from the origin of their shortest distance)
+    for (int k = (int) settled.size() - 1; k >= 0 && ws.getDist(settled[k]) > lo - cc.getMaxLength(); k--) {
+      int   i = settled[k];
+      float d = ws.getDist(i);
+      if ( d > lo && d < hi && ( !largest || network.isInLargestComponentIndex(i) ) ) result.push_back(make_pair(d, i));
+      for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+        for (int pos = cc.beginInterior(e); pos < cc.endInterior(e); pos++) {
+          float c = d + cc.getInteriorOffset(pos);
+          int   v = cc.getInteriorNode(pos);
+          if ( c >= hi ) break;
+          if ( c <= lo || v == source || ( largest && !network.isInLargestComponentIndex(v) ) ) continue;
+          chainDistance(cc, ws, source, v, link, direct);
+          if ( link == e && !direct ) result.push_back(make_pair(c, v));
+        }
+      }
+    }
+
+    // ... the interior nodes following an interior source node on its contracted links
+    for (int ks = cc.beginLinks(source); ks < cc.endLinks(source); ks++) {
+      int e  = cc.getNodeLink(ks);
+      int ps = cc.getNodePosition(ks);
+      for (int pos = ps + 1; pos < cc.endInterior(e); pos++) {
+        float c = cc.getInteriorOffset(pos) - cc.getInteriorOffset(ps);
+        int   v = cc.getInteriorNode(pos);
+        if ( c >= hi ) break;
+        if ( c <= lo || v == source || ( largest && !network.isInLargestComponentIndex(v) ) ) continue;
+        chainDistance(cc, ws, source, v, link, direct);
+        if ( link == e && direct ) result.push_back(make_pair(c, v));
+      }
+    }
+
+  }
+
+}
 
 // Default Constructor (binary heap)
 DHeap::DHeap() : _d(2) {
@@ -185,140 +389,1557 @@ void Network::addLink(Link aLink) {
 
 }
 
+// Build the routing graph of the network
+void Network::buildGraph() {
+
+  this->_graph.build(this->_Nodes, this->_Links);
+  this->_reverse_graph.buildReverse(this->_graph);
+  this->_node_order = ORDER_ID;
+  this->_chains.reset();
+  this->_grid.reset();
+  this->clearComponents();
+
+  // attributes of the nodes, by routing graph index (std::map is sorted as the graph)
+  vector<double> x, y;
+  vector<int>    ins;
+  x.reserve(this->_Nodes.size());
+  y.reserve(this->_Nodes.size());
+  ins.reserve(this->_Nodes.size());
+  for (map<long, Node>::const_iterator it = this->_Nodes.begin(); it != this->_Nodes.end(); it++) {
+    x.push_back(it->second.getX());
+    y.push_back(it->second.getY());
+    ins.push_back(it->second.getIns());
+  }
+  this->_x.take(x);
+  this->_y.take(y);
+  this->_ins.take(ins);
+
+}
+
+// Read the network from a XML file
+bool Network::readXml(const string & filename, const map<long, int> & nodeIns) {
+
+  XMLDocument doc;
+  if (doc.loadFile(filename.c_str()) != XML_NO_ERROR || doc.FirstChildElement("network") == NULL) return false;
+  XMLElement * net = doc.FirstChildElement("network");
+  if (net->FirstChildElement("nodes") == NULL || net->FirstChildElement("links") == NULL) return false;
+
+  // Parsing the node data
+  XMLElement * ele = net->FirstChildElement("nodes")->FirstChildElement("node");
+  const XMLAttribute * attr;
+
+  long id;
+  double x;
+  double y;
+  int ins;
+
+  double x_min = std::numeric_limits<float>::max();
+  double y_min = std::numeric_limits<float>::max();
+  double x_max = std::numeric_limits<float>::min();
+  double y_max = std::numeric_limits<float>::min();
+
+  while (ele) {
+
+    // reading id
+    attr = ele->FirstAttribute();
+    id = attr->IntValue();
+
+    // reading x coordinate
+    attr = attr->Next();
+    x = attr->DoubleValue();
+
+    // determining min and max x coordinates
+    if( x < x_min ) x_min = x; else if( x > x_max ) x_max = x;
+
+    // reading y coordinate
+    attr = attr->Next();
+    y = attr->DoubleValue();
+
+    // determining min and max y coordinates;
+    if( y < y_min ) y_min = y; else if( y > y_max ) y_max = y;
+
+    // finding ins code
+    map<long, int>::const_iterator it = nodeIns.find(id);
+    ins = ( it != nodeIns.end() ) ? it->second : 0;
+
+    // adding the node to the network
+    Node currNode(id, x, y, ins);
+    this->addNode(currNode);
+
+    ele = ele->NextSiblingElement("node");
+
+  }
+
+  // Parsing the link data
+  ele = net->FirstChildElement("links")->FirstChildElement("link");
+
+  long start_node;
+  long end_node;
+  float length;
+
+  while (ele) {
+
+    // reading id
+    attr = ele->FirstAttribute();
+    id = attr->IntValue();
+
+    // reading starting node id
+    attr = attr->Next();
+    start_node = attr->IntValue();
+
+    // reading ending node id
+    attr = attr->Next();
+    end_node = attr->IntValue();
+
+    // ... and adding it to the list of end node of start node
+    this->addLinkOutToNode(start_node, id);
+
+    // reading lenght
+    attr = attr->Next();
+    length = attr->FloatValue();
+
+    // adding the link to the network
+    Link currLink(id, start_node, end_node, length);
+    this->addLink(currLink);
+
+    // moving to next link
+    ele = ele->NextSiblingElement("link");
+
+  }
+
+  this->min_x = x_min;
+  this->max_x = x_max;
+  this->min_y = y_min;
+  this->max_y = y_max;
+
+  // Building the routing graph (CSR representation of the network)
+  this->buildGraph();
+
+  return true;
+
+}
+
+// Write the network in a binary network file
+bool Network::writeBinary(const string & filename) const {
+
+  vector<char> image;
+  this->writeBinary(image);
+
+  ofstream file(filename.c_str(), ios::out | ios::binary);
+  if (!file) return false;
+  file.write(&image[0], image.size());
+  return (bool) file;
+
+}
+
+// Append the binary image of the network to a memory block
+void Network::writeBinary(vector<char> & image) const {
+
+  const RoutingGraph & g = this->_graph;
+  const RoutingGraph & r = this->_reverse_graph;
+  int n = g.getNbNodes();
+
+  NetworkFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, NETWORK_FILE_MAGIC, sizeof(NETWORK_FILE_MAGIC));
+  header.version          = NETWORK_FILE_VERSION;
+  header.long_size        = sizeof(long);
+  header.node_order       = this->_node_order;
+  header.n_nodes          = n;
+  header.n_links          = g.getNbLinks();
+  header.bbox[0]          = this->min_x;
+  header.bbox[1]          = this->max_x;
+  header.bbox[2]          = this->min_y;
+  header.bbox[3]          = this->max_y;
+  header.length_bounds[0] = g.getMinLength();
+  header.length_bounds[1] = g.getMaxLength();
+  header.length_bounds[2] = r.getMinLength();
+  header.length_bounds[3] = r.getMaxLength();
+  header.checksums[0]     = g.getChecksum();
+  header.checksums[1]     = r.getChecksum();
+  header.n_sorted         = g.getSortedIds().size();
+  appendArray(image, &header, 1);
+
+  // ids, then the CSR arrays of both graphs (the links of a node are contiguous)
+  vector<long> ids(n);
+  for (int i = 0; i < n; i++) ids[i] = g.getId(i);
+  appendArray(image, n > 0 ? &ids[0] : (const long *) NULL, n);
+  const RoutingGraph * graphs[2] = {&g, &r};
+  for (int k = 0; k < 2; k++) {
+    const RoutingGraph & h = *graphs[k];
+    vector<int>   offsets(n + 1);
+    vector<int>   targets(h.getNbLinks());
+    vector<float> lengths(h.getNbLinks());
+    for (int i = 0; i <= n; i++) offsets[i] = (i < n) ? h.beginOut(i) : h.getNbLinks();
+    for (int e = 0; e < h.getNbLinks(); e++) {
+      targets[e] = h.getTarget(e);
+      lengths[e] = h.getLength(e);
+    }
+    appendArray(image, &offsets[0], offsets.size());
+    appendArray(image, targets.empty() ? (const int *) NULL : &targets[0], targets.size());
+    appendArray(image, lengths.empty() ? (const float *) NULL : &lengths[0], lengths.size());
+  }
+
+  // attributes of the nodes
+  appendArray(image, this->_x.begin(), this->_x.size());
+  appendArray(image, this->_y.begin(), this->_y.size());
+  appendArray(image, this->_ins.begin(), this->_ins.size());
+
+  // translation table of the node ids
+  appendArray(image, g.getSortedIds().begin(), g.getSortedIds().size());
+  appendArray(image, g.getSortedIndex().begin(), g.getSortedIndex().size());
+
+}
+
+// Read a network written by writeBinary
+bool Network::readBinary(const string & filename) {
+
+  boost::shared_ptr<MappedFile> file(new MappedFile(filename));
+  return file->isOpen() && this->readBinary(file->getData(), file->getSize(), file);
+
+}
+
+// Read the binary image of a network stored in a memory block
+bool Network::readBinary(const char * image, size_t size, const boost::shared_ptr<const void> & owner) {
+
+  size_t pos = 0;
+  const NetworkFileHeader * header = locateArray<NetworkFileHeader>(image, size, pos, 1);
+  if ( header == NULL || memcmp(header->magic, NETWORK_FILE_MAGIC, sizeof(NETWORK_FILE_MAGIC)) != 0 || header->version != NETWORK_FILE_VERSION
+       || header->long_size != sizeof(long) || header->n_nodes > (unsigned long long) std::numeric_limits<int>::max()
+       || header->n_links > (unsigned long long) std::numeric_limits<int>::max() || (header->n_sorted != 0 && header->n_sorted != header->n_nodes)
+       || header->node_order > ORDER_HILBERT ) return false;
+
+  size_t n = header->n_nodes;
+  size_t m = header->n_links;
+  const long   * ids       = locateArray<long>(image, size, pos, n);
+  const int    * offsets   = locateArray<int>(image, size, pos, n + 1);
+  const int    * targets   = locateArray<int>(image, size, pos, m);
+  const float  * lengths   = locateArray<float>(image, size, pos, m);
+  const int    * r_offsets = locateArray<int>(image, size, pos, n + 1);
+  const int    * r_targets = locateArray<int>(image, size, pos, m);
+  const float  * r_lengths = locateArray<float>(image, size, pos, m);
+  const double * x         = locateArray<double>(image, size, pos, n);
+  const double * y         = locateArray<double>(image, size, pos, n);
+  const int    * ins       = locateArray<int>(image, size, pos, n);
+  const long   * s_ids     = locateArray<long>(image, size, pos, header->n_sorted);
+  const int    * s_index   = locateArray<int>(image, size, pos, header->n_sorted);
+  if ( ins == NULL || s_index == NULL || offsets[0] != 0 || (size_t) offsets[n] != m || r_offsets[0] != 0 || (size_t) r_offsets[n] != m ) return false;
+
+  this->_Nodes.clear();
+  this->_Links.clear();
+  if (header->n_sorted == 0) {
+    s_ids   = NULL;
+    s_index = NULL;
+  }
+  this->_graph.view(n, ids, s_ids, s_index, offsets, targets, lengths, header->length_bounds[0], header->length_bounds[1], header->checksums[0], owner);
+  this->_reverse_graph.view(n, ids, s_ids, s_index, r_offsets, r_targets, r_lengths, header->length_bounds[2], header->length_bounds[3], header->checksums[1], owner);
+  this->_x.view(x, n, owner);
+  this->_y.view(y, n, owner);
+  this->_ins.view(ins, n, owner);
+  this->_node_order = (NodeOrder) header->node_order;
+  this->_chains.reset();
+  this->_grid.reset();
+  this->clearComponents();
+  this->min_x = header->bbox[0];
+  this->max_x = header->bbox[1];
+  this->min_y = header->bbox[2];
+  this->max_y = header->bbox[3];
+
+  return true;
+
+}
+
+// Reorder the nodes of the routing graph
+void Network::reorder(NodeOrder order) {
+
+  const RoutingGraph & g = this->_graph;
+  const RoutingGraph & r = this->_reverse_graph;
+  int n = g.getNbNodes();
+
+  // New order of the nodes: perm[k] is the current index of the node of new index k
+  vector<int> perm(n);
+  for (int i = 0; i < n; i++) perm[i] = i;
+
+  if (order == ORDER_ID) {
+    vector< pair<long, int> > keys(n);
+    for (int i = 0; i < n; i++) keys[i] = make_pair(g.getId(i), i);
+    sort(keys.begin(), keys.end());
+    for (int k = 0; k < n; k++) perm[k] = keys[k].second;
+  }
+
+  // ... position on a Hilbert curve covering the bounding box (close nodes have close positions)
+  else if (order == ORDER_HILBERT) {
+    double x_min = std::numeric_limits<double>::max(), x_max = -std::numeric_limits<double>::max();
+    double y_min = std::numeric_limits<double>::max(), y_max = -std::numeric_limits<double>::max();
+    for (int i = 0; i < n; i++) {
+      x_min = min(x_min, this->_x[i]);
+      x_max = max(x_max, this->_x[i]);
+      y_min = min(y_min, this->_y[i]);
+      y_max = max(y_max, this->_y[i]);
+    }
+    double scale = 65535.0 / max(max(x_max - x_min, y_max - y_min), 1e-9);
+    vector< pair<unsigned long long, int> > keys(n);
+    for (int i = 0; i < n; i++) {
+      keys[i] = make_pair(hilbertKey((unsigned int) ((this->_x[i] - x_min) * scale), (unsigned int) ((this->_y[i] - y_min) * scale)), i);
+    }
+    sort(keys.begin(), keys.end());
+    for (int k = 0; k < n; k++) perm[k] = keys[k].second;
+  }
+
+  // ... breadth first search following the links in both directions, restarted on each unvisited part
+  else if (order == ORDER_BFS) {
+    vector<bool> visited(n, false);
+    int k = 0;
+    for (int root = 0; root < n; root++) {
+      if (visited[root]) continue;
+      visited[root] = true;
+      perm[k++] = root;
+      for (int head = k - 1; head < k; head++) {
+        int v = perm[head];
+        for (int e = g.beginOut(v); e < g.endOut(v); e++) {
+          if (!visited[g.getTarget(e)]) { visited[g.getTarget(e)] = true; perm[k++] = g.getTarget(e); }
+        }
+        for (int e = r.beginOut(v); e < r.endOut(v); e++) {
+          if (!visited[r.getTarget(e)]) { visited[r.getTarget(e)] = true; perm[k++] = r.getTarget(e); }
+        }
+      }
+    }
+  }
+
+  // Rebuilding the routing graphs with the new indices (the links of a node keep their order)
+  vector<int> rank(n);
+  for (int k = 0; k < n; k++) rank[perm[k]] = k;
+  vector<long>  ids(n);
+  vector<int>   sources, targets;
+  vector<float> lengths;
+  sources.reserve(g.getNbLinks());
+  targets.reserve(g.getNbLinks());
+  lengths.reserve(g.getNbLinks());
+  for (int k = 0; k < n; k++) {
+    ids[k] = g.getId(perm[k]);
+    for (int e = g.beginOut(perm[k]); e < g.endOut(perm[k]); e++) {
+      sources.push_back(k);
+      targets.push_back(rank[g.getTarget(e)]);
+      lengths.push_back(g.getLength(e));
+    }
+  }
+  RoutingGraph graph;
+  graph.build(ids, sources, targets, lengths);
+  this->_graph = graph;
+  this->_reverse_graph.buildReverse(this->_graph);
+
+  // Attributes of the nodes
+  permuteArray(this->_x, perm);
+  permuteArray(this->_y, perm);
+  permuteArray(this->_ins, perm);
+  permuteArray(this->_scc, perm);
+  permuteArray(this->_wcc, perm);
+
+  // Structures referring to the former indices
+  this->_ch.reset();
+  this->_hub_labels.reset();
+  this->_landmarks.reset();
+  this->_chains.reset();
+  this->_rings.reset();
+  this->_grid.reset();
+  this->_node_order = order;
+
+}
+
+// Remove the labels of the components
+void Network::clearComponents() {
+
+  vector<int> none;
+  this->_scc.take(none);
+  this->_wcc.take(none);
+  this->_nb_scc           = 0;
+  this->_largest_scc      = -1;
+  this->_largest_scc_size = 0;
+
+}
+
+// Collapse the chains of shape nodes of the routing graph
+void Network::contractChains() {
+
+  boost::shared_ptr<ChainContraction> chains(new ChainContraction());
+  chains->build(this->_graph, this->_reverse_graph);
+  this->_chains = chains;
+
+}
+
+// Label the strongly and weakly connected components of the routing graph
+void Network::labelComponents() {
+
+  const RoutingGraph & g = this->_graph;
+  const RoutingGraph & r = this->_reverse_graph;
+  int n = g.getNbNodes();
+
+  // Strongly connected components: Tarjan's algorithm, with an explicit call stack
+  vector<int> scc(n, -1);            // component of each node (-1 while on the stack or not visited)
+  vector<int> index(n, -1);          // visit order of each node
+  vector<int> low(n, 0);             // lowest visit order reachable from the subtree of each node
+  vector<int> next_link(n, 0);       // next outgoing link to explore from each node
+  vector<int> stack;                 // visited nodes not assigned to a component yet
+  vector<int> calls;                 // nodes being explored (recursion stack)
+  int counter = 0;
+  int nb_scc  = 0;
+
+  for (int root = 0; root < n; root++) {
+
+    if (index[root] >= 0) continue;
+    index[root] = low[root] = counter++;
+    next_link[root] = g.beginOut(root);
+    stack.push_back(root);
+    calls.push_back(root);
+
+    while ( !calls.empty() ) {
+
+      int v = calls.back();
+
+      // ... exploring the next link of the node
+      if (next_link[v] < g.endOut(v)) {
+        int w = g.getTarget(next_link[v]++);
+        if (index[w] < 0) {
+          index[w] = low[w] = counter++;
+          next_link[w] = g.beginOut(w);
+          stack.push_back(w);
+          calls.push_back(w);
+        } else if (scc[w] < 0) {
+          low[v] = min(low[v], index[w]);
+        }
+        continue;
+      }
+
+      // ... every link explored: returning to the parent, and closing the component if the node is its root
+      calls.pop_back();
+      if (!calls.empty()) low[calls.back()] = min(low[calls.back()], low[v]);
+      if (low[v] == index[v]) {
+        int w;
+        do {
+          w = stack.back();
+          stack.pop_back();
+          scc[w] = nb_scc;
+        } while (w != v);
+        nb_scc++;
+      }
+
+    }
+
+  }
+
+  // Largest strongly connected component
+  vector<int> sizes(nb_scc, 0);
+  for (int i = 0; i < n; i++) sizes[scc[i]]++;
+  this->_largest_scc      = nb_scc > 0 ? max_element(sizes.begin(), sizes.end()) - sizes.begin() : -1;
+  this->_largest_scc_size = nb_scc > 0 ? sizes[this->_largest_scc] : 0;
+  this->_nb_scc           = nb_scc;
+
+  // Weakly connected components: searches following the links in both directions
+  vector<int> wcc(n, -1);
+  int nb_wcc = 0;
+  for (int root = 0; root < n; root++) {
+    if (wcc[root] >= 0) continue;
+    wcc[root] = nb_wcc;
+    stack.assign(1, root);
+    while ( !stack.empty() ) {
+      int v = stack.back();
+      stack.pop_back();
+      for (int e = g.beginOut(v); e < g.endOut(v); e++) {
+        if (wcc[g.getTarget(e)] < 0) { wcc[g.getTarget(e)] = nb_wcc; stack.push_back(g.getTarget(e)); }
+      }
+      for (int e = r.beginOut(v); e < r.endOut(v); e++) {
+        if (wcc[r.getTarget(e)] < 0) { wcc[r.getTarget(e)] = nb_wcc; stack.push_back(r.getTarget(e)); }
+      }
+    }
+    nb_wcc++;
+  }
+
+  this->_scc.take(scc);
+  this->_wcc.take(wcc);
+
+}
+
+// Check whether a node belongs to the largest strongly connected component
+bool Network::isInLargestComponent(long node_id) const {
+
+  int i = this->_graph.getIndex(node_id);
+  if (i < 0) throw std::out_of_range("Network::isInLargestComponent: unknown node id");
+  return this->isInLargestComponentIndex(i);
+
+}
+
+// Check whether a node may reach another node
+bool Network::mayReach(long source_id, long dest_id) const {
+
+  int source = this->_graph.getIndex(source_id);
+  int dest   = this->_graph.getIndex(dest_id);
+  if (source < 0 || dest < 0) throw std::out_of_range("Network::mayReach: unknown node id");
+  return this->mayReachIndex(source, dest);
+
+}
+
+// Return the x coordinate of a node
+double Network::getNodeX(long node_id) const {
+
+  int i = this->_graph.getIndex(node_id);
+  if (i < 0) throw std::out_of_range("Network::getNodeX: unknown node id");
+  return this->_x[i];
+
+}
+
+// Return the y coordinate of a node
+double Network::getNodeY(long node_id) const {
+
+  int i = this->_graph.getIndex(node_id);
+  if (i < 0) throw std::out_of_range("Network::getNodeY: unknown node id");
+  return this->_y[i];
+
+}
+
+// Return the ins code of a node
+int Network::getNodeIns(long node_id) const {
+
+  int i = this->_graph.getIndex(node_id);
+  if (i < 0) throw std::out_of_range("Network::getNodeIns: unknown node id");
+  return this->_ins[i];
+
+}
+
 // Retrieve a set of nodes of a given distance from a source node
-long Network::getDestFromSource(long source_id, float dist) {
+long Network::getDestFromSource(long source_id, float dist) const {
+
+  return this->getDestFromSource(source_id, dist, RandomGenerators::getInstance()->unif);
+
+}
+
+// Retrieve a set of nodes of a given distance from a source node, using a given random generator
+long Network::getDestFromSource(long source_id, float dist, Ranq1 & rng) const {
+
+  int source = this->_graph.getIndex(source_id);   // index of the source node in the routing graph
+  if (source < 0) throw std::out_of_range("Network::getDestFromSource: unknown node id");
+
+  long dest;
+  if (this->_rings && this->_rings->sample(*this, source, dist, rng, dest)) return dest;
+  if (this->sampleGrid(source, dist, rng, dest)) return dest;
+
+  switch (this->_queue_type) {
+    case QUEUE_4ARY      : return destFromSource<QuaternaryHeapQueue>(source, dist, rng);
+    case QUEUE_RADIX     : return destFromSource<RadixHeapQueue>(source, dist, rng);
+    case QUEUE_DIAL      : return destFromSource<DialQueue>(source, dist, rng);
+    case QUEUE_FIBONACCI : return destFromSource<FibonacciQueue>(source, dist, rng);
+    default              : return destFromSource<BinaryHeapQueue>(source, dist, rng);
+  }
+
+}
+
+// Compute a destination node for each of a batch of requests
+std::vector<long> Network::getDestsFromSources(const std::vector<long> & source_ids, const std::vector<float> & dists) const {
+
+  return this->getDestsFromSources(source_ids, dists, RandomGenerators::getInstance()->unif);
+
+}
+
+// Compute a destination node for each of a batch of requests, using a given random generator
+std::vector<long> Network::getDestsFromSources(const std::vector<long> & source_ids, const std::vector<float> & dists, Ranq1 & rng) const {
+
+  vector<long> dests(source_ids.size(), 0);
+
+  // Requests answered by the distance ring index, the other ones being sorted by source node
+  vector< pair<int, int> > pending;    // (source node index, request)
+  pending.reserve(source_ids.size());
+  for (unsigned int k = 0; k < source_ids.size(); k++) {
+    int source = this->_graph.getIndex(source_ids[k]);
+    if (source < 0) throw std::out_of_range("Network::getDestsFromSources: unknown node id");
+    if (this->_rings && this->_rings->sample(*this, source, dists[k], rng, dests[k])) continue;
+    if (this->sampleGrid(source, dists[k], rng, dests[k])) continue;
+    pending.push_back(make_pair(source, (int) k));
+  }
+  sort(pending.begin(), pending.end());
+
+  // One search by distinct source node
+  vector<int> requests;
+  for (unsigned int first = 0, last = 0; first < pending.size(); first = last) {
+    requests.clear();
+    while (last < pending.size() && pending[last].first == pending[first].first) requests.push_back(pending[last++].second);
+    switch (this->_queue_type) {
+      case QUEUE_4ARY      : destsFromSource<QuaternaryHeapQueue>(pending[first].first, dists, requests, dests, rng); break;
+      case QUEUE_RADIX     : destsFromSource<RadixHeapQueue>(pending[first].first, dists, requests, dests, rng);      break;
+      case QUEUE_DIAL      : destsFromSource<DialQueue>(pending[first].first, dists, requests, dests, rng);           break;
+      case QUEUE_FIBONACCI : destsFromSource<FibonacciQueue>(pending[first].first, dists, requests, dests, rng);      break;
+      default              : destsFromSource<BinaryHeapQueue>(pending[first].first, dists, requests, dests, rng);     break;
+    }
+  }
+
+  return dests;
+
+}
+
+// Single Dijkstra search answering the destination requests of a source node
+template <class Queue> void Network::destsFromSource(int source, const std::vector<float> & dists, const std::vector<int> & requests,
+                                                     std::vector<long> & dests, Ranq1 & rng) const {
+
+  const float  inf         = numeric_limits<float>::max();
+  const bool   restricted  = !this->_scc.empty() && this->_largest_scc_size > 1;   // destinations restricted to the largest component
+  const RoutingGraph & g   = this->_chains ? this->_chains->getCore() : this->_graph;
+  DijkstraWorkspace<Queue> & ws = DijkstraWorkspace<Queue>::local();
+
+  vector< pair<float, int> > reached;  // nodes closer than the search radius (distance, index), by increasing distance
+  vector< pair<float, int> > allowed;  // ... restricted to the largest component
+  float radius = 0.0;                  // every node closer than the radius is in 'reached'
+
+  // Init: the source node is reached or, if it is an interior node of a contracted chain, the ends of its links
+  ws.init(g);
+  if (this->_chains && this->_chains->isInterior(source)) {
+    const ChainContraction & cc = *this->_chains;
+    for (int k = cc.beginLinks(source); k < cc.endLinks(source); k++) {
+      int e = cc.getNodeLink(k);
+      ws.relax(g.getTarget(e), g.getLength(e) - cc.getInteriorOffset(cc.getNodePosition(k)));
+    }
+  } else {
+    ws.relax(source, 0.0);
+  }
+
+  float max_dist = 0.0;
+  for (unsigned int r = 0; r < requests.size(); r++) max_dist = std::max(max_dist, dists[requests[r]]);
+
+  for (unsigned int r = 0; r < requests.size(); r++) {
+
+    float dist    = dists[requests[r]];
+    float epsilon = 250.0;             // error term, unit: meters
+    bool  largest = restricted;
+
+    while (true) {
+
+      // ... extending the search if the band goes beyond the nodes settled so far (the first extension covers every request)
+      if ( dist + epsilon > radius && radius < inf ) {
+
+        float hi = std::max(dist + epsilon, max_dist + 250.0f);
+        while( ws.hasNext() && ( ws.nextDist() < hi ) ) {
+          float d = ws.nextDist();
+          int   i = ws.next();
+          for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+            int j = g.getTarget(e);
+            if ( ws.isSettled(j) == false ) ws.relax(j, d + g.getLength(e));
+          }
+        }
+        radius = ws.hasNext() ? hi : inf;
+
+        reached.clear();
+        if (this->_chains) {
+          collectChainBand(*this, *this->_chains, ws, source, -1.0f, inf, false, reached);
+          sort(reached.begin(), reached.end());
+        } else {
+          const vector<int> & settled = ws.getSettledOrder();
+          reached.reserve(settled.size());
+          for (unsigned int k = 0; k < settled.size(); k++) reached.push_back(make_pair(ws.getDist(settled[k]), settled[k]));
+        }
+        allowed.clear();
+        for (unsigned int k = 0; k < reached.size(); k++) {
+          if ( this->isInLargestComponentIndex(reached[k].second) ) allowed.push_back(reached[k]);
+        }
+
+      }
+
+      // ... feasible nodes: distance in the desirable interval [dist +/- epsilon]
+      const vector< pair<float, int> > & nodes = largest ? allowed : reached;
+      vector< pair<float, int> >::const_iterator first = upper_bound(nodes.begin(), nodes.end(), make_pair(dist - epsilon, numeric_limits<int>::max()));
+      vector< pair<float, int> >::const_iterator last  = lower_bound(first, nodes.end(), make_pair(dist + epsilon, numeric_limits<int>::min()));
+      if ( first < last ) {
+        unsigned int index = rng.int32() % (last - first);
+        dests[requests[r]] = g.getId((first + index)->second);
+        break;
+      }
+
+      // ... increasing the error if no feasible node has been found
+      if ( radius == inf ) {
+        // ... every reachable node is settled: widening the band up to the farthest candidate,
+        //     or drawing outside the largest component if none of its nodes is reachable
+        if ( !nodes.empty() ) epsilon = std::max(epsilon * 2.0f, dist - nodes.back().first + 1.0f);
+        else largest = false;
+      } else {
+        epsilon = epsilon * 2.0;
+      }
+
+    }
+
+  }
+
+}
+
+// Dijkstra search of a destination at a given distance from a source node
+template <class Queue> long Network::destFromSource(int source, float dist, Ranq1 & rng) const {
+
+   if (this->_chains) return this->destFromSourceChains<Queue>(source, dist, rng);
 
    vector<long> result;                  // resulting set of nodes
    float        epsilon = 250.0;         // error term, unit: meters
+   bool         largest = !this->_scc.empty() && this->_largest_scc_size > 1;  // destinations restricted to the largest component
+
+   const RoutingGraph       & g  = this->_graph;
+   DijkstraWorkspace<Queue> & ws = DijkstraWorkspace<Queue>::local();
+
+   // Init: only the source node is reached
+   ws.init(g);
+   ws.relax(source, 0.0);
 
    // Loop until at least one feasible node is found
    while (result.size() < 1) {
-   //while (true) {
-
-     // Init
-     FibonacciHeap<long,float> Q;                              // Fibonnacci heap
-     std::map< long, FibonacciHeapNode<long,float>* > Q_nodes; // array of pointer to the nodes of the F-heap
-     std::set<long> Q_marked;                                  // set of marked nodes
-
-     // ... root node key set to 0
-     Q_nodes[source_id] = Q.insert(source_id,0);
-     Q_marked.insert(source_id);
-
-     // ... every other nodes' key are set to a large number
-     map<long, Node>::iterator itr;
-     for (itr = this->_Nodes.begin(); itr != this->_Nodes.end(); itr++) {
-       if (itr->first != source_id) {
-         Q_nodes.insert( std::pair< long, FibonacciHeapNode<long,float>* >( itr->first, Q.insert(itr->first,std::numeric_limits<float>::max()) ) );
-       }
-     }
-
-     float d = 0.0;  // distance from source
 
-     // Dijkstra loop
-     while( Q.empty() == false && ( d < dist + epsilon ) ) {
+     // ... nodes already settled by the previous iterations that fall into the widened band
+     //     (the previous band did not contain any node, so only its lower extension is scanned)
+     const vector<int> & settled = ws.getSettledOrder();
+     for (int k = (int) settled.size() - 1; k >= 0 && ws.getDist(settled[k]) > dist - epsilon; k--) {
+       if ( !largest || this->isInLargestComponentIndex(settled[k]) ) result.push_back(g.getId(settled[k]));
+     }
 
-       // ... extracting the node with minimum key (i.e. distance from source)
+     // Dijkstra loop, resumed from the current frontier
+     while( ws.hasNext() && ( ws.nextDist() < dist + epsilon ) ) {
 
-       long id_min = Q.minimum()->data();      // id
-       d           = Q.minimum()->key();       // distance
-       Node * i    = &this->_Nodes.at(id_min); // get a pointer to the min node
-       Q_marked.insert(id_min);                // mark the node
+       // ... extracting the node with minimum key (i.e. distance from source) and marking it
+       float d = ws.nextDist();
+       int   i = ws.next();
 
        // ... if the current node's key is in the desirable interval [dist +/- epsilon], adding it to the result
-       if ( (d > dist - epsilon) && (d < dist + epsilon) ) {
-         result.push_back(id_min);
+       if ( d > dist - epsilon && ( !largest || this->isInLargestComponentIndex(i) ) ) {
+         result.push_back(g.getId(i));
        }
 
        // ... updating the distances between starting node and node i's sink nodes if necessary
-       for (unsigned int j = 0; j < i->getLinksOutId().size(); j++) {
-	 
-         long id = this->_Links[i->getLinksOutId().at(j)].getEndNodeId();
+       for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+         int j = g.getTarget(e);
+         if ( ws.isSettled(j) == false ) ws.relax(j, d + g.getLength(e));
+       }
 
-         // ... if node not already marked
-         if ( Q_marked.find(id) == Q_marked.end() ) {
+     }
 
-           float w_ij  = this->_Links[i->getLinksOutId().at(j)].getLength() + d; // new weight
-           float key_j = Q_nodes[id]->key();                                     // current weight
+     // ... increasing the error if no feasible node has been found
+     if ( result.empty() && !ws.hasNext() ) {
+       // ... every reachable node is settled: widening the band up to the farthest candidate,
+       //     or drawing outside the largest component if none of its nodes is reachable
+       int k = (int) settled.size() - 1;
+       while ( k >= 0 && largest && !this->isInLargestComponentIndex(settled[k]) ) k--;
+       if ( k >= 0 ) epsilon = std::max(epsilon * 2.0f, dist - ws.getDist(settled[k]) + 1.0f);
+       else largest = false;
+     } else {
+       epsilon = epsilon * 2.0;
+     }
 
-           // ... update the weight if necessary
-           if ( w_ij < key_j ) Q.decreaseKey(Q_nodes[id],w_ij);
+   }
 
-         }
+   // Randomly returning a node
+   unsigned int index = rng.int32() % (result.size());
+   return result[index];
 
-       }
+}
 
-       // ... removing the min node from the heap
-       Q.deletemin();
+// Draw a destination among the nodes of the spatial grid close enough to the source
+bool Network::sampleGrid(int source, float dist, Ranq1 & rng, long & dest) const {
+
+  if (!this->_grid || !this->_hub_labels || this->_grid->getMinRatio() < GRID_MIN_RATIO) return false;
+
+  float  epsilon = 250.0;                                                       // error term, unit: meters
+  bool   largest = !this->_scc.empty() && this->_largest_scc_size > 1;          // destinations restricted to the largest component
+  double radius  = (dist + epsilon) / this->_grid->getMinRatio();              // euclidean distance of the farthest feasible node
+  double x       = this->_x[source];
+  double y       = this->_y[source];
+
+  // Rejection sampling: the candidates are uniform among the nodes of the disk, hence
+  // the accepted node is uniform among the feasible nodes
+  for (int draws = 0, queries = 0; draws < GRID_SAMPLE_DRAWS && queries < GRID_SAMPLE_QUERIES; draws++) {
+    int i = this->_grid->draw(x, y, radius, rng);
+    if (i < 0) return false;
+    double dx = this->_x[i] - x;
+    double dy = this->_y[i] - y;
+    if (dx * dx + dy * dy > radius * radius) continue;
+    if (largest && !this->isInLargestComponentIndex(i)) continue;
+    if (!this->mayReachIndex(source, i)) continue;
+    queries++;
+    float d = this->_hub_labels->distance(source, i);
+    if (d > dist - epsilon && d < dist + epsilon) {
+      dest = this->_graph.getId(i);
+      return true;
+    }
+  }
+  return false;
+
+}
+
+// Return the node nearest to a point
+long Network::getNearestNode(double x, double y) const {
 
+  if (this->_grid) {
+    int i = this->_grid->nearest(x, y);
+    return (i < 0) ? -1 : this->_graph.getId(i);
+  }
+
+  int    nearest = -1;
+  double best    = std::numeric_limits<double>::max();
+  for (int i = 0; i < this->_graph.getNbNodes(); i++) {
+    double d2 = (this->_x[i] - x) * (this->_x[i] - x) + (this->_y[i] - y) * (this->_y[i] - y);
+    if (d2 < best) {
+      best    = d2;
+      nearest = i;
+    }
+  }
+  return (nearest < 0) ? -1 : this->_graph.getId(nearest);
+
+}
+
+// Compute the distance between two nodes
+float Network::getDistanceNodes(long source_id, long dest_id) const {
+
+  int source = this->_graph.getIndex(source_id);   // index of the source node in the routing graph
+  int dest   = this->_graph.getIndex(dest_id);     // index of the destination node in the routing graph
+  if (source < 0 || dest < 0) throw std::out_of_range("Network::getDistanceNodes: unknown node id");
+
+  if (!this->mayReachIndex(source, dest)) return std::numeric_limits<float>::max();
+
+  if (this->_hub_labels) return this->_hub_labels->distance(source, dest);
+
+  if (this->_ch) return this->_ch->distance(source, dest);
+
+  if (this->_landmarks) return this->_landmarks->distance(this->_graph, source, dest);
+
+  if (this->_bidirectional) return this->getDistanceNodesBidirectional(source_id, dest_id);
+
+  return this->getDistanceNodesDijkstra(source_id, dest_id);
+
+}
+
+// Compute the distance between two nodes with a Dijkstra search
+float Network::getDistanceNodesDijkstra(long source_id, long dest_id) const {
+
+  int source = this->_graph.getIndex(source_id);   // index of the source node in the routing graph
+  int dest   = this->_graph.getIndex(dest_id);     // index of the destination node in the routing graph
+  if (source < 0 || dest < 0) throw std::out_of_range("Network::getDistanceNodesDijkstra: unknown node id");
+
+  switch (this->_queue_type) {
+    case QUEUE_4ARY      : return distanceNodes<QuaternaryHeapQueue>(source, dest);
+    case QUEUE_RADIX     : return distanceNodes<RadixHeapQueue>(source, dest);
+    case QUEUE_DIAL      : return distanceNodes<DialQueue>(source, dest);
+    case QUEUE_FIBONACCI : return distanceNodes<FibonacciQueue>(source, dest);
+    default              : return distanceNodes<BinaryHeapQueue>(source, dest);
+  }
+
+}
+
+// Dijkstra search of the distance between two nodes
+template <class Queue> float Network::distanceNodes(int source, int dest) const {
+
+  if (this->_chains) return this->distanceNodesChains<Queue>(source, dest);
+
+  const RoutingGraph       & g  = this->_graph;
+  DijkstraWorkspace<Queue> & ws = DijkstraWorkspace<Queue>::local();
+
+  // Init: only the source node is reached
+  ws.init(g);
+  ws.relax(source, 0.0);
+
+  // Dijkstra loop
+  while( ws.hasNext() ) {
+
+    // ... extracting the node with minimum key (i.e. distance from source) and marking it
+    float d = ws.nextDist();
+    int   i = ws.next();
+
+    if ( i == dest ) return d;
+
+    // ... updating the distances between starting node and node i's sink nodes if necessary
+    for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+      int j = g.getTarget(e);
+      if ( ws.isSettled(j) == false ) ws.relax(j, d + g.getLength(e));
+    }
+
+  }
+
+  // destination not reachable from the source
+  return std::numeric_limits<float>::max();
+
+}
+
+// Dijkstra search of a destination at a given distance on the graph with contracted chains
+template <class Queue> long Network::destFromSourceChains(int source, float dist, Ranq1 & rng) const {
+
+   vector< pair<float, int> > result;    // resulting set of nodes (distance, index)
+   float        epsilon = 250.0;         // error term, unit: meters
+   bool         largest = !this->_scc.empty() && this->_largest_scc_size > 1;  // destinations restricted to the largest component
+
+   const ChainContraction   & cc = *this->_chains;
+   const RoutingGraph       & g  = cc.getCore();
+   DijkstraWorkspace<Queue> & ws = DijkstraWorkspace<Queue>::local();
+
+   // Init: the source node is reached or, if it is an interior node, the ends of its contracted links
+   ws.init(g);
+   if (cc.isInterior(source)) {
+     for (int k = cc.beginLinks(source); k < cc.endLinks(source); k++) {
+       int e = cc.getNodeLink(k);
+       ws.relax(g.getTarget(e), g.getLength(e) - cc.getInteriorOffset(cc.getNodePosition(k)));
+     }
+   } else {
+     ws.relax(source, 0.0);
+   }
+
+   // Loop until at least one feasible node is found
+   while (result.size() < 1) {
+
+     // Dijkstra loop on the core graph, resumed from the current frontier
+     while( ws.hasNext() && ( ws.nextDist() < dist + epsilon ) ) {
+       float d = ws.nextDist();
+       int   i = ws.next();
+       for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+         int j = g.getTarget(e);
+         if ( ws.isSettled(j) == false ) ws.relax(j, d + g.getLength(e));
+       }
      }
 
+     // ... core and interior nodes in the desirable interval [dist +/- epsilon]
+     collectChainBand(*this, cc, ws, source, dist - epsilon, dist + epsilon, largest, result);
+
      // ... increasing the error if no feasible node has been found
-     epsilon = epsilon * 2.0;
+     if ( result.empty() && !ws.hasNext() ) {
+       // ... every reachable node is settled: widening the band up to the farthest candidate,
+       //     or drawing outside the largest component if none of its nodes is reachable
+       collectChainBand(*this, cc, ws, source, -1.0f, numeric_limits<float>::max(), largest, result);
+       float farthest = -1.0;
+       for (unsigned int k = 0; k < result.size(); k++) farthest = std::max(farthest, result[k].first);
+       result.clear();
+       if ( farthest >= 0.0 ) epsilon = std::max(epsilon * 2.0f, dist - farthest + 1.0f);
+       else largest = false;
+     } else {
+       epsilon = epsilon * 2.0;
+     }
 
    }
 
    // Randomly returning a node
-   unsigned int index = RandomGenerators::getInstance()->unif.int32() % (result.size());
-   return result[index];
+   unsigned int index = rng.int32() % (result.size());
+   return g.getId(result[index].second);
 
 }
 
-float Network::getDistanceNodes(long source_id, long dest_id) {
+// Dijkstra search of the distance between two nodes on the graph with contracted chains
+template <class Queue> float Network::distanceNodesChains(int source, int dest) const {
+
+  if (source == dest) return 0.0;
+
+  const ChainContraction   & cc = *this->_chains;
+  const RoutingGraph       & g  = cc.getCore();
+  DijkstraWorkspace<Queue> & ws = DijkstraWorkspace<Queue>::local();
+  float best = std::numeric_limits<float>::max();   // shortest distance found so far
+
+  // Init: the source node is reached or, if it is an interior node, the ends of its contracted links
+  ws.init(g);
+  if (cc.isInterior(source)) {
+    for (int k = cc.beginLinks(source); k < cc.endLinks(source); k++) {
+      int e = cc.getNodeLink(k);
+      ws.relax(g.getTarget(e), g.getLength(e) - cc.getInteriorOffset(cc.getNodePosition(k)));
+      // ... the destination may follow the source on the link
+      for (int kd = cc.beginLinks(dest); kd < cc.endLinks(dest); kd++) {
+        if ( cc.getNodeLink(kd) == e && cc.getNodePosition(kd) > cc.getNodePosition(k) ) {
+          best = std::min(best, cc.getInteriorOffset(cc.getNodePosition(kd)) - cc.getInteriorOffset(cc.getNodePosition(k)));
+        }
+      }
+    }
+  } else {
+    ws.relax(source, 0.0);
+  }
 
-  float d = 0.0;                        // distance from source
-  long curr_node = source_id;           // current node found by Dijkstra algorithm
+  // Dijkstra loop, until no node closer than the best distance found remains
+  while( ws.hasNext() && ws.nextDist() < best ) {
 
-  // Init
-  FibonacciHeap<long,float> Q;                              // Fibonnacci heap
-  std::map< long, FibonacciHeapNode<long,float>* > Q_nodes; // array of pointer to the nodes of the F-heap
-  std::set<long> Q_marked;                                  // set of marked nodes
+    float d = ws.nextDist();
+    int   i = ws.next();
 
-  // ... root node key set to 0
-  Q_nodes[curr_node] = Q.insert(curr_node,0);
-  Q_marked.insert(curr_node);
+    if ( i == dest ) return d;
 
-  // ... every other nodes' key are set to a large number
-  map<long, Node>::iterator itr;
-  for (itr = this->_Nodes.begin(); itr != this->_Nodes.end(); itr++) {
-    if (itr->first != curr_node) {
-      Q_nodes.insert( std::pair< long, FibonacciHeapNode<long,float>* >( itr->first, Q.insert(itr->first,std::numeric_limits<float>::max()) ) );
+    // ... an interior destination is reached through the contracted links leaving i
+    for (int kd = cc.beginLinks(dest); kd < cc.endLinks(dest); kd++) {
+      if ( cc.getLinkSource(cc.getNodeLink(kd)) == i ) best = std::min(best, d + cc.getInteriorOffset(cc.getNodePosition(kd)));
+    }
+
+    for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+      int j = g.getTarget(e);
+      if ( ws.isSettled(j) == false ) ws.relax(j, d + g.getLength(e));
     }
+
   }
 
-  // Dijkstra loop
-  while( curr_node != dest_id ) {
+  // shortest distance found, the largest float if the destination is not reachable from the source
+  return best;
 
-    // ... extracting the node with minimum key (i.e. distance from source)
+}
 
-    curr_node   = Q.minimum()->data();         // id
-    d           = Q.minimum()->key();          // distance
-    Node * i    = &this->_Nodes.at(curr_node); // get a pointer to the min node
-    Q_marked.insert(curr_node);                // mark the node
 
-    // ... updating the distances between starting node and node i's sink nodes if necessary
-    for (unsigned int j = 0; j < i->getLinksOutId().size(); j++) {
+// Compute the distance between two nodes with a bidirectional Dijkstra search
+float Network::getDistanceNodesBidirectional(long source_id, long dest_id) const {
+
+  int source = this->_graph.getIndex(source_id);   // index of the source node in the routing graph
+  int dest   = this->_graph.getIndex(dest_id);     // index of the destination node in the routing graph
+  if (source < 0 || dest < 0) throw std::out_of_range("Network::getDistanceNodesBidirectional: unknown node id");
+
+  switch (this->_queue_type) {
+    case QUEUE_4ARY      : return distanceNodesBidirectional<QuaternaryHeapQueue>(source, dest);
+    case QUEUE_RADIX     : return distanceNodesBidirectional<RadixHeapQueue>(source, dest);
+    case QUEUE_DIAL      : return distanceNodesBidirectional<DialQueue>(source, dest);
+    case QUEUE_FIBONACCI : return distanceNodesBidirectional<FibonacciQueue>(source, dest);
+    default              : return distanceNodesBidirectional<BinaryHeapQueue>(source, dest);
+  }
+
+}
+
+// Bidirectional Dijkstra search of the distance between two nodes
+template <class Queue> float Network::distanceNodesBidirectional(int source, int dest) const {
+
+  if ( source == dest ) return 0.0;
+
+  const RoutingGraph       * graphs[2] = {&this->_graph, &this->_reverse_graph};
+  DijkstraWorkspace<Queue> * ws[2]     = {&DijkstraWorkspace<Queue>::local(0), &DijkstraWorkspace<Queue>::local(1)};
+  float                      best      = std::numeric_limits<float>::max();   // length of the shortest path found
+
+  // Init: only the source node is reached forward, only the destination node backward
+  ws[0]->init(*graphs[0]);
+  ws[0]->relax(source, 0.0);
+  ws[1]->init(*graphs[1]);
+  ws[1]->relax(dest, 0.0);
+
+  // Dijkstra loops (a search which has settled every node it can reach has already found the shortest path)
+  while( ws[0]->hasNext() && ws[1]->hasNext() ) {
+
+    // ... stopping criterion: no path shorter than the best one can go through the unsettled nodes
+    float next_forward  = ws[0]->nextDist();
+    float next_backward = ws[1]->nextDist();
+    if ( next_forward + next_backward >= best ) break;
+
+    // ... advancing the search whose next node is the closest to its origin
+    int k = ( next_forward <= next_backward ) ? 0 : 1;
+    const RoutingGraph       & g     = *graphs[k];
+    DijkstraWorkspace<Queue> & w     = *ws[k];
+    DijkstraWorkspace<Queue> & other = *ws[1 - k];
+
+    float d = w.nextDist();
+    int   i = w.next();
+
+    // ... updating the distances of node i's neighbours, and the best path through the links reaching the other search
+    for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+      int   j  = g.getTarget(e);
+      float dj = d + g.getLength(e);
+      if ( w.isSettled(j) == false ) w.relax(j, dj);
+      float dj_other = other.getDist(j);
+      if ( dj_other < std::numeric_limits<float>::max() && dj + dj_other < best ) best = dj + dj_other;
+    }
+
+  }
+
+  return best;
+
+}
+
+// Compare the bidirectional and unidirectional searches
+double Network::compareBidirectional(int nQueries, double & maxError) const {
+
+  Ranq1 rng(nQueries);                    // own generator: the simulation's draws are left unchanged
+  int   n = this->_graph.getNbNodes();
+  vector<long>  sources(nQueries), dests(nQueries);
+  vector<float> dist(nQueries);
+  for (int q = 0; q < nQueries && n > 0; q++) {
+    sources[q] = this->_graph.getId(rng.int32() % n);
+    dests[q]   = this->_graph.getId(rng.int32() % n);
+  }
+
+  clock_t start = clock();
+  for (int q = 0; q < nQueries && n > 0; q++) dist[q] = this->getDistanceNodesDijkstra(sources[q], dests[q]);
+  double time_uni = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  maxError = 0.0;
+  start = clock();
+  for (int q = 0; q < nQueries && n > 0; q++) {
+    float d = this->getDistanceNodesBidirectional(sources[q], dests[q]);
+    if ( dist[q] > 0.0 && dist[q] < std::numeric_limits<float>::max() ) maxError = std::max(maxError, fabs(d - dist[q]) / (double) dist[q]);
+    else if ( d != dist[q] ) maxError = std::max(maxError, 1.0);
+  }
+  double time_bi = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  return ( time_bi > 0.0 ) ? time_uni / time_bi : 0.0;
+
+}
+
+// Number of nodes settled by the last Dijkstra search of the calling thread
+int Network::getNbSettled() const {
+
+  switch (this->_queue_type) {
+    case QUEUE_4ARY      : return DijkstraWorkspace<QuaternaryHeapQueue>::local().getSettledOrder().size();
+    case QUEUE_RADIX     : return DijkstraWorkspace<RadixHeapQueue>::local().getSettledOrder().size();
+    case QUEUE_DIAL      : return DijkstraWorkspace<DialQueue>::local().getSettledOrder().size();
+    case QUEUE_FIBONACCI : return DijkstraWorkspace<FibonacciQueue>::local().getSettledOrder().size();
+    default              : return DijkstraWorkspace<BinaryHeapQueue>::local().getSettledOrder().size();
+  }
+
+}
+
+// Compare the node orders
+void Network::benchmarkNodeOrders(const std::string & aLabel, int nQueries, std::ostream & out) const {
+
+  int n = this->_graph.getNbNodes();
+  if (n == 0) return;
+
+  // Random queries, identical for every order (own generator: the simulation's draws are left unchanged)
+  Ranq1 rng(nQueries);
+  vector<long> sources(nQueries), dests(nQueries);
+  for (int q = 0; q < nQueries; q++) {
+    sources[q] = this->_graph.getId(rng.int32() % n);
+    dests[q]   = this->_graph.getId(rng.int32() % n);
+  }
+
+  // Copy of the routing data of the network (without the maps of nodes and links)
+  boost::shared_ptr< vector<char> > image(new vector<char>());
+  this->writeBinary(*image);
+
+  // header, unless appending to a log file already holding results
+  if ( out.tellp() <= 0 ) out << "network;order;time;settled_by_query;misses_by_settled" << endl;
+
+  const NodeOrder orders[3] = {ORDER_ID, ORDER_BFS, ORDER_HILBERT};
+  for (int k = 0; k < 3; k++) {
+
+    Network network;
+    if (!network.readBinary(&(*image)[0], image->size(), image)) return;
+    network.setQueueType(this->_queue_type);
+    network.labelComponents();
+    network.reorder(orders[k]);
+
+    // ... a few searches first, so that every order starts with the same warm caches
+    for (int q = 0; q < min(nQueries, 10); q++) network.getDistanceNodesDijkstra(sources[q], dests[q]);
+
+    CacheMissCounter counter;
+    long long settled = 0;
+    clock_t start = clock();
+    counter.start();
+    for (int q = 0; q < nQueries; q++) {
+      network.getDistanceNodesDijkstra(sources[q], dests[q]);
+      settled += network.getNbSettled();
+    }
+    long long misses = counter.stop();
+    double time = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    out << aLabel << ";" << nodeOrderToString(orders[k]) << ";" << time << ";" << (double) settled / max(nQueries, 1) << ";";
+    if (misses >= 0 && settled > 0) out << (double) misses / settled;
+    else out << "NA";
+    out << endl;
+
+  }
+
+}
+
+// Compute the distances between a node and a set of nodes
+vector<float> Network::getDistancesFromSource(long source_id, const vector<long> & dest_ids) const {
+
+  int source = this->_graph.getIndex(source_id);   // index of the source node in the routing graph
+  if (source < 0) throw std::out_of_range("Network::getDistancesFromSource: unknown node id");
+
+  vector<int> dests(dest_ids.size());              // indices of the destination nodes in the routing graph
+  for (unsigned int k = 0; k < dest_ids.size(); k++) {
+    dests[k] = this->_graph.getIndex(dest_ids[k]);
+    if (dests[k] < 0) throw std::out_of_range("Network::getDistancesFromSource: unknown node id");
+  }
+
+  vector<float> result(dests.size());
+  if (this->_hub_labels) {
+    for (unsigned int k = 0; k < dests.size(); k++) {
+      result[k] = this->mayReachIndex(source, dests[k]) ? this->_hub_labels->distance(source, dests[k]) : std::numeric_limits<float>::max();
+    }
+    return result;
+  }
+  if (this->_ch) {
+    for (unsigned int k = 0; k < dests.size(); k++) {
+      result[k] = this->mayReachIndex(source, dests[k]) ? this->_ch->distance(source, dests[k]) : std::numeric_limits<float>::max();
+    }
+    return result;
+  }
 
-      long id = this->_Links[i->getLinksOutId().at(j)].getEndNodeId();
+  switch (this->_queue_type) {
+    case QUEUE_4ARY      : distancesFrom<QuaternaryHeapQueue>(this->_graph, false, source, dests, result); break;
+    case QUEUE_RADIX     : distancesFrom<RadixHeapQueue>(this->_graph, false, source, dests, result);      break;
+    case QUEUE_DIAL      : distancesFrom<DialQueue>(this->_graph, false, source, dests, result);           break;
+    case QUEUE_FIBONACCI : distancesFrom<FibonacciQueue>(this->_graph, false, source, dests, result);      break;
+    default              : distancesFrom<BinaryHeapQueue>(this->_graph, false, source, dests, result);     break;
+  }
+  return result;
+
+}
+
+// Compute the distances between a set of nodes and a node
+vector<float> Network::getDistancesToDest(const vector<long> & source_ids, long dest_id) const {
+
+  int dest = this->_graph.getIndex(dest_id);       // index of the destination node in the routing graph
+  if (dest < 0) throw std::out_of_range("Network::getDistancesToDest: unknown node id");
+
+  vector<int> sources(source_ids.size());          // indices of the source nodes in the routing graph
+  for (unsigned int k = 0; k < source_ids.size(); k++) {
+    sources[k] = this->_graph.getIndex(source_ids[k]);
+    if (sources[k] < 0) throw std::out_of_range("Network::getDistancesToDest: unknown node id");
+  }
+
+  vector<float> result(sources.size());
+  if (this->_hub_labels) {
+    for (unsigned int k = 0; k < sources.size(); k++) {
+      result[k] = this->mayReachIndex(sources[k], dest) ? this->_hub_labels->distance(sources[k], dest) : std::numeric_limits<float>::max();
+    }
+    return result;
+  }
+  if (this->_ch) {
+    for (unsigned int k = 0; k < sources.size(); k++) {
+      result[k] = this->mayReachIndex(sources[k], dest) ? this->_ch->distance(sources[k], dest) : std::numeric_limits<float>::max();
+    }
+    return result;
+  }
+
+  // search from the destination on the reverse graph
+  switch (this->_queue_type) {
+    case QUEUE_4ARY      : distancesFrom<QuaternaryHeapQueue>(this->_reverse_graph, true, dest, sources, result); break;
+    case QUEUE_RADIX     : distancesFrom<RadixHeapQueue>(this->_reverse_graph, true, dest, sources, result);      break;
+    case QUEUE_DIAL      : distancesFrom<DialQueue>(this->_reverse_graph, true, dest, sources, result);           break;
+    case QUEUE_FIBONACCI : distancesFrom<FibonacciQueue>(this->_reverse_graph, true, dest, sources, result);      break;
+    default              : distancesFrom<BinaryHeapQueue>(this->_reverse_graph, true, dest, sources, result);     break;
+  }
+  return result;
+
+}
+
+// Dijkstra search of the distances between a node and a set of nodes
+template <class Queue> void Network::distancesFrom(const RoutingGraph & g, bool reverse, int source, const vector<int> & dests, vector<float> & result) const {
+
+  DijkstraWorkspace<Queue> & ws = DijkstraWorkspace<Queue>::local();
+
+  // Destination nodes not settled yet (the search does not wait for the nodes it can not reach)
+  vector<int> targets;
+  for (unsigned int k = 0; k < dests.size(); k++) {
+    if ( reverse ? this->mayReachIndex(dests[k], source) : this->mayReachIndex(source, dests[k]) ) targets.push_back(dests[k]);
+  }
+  sort(targets.begin(), targets.end());
+  targets.erase(unique(targets.begin(), targets.end()), targets.end());
+  unsigned int n_remaining = targets.size();
+
+  // Init: only the source node is reached
+  ws.init(g);
+  ws.relax(source, 0.0);
+
+  // Dijkstra loop, until every destination is settled
+  while( n_remaining > 0 && ws.hasNext() ) {
+
+    float d = ws.nextDist();
+    int   i = ws.next();
+
+    if ( binary_search(targets.begin(), targets.end(), i) ) n_remaining--;
+
+    for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+      int j = g.getTarget(e);
+      if ( ws.isSettled(j) == false ) ws.relax(j, d + g.getLength(e));
+    }
+
+  }
 
-      // ... if node not already marked
-      if ( Q_marked.find(id) == Q_marked.end() ) {
+  // Distances of the destinations (the largest float if not reachable)
+  for (unsigned int k = 0; k < dests.size(); k++) {
+    result[k] = ws.isSettled(dests[k]) ? ws.getDist(dests[k]) : std::numeric_limits<float>::max();
+  }
+
+}
+
+
+// Compare the priority queue backends
+void Network::benchmarkQueues(const std::string & aLabel, int nQueries, std::ostream & out) const {
+
+  const RoutingGraph & g = this->_graph;
+  if (g.getNbNodes() == 0) return;
+
+  // Random queries, identical for every backend
+  Ranq1 & rng = RandomGenerators::getInstance()->unif;
+  vector<int>   sources(nQueries);
+  vector<int>   dests(nQueries);
+  vector<float> dists(nQueries);
+  for (int q = 0; q < nQueries; q++) {
+    sources[q] = RandomGenerators::getInstance()->unif.int32() % g.getNbNodes();
+    dests[q]   = RandomGenerators::getInstance()->unif.int32() % g.getNbNodes();
+    dists[q]   = 500.0 + RandomGenerators::getInstance()->fast_unif.doub() * 20000.0;
+  }
+
+  QueueType types[] = { QUEUE_BINARY, QUEUE_4ARY, QUEUE_RADIX, QUEUE_DIAL, QUEUE_FIBONACCI };
+  vector<float> reference;
 
-        float w_ij  = this->_Links[i->getLinksOutId().at(j)].getLength() + d; // new weight
-        float key_j = Q_nodes[id]->key();                                     // current weight
+  // header, unless appending to a log file already holding results
+  if ( out.tellp() <= 0 ) out << "network;queue;n_queries;p2p_time;dest_time;max_diff" << endl;
 
-        // ... update the weight if necessary
-        if ( w_ij < key_j ) Q.decreaseKey(Q_nodes[id],w_ij);
+  for (unsigned int t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
 
+    vector<float> result(nQueries);
+
+    // point to point searches
+    clock_t start = clock();
+    for (int q = 0; q < nQueries; q++) {
+      switch (types[t]) {
+        case QUEUE_4ARY      : result[q] = distanceNodes<QuaternaryHeapQueue>(sources[q], dests[q]); break;
+        case QUEUE_RADIX     : result[q] = distanceNodes<RadixHeapQueue>(sources[q], dests[q]);      break;
+        case QUEUE_DIAL      : result[q] = distanceNodes<DialQueue>(sources[q], dests[q]);           break;
+        case QUEUE_FIBONACCI : result[q] = distanceNodes<FibonacciQueue>(sources[q], dests[q]);      break;
+        default              : result[q] = distanceNodes<BinaryHeapQueue>(sources[q], dests[q]);     break;
       }
+    }
+    double p2p_time = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    // destination searches
+    start = clock();
+    for (int q = 0; q < nQueries; q++) {
+      switch (types[t]) {
+        case QUEUE_4ARY      : destFromSource<QuaternaryHeapQueue>(sources[q], dists[q], rng); break;
+        case QUEUE_RADIX     : destFromSource<RadixHeapQueue>(sources[q], dists[q], rng);      break;
+        case QUEUE_DIAL      : destFromSource<DialQueue>(sources[q], dists[q], rng);           break;
+        case QUEUE_FIBONACCI : destFromSource<FibonacciQueue>(sources[q], dists[q], rng);      break;
+        default              : destFromSource<BinaryHeapQueue>(sources[q], dists[q], rng);     break;
+      }
+    }
+    double dest_time = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    // checking the distances against the first backend
+    if (reference.empty()) reference = result;
+    float max_diff = 0.0;
+    for (int q = 0; q < nQueries; q++) {
+      max_diff = std::max(max_diff, (float) fabs(result[q] - reference[q]));
+    }
+
+    out << aLabel << ";" << queueTypeToString(types[t]) << ";" << nQueries << ";" << p2p_time << ";" << dest_time << ";" << max_diff << endl;
+
+  }
+
+}
+
 
+// Build the CSR arrays of the routing graph
+void RoutingGraph::build(const std::map<long, Node> & nodes, const std::map<long, Link> & links) {
+
+  // Node indices: rank of the node id in increasing order (std::map is sorted)
+  vector<long> ids;
+  ids.reserve(nodes.size());
+  for (map<long, Node>::const_iterator it = nodes.begin(); it != nodes.end(); it++) {
+    ids.push_back(it->first);
+  }
+  vector<long> index_ids(ids);
+  this->_ids.take(index_ids);
+
+  // Arcs between known nodes
+  vector<int>   sources;
+  vector<int>   targets;
+  vector<float> lengths;
+  sources.reserve(links.size());
+  targets.reserve(links.size());
+  lengths.reserve(links.size());
+  for (map<long, Link>::const_iterator it = links.begin(); it != links.end(); it++) {
+    int s = this->getIndex(it->second.getStartNodeId());
+    int t = this->getIndex(it->second.getEndNodeId());
+    if (s >= 0 && t >= 0) {
+      sources.push_back(s);
+      targets.push_back(t);
+      lengths.push_back(it->second.getLength());
     }
+  }
+
+  this->build(ids, sources, targets, lengths);
+
+}
+
+// Build the CSR arrays from a list of arcs
+void RoutingGraph::build(const vector<long> & ids, const vector<int> & sources,
+                         const vector<int> & targets, const vector<float> & lengths) {
+
+  int n = ids.size();
+
+  // Counting the outgoing links of each node
+  vector<int> offsets(n + 1, 0);
+  for (unsigned int e = 0; e < sources.size(); e++) {
+    offsets[sources[e] + 1]++;
+  }
+  for (int i = 0; i < n; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+
+  // Filling the target and length arrays
+  vector<int>   csr_targets(offsets[n], 0);
+  vector<float> csr_lengths(offsets[n], 0.0);
+  vector<int>   pos(offsets.begin(), offsets.end() - 1);
+  for (unsigned int e = 0; e < sources.size(); e++) {
+    csr_targets[pos[sources[e]]] = targets[e];
+    csr_lengths[pos[sources[e]]] = lengths[e];
+    pos[sources[e]]++;
+  }
+
+  vector<long> csr_ids(ids);
+  this->_ids.take(csr_ids);
+  this->_offsets.take(offsets);
+  this->_targets.take(csr_targets);
+  this->_lengths.take(csr_lengths);
+  this->computeIdTable();
+  this->computeLengthBounds();
+  this->computeChecksum();
+
+}
+
+// Refer to CSR arrays stored in an external memory block
+void RoutingGraph::view(int n, const long * ids, const long * sortedIds, const int * sortedIndex, const int * offsets, const int * targets,
+                        const float * lengths, float minLength, float maxLength, unsigned long long checksum, const boost::shared_ptr<const void> & owner) {
+
+  this->_ids.view(ids, n, owner);
+  this->_sorted_ids.view(sortedIds, sortedIds != NULL ? n : 0, owner);
+  this->_sorted_index.view(sortedIndex, sortedIndex != NULL ? n : 0, owner);
+  this->_offsets.view(offsets, n + 1, owner);
+  this->_targets.view(targets, offsets[n], owner);
+  this->_lengths.view(lengths, offsets[n], owner);
+  this->_min_length = minLength;
+  this->_max_length = maxLength;
+  this->_checksum   = checksum;
+
+}
+
+// Translation table of the node ids
+void RoutingGraph::computeIdTable() {
+
+  vector<long> sorted_ids;
+  vector<int>  sorted_index;
+
+  // no table if the nodes are indexed by increasing id
+  int n = this->_ids.size();
+  int i = 1;
+  while (i < n && this->_ids[i - 1] < this->_ids[i]) i++;
+  if (i < n) {
+    vector< pair<long, int> > table(n);
+    for (int k = 0; k < n; k++) table[k] = make_pair(this->_ids[k], k);
+    sort(table.begin(), table.end());
+    sorted_ids.resize(n);
+    sorted_index.resize(n);
+    for (int k = 0; k < n; k++) {
+      sorted_ids[k]   = table[k].first;
+      sorted_index[k] = table[k].second;
+    }
+  }
+
+  this->_sorted_ids.take(sorted_ids);
+  this->_sorted_index.take(sorted_index);
+
+}
+
+// Bounds of the link lengths (used to set up some priority queues)
+void RoutingGraph::computeLengthBounds() {
+
+  this->_min_length = 0.0;
+  this->_max_length = 0.0;
+  for (unsigned int e = 0; e < this->_lengths.size(); e++) {
+    if (this->_lengths[e] > 0.0 && (this->_min_length == 0.0 || this->_lengths[e] < this->_min_length)) this->_min_length = this->_lengths[e];
+    if (this->_lengths[e] > this->_max_length) this->_max_length = this->_lengths[e];
+  }
+
+}
+
+// Build the reverse of a routing graph
+void RoutingGraph::buildReverse(const RoutingGraph & g) {
+
+  vector<long>  ids(g.getNbNodes());
+  vector<int>   sources;
+  vector<int>   targets;
+  vector<float> lengths;
+  sources.reserve(g.getNbLinks());
+  targets.reserve(g.getNbLinks());
+  lengths.reserve(g.getNbLinks());
+  for (int i = 0; i < g.getNbNodes(); i++) {
+    ids[i] = g.getId(i);
+    for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+      sources.push_back(g.getTarget(e));
+      targets.push_back(i);
+      lengths.push_back(g.getLength(e));
+    }
+  }
+
+  this->build(ids, sources, targets, lengths);
+
+}
+
+// FNV-1a hash of a memory block
+static unsigned long long fnv1a(const void * data, size_t size, unsigned long long hash) {
+
+  const unsigned char * bytes = (const unsigned char *) data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+
+}
+
+// Checksum of the routing graph
+void RoutingGraph::computeChecksum() {
+
+  unsigned long long hash = 14695981039346656037ULL;
+  if (!this->_ids.empty())     hash = fnv1a(&this->_ids[0],     this->_ids.size()     * sizeof(long),  hash);
+  if (!this->_offsets.empty()) hash = fnv1a(&this->_offsets[0], this->_offsets.size() * sizeof(int),   hash);
+  if (!this->_targets.empty()) hash = fnv1a(&this->_targets[0], this->_targets.size() * sizeof(int),   hash);
+  if (!this->_lengths.empty()) hash = fnv1a(&this->_lengths[0], this->_lengths.size() * sizeof(float), hash);
+  this->_checksum = hash;
+
+}
+
+// Write an array in binary format (size followed by the elements)
+template <typename T> static void writeArray(std::ostream & out, const ConstArray<T> & v) {
+
+  unsigned long long size = v.size();
+  out.write((const char *) &size, sizeof(size));
+  if (size > 0) out.write((const char *) &v[0], size * sizeof(T));
+
+}
+
+// Read an array written by writeArray
+template <typename T> static bool readArray(std::istream & in, ConstArray<T> & a) {
+
+  unsigned long long size = 0;
+  if (!in.read((char *) &size, sizeof(size))) return false;
+  vector<T> v(size);
+  if (size > 0) in.read((char *) &v[0], size * sizeof(T));
+  a.take(v);
+  return (bool) in;
+
+}
+
+// Write the routing graph
+void RoutingGraph::write(std::ostream & out) const {
+
+  writeArray(out, this->_ids);
+  writeArray(out, this->_offsets);
+  writeArray(out, this->_targets);
+  writeArray(out, this->_lengths);
+  out.write((const char *) &this->_min_length, sizeof(float));
+  out.write((const char *) &this->_max_length, sizeof(float));
+
+}
+
+// Read the routing graph
+bool RoutingGraph::read(std::istream & in) {
+
+  bool ok = readArray(in, this->_ids) && readArray(in, this->_offsets) && readArray(in, this->_targets) && readArray(in, this->_lengths);
+  ok = ok && in.read((char *) &this->_min_length, sizeof(float)) && in.read((char *) &this->_max_length, sizeof(float));
+  this->computeIdTable();
+  this->computeChecksum();
+  return ok && this->_offsets.size() == this->_ids.size() + 1 && this->_targets.size() == this->_lengths.size()
+            && (unsigned int) this->_offsets.back() == this->_targets.size();
+
+}
 
-    // ... removing the min node from the heap
-    Q.deletemin();
+// Return the index of a node id
+int RoutingGraph::getIndex(long id) const {
 
+  if (this->_sorted_ids.empty()) {
+    const long * it = std::lower_bound(this->_ids.begin(), this->_ids.end(), id);
+    if (it == this->_ids.end() || *it != id) return -1;
+    return (int) (it - this->_ids.begin());
   }
 
-  return d;
+  const long * it = std::lower_bound(this->_sorted_ids.begin(), this->_sorted_ids.end(), id);
+  if (it == this->_sorted_ids.end() || *it != id) return -1;
+  return this->_sorted_index[it - this->_sorted_ids.begin()];
 
 }
 
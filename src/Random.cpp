@@ -9,6 +9,214 @@
  ****************************************************************/
 
 #include "../include/Random.hpp"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+const unsigned int RANDOM_BLOCK = 4096;   // number of draws pre-drawn at once by BatchMixtureLogNormal
+
+namespace {
+
+  // Uniform draws of the Box-Muller transform: u1 in (0,1] (its logarithm is taken), u2 in [0,1)
+  inline void boxMullerUniforms(Ranq1 & rng, float * u1, float * u2, int n) {
+
+    for( int i = 0; i < n; i++ ) {
+      u1[i] = 1.0 - rng.doub();
+      u2[i] = rng.doub();
+    }
+
+  }
+
+#ifdef __AVX2__
+
+  // Natural logarithm of 8 positive floats (polynomial approximation of Cephes' logf)
+  inline __m256 log8(__m256 x) {
+
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    // x = m * 2^e, with m in [sqrt(1/2), sqrt(2))
+    __m256i ix = _mm256_castps_si256(x);
+    __m256  e  = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(ix, 23), _mm256_set1_epi32(126)));
+    __m256  m  = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(ix, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f000000)));
+    __m256  small = _mm256_cmp_ps(m, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+    e = _mm256_sub_ps(e, _mm256_and_ps(small, one));
+    m = _mm256_add_ps(_mm256_sub_ps(m, one), _mm256_and_ps(small, m));
+
+    __m256 z = _mm256_mul_ps(m, m);
+    __m256 y = _mm256_set1_ps(7.0376836292E-2f);
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(-1.1514610310E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(1.1676998740E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(-1.2420140846E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(1.4249322787E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(-1.6668057665E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(2.0000714765E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(-2.4999993993E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(3.3333331174E-1f));
+    y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+    y = _mm256_add_ps(y, _mm256_mul_ps(e, _mm256_set1_ps(-2.12194440e-4f)));
+    y = _mm256_sub_ps(y, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+    return _mm256_add_ps(_mm256_add_ps(m, y), _mm256_mul_ps(e, _mm256_set1_ps(0.693359375f)));
+
+  }
+
+  // Exponential of 8 floats (polynomial approximation of Cephes' expf)
+  inline __m256 exp8(__m256 x) {
+
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.3365447505f)), _mm256_set1_ps(88.3762626647949f));
+
+    // x = n log(2) + r, with |r| <= log(2) / 2
+    __m256 n = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)), _mm256_set1_ps(0.5f)));
+    __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(0.693359375f)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(n, _mm256_set1_ps(-2.12194440e-4f)));
+
+    __m256 y = _mm256_set1_ps(1.9875691500E-4f);
+    y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(1.3981999507E-3f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(8.3334519073E-3f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(4.1665795894E-2f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(1.6666665459E-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, r), _mm256_set1_ps(5.0000001201E-1f));
+    y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(y, _mm256_mul_ps(r, r)), r), _mm256_set1_ps(1.0f));
+
+    // ... times 2^n, built from the exponent bits
+    __m256i pow2n = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+
+  }
+
+  // Cosine and sine of 2 pi u for 8 floats u in [0,1) (polynomial approximations of Cephes on [-pi/4, pi/4])
+  inline void sincos8(__m256 u, __m256 & c, __m256 & s) {
+
+    // quarter of turn q and angle a - pi/4 in [-pi/4, pi/4) within the quarter
+    __m256  t = _mm256_mul_ps(u, _mm256_set1_ps(4.0f));
+    __m256  q = _mm256_floor_ps(t);
+    __m256  a = _mm256_mul_ps(_mm256_sub_ps(_mm256_sub_ps(t, q), _mm256_set1_ps(0.5f)), _mm256_set1_ps(1.57079632679489662f));
+    __m256  z = _mm256_mul_ps(a, a);
+
+    __m256 sa = _mm256_set1_ps(-1.9515295891E-4f);
+    sa = _mm256_add_ps(_mm256_mul_ps(sa, z), _mm256_set1_ps(8.3321608736E-3f));
+    sa = _mm256_add_ps(_mm256_mul_ps(sa, z), _mm256_set1_ps(-1.6666654611E-1f));
+    sa = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sa, z), a), a);
+
+    __m256 ca = _mm256_set1_ps(2.443315711809948E-5f);
+    ca = _mm256_add_ps(_mm256_mul_ps(ca, z), _mm256_set1_ps(-1.388731625493765E-3f));
+    ca = _mm256_add_ps(_mm256_mul_ps(ca, z), _mm256_set1_ps(4.166664568298827E-2f));
+    ca = _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(ca, z), z), _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+    ca = _mm256_add_ps(ca, _mm256_set1_ps(1.0f));
+
+    // angle within the quarter: a + pi/4
+    __m256 half_sqrt2 = _mm256_set1_ps(0.707106781186547524f);
+    __m256 cq = _mm256_mul_ps(_mm256_sub_ps(ca, sa), half_sqrt2);
+    __m256 sq = _mm256_mul_ps(_mm256_add_ps(sa, ca), half_sqrt2);
+
+    // rotation by q quarters of turn: odd quarters swap (c, s) into (-s, c), the last two negate both
+    __m256i qi   = _mm256_cvtps_epi32(q);
+    __m256  odd  = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(qi, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+    __m256  neg  = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(qi, _mm256_set1_epi32(2)), 30));
+    __m256  sign = _mm256_set1_ps(-0.0f);
+    c = _mm256_blendv_ps(cq, _mm256_xor_ps(sq, sign), odd);
+    s = _mm256_blendv_ps(sq, cq, odd);
+    c = _mm256_xor_ps(c, neg);
+    s = _mm256_xor_ps(s, neg);
+
+  }
+
+#endif
+
+}
+
+// Fill an array with standard normal draws
+void normal_block(Ranq1 & rng, float * z, int n) {
+
+  float u1[16], u2[16];
+  int   i = 0;
+
+#ifdef __AVX2__
+  // ... 8 pairs at a time
+  for( ; i + 16 <= n; i += 16 ) {
+    boxMullerUniforms(rng, u1, u2, 8);
+    __m256 r = _mm256_sqrt_ps(_mm256_mul_ps(_mm256_set1_ps(-2.0f), log8(_mm256_loadu_ps(u1))));
+    __m256 c, s;
+    sincos8(_mm256_loadu_ps(u2), c, s);
+    _mm256_storeu_ps(z + i,     _mm256_mul_ps(r, c));
+    _mm256_storeu_ps(z + i + 8, _mm256_mul_ps(r, s));
+  }
+#endif
+
+  // ... one pair at a time
+  for( ; i < n; i += 2 ) {
+    boxMullerUniforms(rng, u1, u2, 1);
+    float r     = sqrt(-2.0f * log(u1[0]));
+    float theta = 6.28318530717958648f * u2[0];
+    z[i] = r * cos(theta);
+    if ( i + 1 < n ) z[i + 1] = r * sin(theta);
+  }
+
+}
+
+// Exponentiate an array in place
+void exp_block(float * x, int n) {
+
+  int i = 0;
+
+#ifdef __AVX2__
+  for( ; i + 8 <= n; i += 8 ) _mm256_storeu_ps(x + i, exp8(_mm256_loadu_ps(x + i)));
+#endif
+
+  for( ; i < n; i++ ) x[i] = exp(x[i]);
+
+}
+
+// Make sure that n draws at least are pre-drawn
+void BatchMixtureLogNormal::reserve(unsigned int n) {
+
+  if ( this->normals.size() - this->next >= n ) return;
+
+  unsigned int size = std::max(n, RANDOM_BLOCK);
+  this->normals.resize(size);
+  this->uniforms.resize(size);
+  normal_block(this->rng, &this->normals[0], size);
+  for( unsigned int i = 0; i < size; i++ ) this->uniforms[i] = this->rng.doub();
+  this->next = 0;
+
+}
+
+// Fill an array with draws from bounded mixture distributions (the mixture of the i-th draw being distribs[i * stride])
+void BatchMixtureLogNormal::devs(const dist_param_mixture * distribs, int stride, float * out, int n, float min) {
+
+  if ( n <= 0 ) return;
+
+  // candidate draws from the pre-drawn block, exponentiated at once...
+  this->reserve(n);
+  for( int i = 0; i < n; i++ ) {
+    const dist_param_mixture & distrib = distribs[i * stride];
+    int comp = distrib.drawComponent(this->uniforms[this->next + i]);
+    out[i]   = distrib.mu[comp] + distrib.sigma[comp] * this->normals[this->next + i];
+  }
+  this->next += n;
+  exp_block(out, n);
+
+  // ... only the ones out of the bounds being drawn again (a mixture without component draws 0)
+  for( int i = 0; i < n; i++ ) {
+    const dist_param_mixture & distrib = distribs[i * stride];
+    if ( distrib.size == 0 ) out[i] = 0.0;
+    else while ( out[i] < min || out[i] > distrib.max ) out[i] = this->draw(distrib);
+  }
+
+}
+
+// Fill an array with draws from a mixture distribution bounded from both sides
+void BatchMixtureLogNormal::devs(const dist_param_mixture & distrib, float * out, int n, float min) {
+
+  this->devs(&distrib, 0, out, n, min);
+
+}
+
+// Fill an array with draws from bounded mixture distributions, one mixture by draw
+void BatchMixtureLogNormal::devs(const dist_param_mixture * distribs, float * out, int n) {
+
+  this->devs(distribs, 1, out, n, 0.0);
+
+}
 
 float norm_rand(float mu, float sigma) {
 
@@ -0,0 +1,70 @@
+/****************************************************************
+ * SHAREDSEGMENT.CPP
+ *
+ * This file contains all the definitions of the methods of
+ * SharedSegment.hpp (see this file for methods' documentation)
+ *
+ * Authors: J. Barthelemy
+ * Date   : 9 october 2013
+ ****************************************************************/
+
+#include "../include/SharedSegment.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+using namespace std;
+
+// Constructor: creating a new segment
+SharedSegment::SharedSegment(const string & name, size_t size) : _name(name), _data(NULL), _size(0) {
+
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  if (fd < 0) return;
+
+  if (size > 0 && ftruncate(fd, size) == 0) {
+    void * data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data != MAP_FAILED) {
+      this->_data = (char *) data;
+      this->_size = size;
+    }
+  }
+  close(fd);
+
+  // the segment is useless if it could not be mapped
+  if (this->_data == NULL) shm_unlink(name.c_str());
+
+}
+
+// Constructor: opening an existing segment
+SharedSegment::SharedSegment(const string & name) : _name(name), _data(NULL), _size(0) {
+
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) return;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void * data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data != MAP_FAILED) {
+      this->_data = (char *) data;
+      this->_size = st.st_size;
+    }
+  }
+  close(fd);
+
+}
+
+// Destructor: unmapping the segment
+SharedSegment::~SharedSegment() {
+
+  if (this->_data != NULL) munmap(this->_data, this->_size);
+
+}
+
+// Remove the name of the segment
+void SharedSegment::unlink() {
+
+  shm_unlink(this->_name.c_str());
+
+}
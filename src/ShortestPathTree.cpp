@@ -0,0 +1,197 @@
+/****************************************************************
+ * SHORTESTPATHTREE.CPP
+ *
+ * This file contains all the definitions of the methods of
+ * ShortestPathTree.hpp (see this file for methods' documentation)
+ *
+ * Authors: J. Barthelemy
+ * Date   : 24 september 2013
+ ****************************************************************/
+
+#include "../include/ShortestPathTree.hpp"
+#include <functional>
+#include <algorithm>
+
+
+using namespace std;
+
+// Constructor: only the root is reached
+ShortestPathTree::ShortestPathTree(const RoutingGraph & reverse, int root) : _reverse(&reverse), _root(root), _labels(), _queue() {
+
+  Label l = {0.0, false};
+  this->_labels[root] = l;
+  this->_queue.push_back(Entry(0.0, root));
+
+}
+
+// Distance from a node to the root
+float ShortestPathTree::distanceToRoot(int v) {
+
+  // already settled by a previous query
+  boost::unordered_map<int, Label>::const_iterator it = this->_labels.find(v);
+  if (it != this->_labels.end() && it->second.settled) return it->second.dist;
+
+  // resuming the Dijkstra search until the node is settled
+  const RoutingGraph & g = *this->_reverse;
+  while ( !this->_queue.empty() ) {
+
+    Entry top = this->_queue.front();
+    pop_heap(this->_queue.begin(), this->_queue.end(), greater<Entry>());
+    this->_queue.pop_back();
+
+    Label & l = this->_labels[top.second];
+    if ( l.settled ) continue;   // outdated entry
+    l.settled = true;
+
+    for (int e = g.beginOut(top.second); e < g.endOut(top.second); e++) {
+      int   j = g.getTarget(e);
+      float d = top.first + g.getLength(e);
+      boost::unordered_map<int, Label>::iterator lj = this->_labels.find(j);
+      if ( lj == this->_labels.end() ) {
+        Label nl = {d, false};
+        this->_labels.insert(make_pair(j, nl));
+        this->_queue.push_back(Entry(d, j));
+        push_heap(this->_queue.begin(), this->_queue.end(), greater<Entry>());
+      } else if ( !lj->second.settled && d < lj->second.dist ) {
+        lj->second.dist = d;
+        this->_queue.push_back(Entry(d, j));
+        push_heap(this->_queue.begin(), this->_queue.end(), greater<Entry>());
+      }
+    }
+
+    if ( top.second == v ) return top.first;
+
+  }
+
+  // the root is not reachable from the node
+  return std::numeric_limits<float>::max();
+
+}
+
+// Memory used by the tree (labels with their hash table nodes and buckets, queue)
+size_t ShortestPathTree::getMemory() const {
+
+  return sizeof(ShortestPathTree)
+       + this->_labels.size() * (sizeof(int) + sizeof(Label) + 2 * sizeof(void *))
+       + this->_labels.bucket_count() * sizeof(void *)
+       + this->_queue.capacity() * sizeof(Entry);
+
+}
+
+
+// Constructor
+ShortestPathTreeCache::ShortestPathTreeCache(const Network & network, size_t budget) : _network(network), _budget(budget), _memory(0),
+    _entries(), _lru(), _n_queries(0), _n_built(0), _n_evicted(0) {
+}
+
+// Register a future user of a tree
+void ShortestPathTreeCache::expect(long root_id) {
+
+  int root = this->_network.getGraph().getIndex(root_id);
+  if (root < 0) return;
+
+  boost::unordered_map<int, CacheEntry>::iterator it = this->_entries.find(root);
+  if (it == this->_entries.end()) {
+    CacheEntry entry;
+    entry.pending = 0;
+    entry.memory  = 0;
+    entry.lru     = this->_lru.end();
+    it = this->_entries.insert(make_pair(root, entry)).first;
+  }
+  it->second.pending++;
+
+}
+
+// A user of a tree is done
+void ShortestPathTreeCache::release(long root_id) {
+
+  int root = this->_network.getGraph().getIndex(root_id);
+  boost::unordered_map<int, CacheEntry>::iterator it = this->_entries.find(root);
+  if (it == this->_entries.end()) return;
+
+  it->second.pending--;
+  if (it->second.pending <= 0) {
+    this->evict(root);
+    this->_entries.erase(it);
+  }
+
+}
+
+// Evict a tree
+void ShortestPathTreeCache::evict(int root) {
+
+  CacheEntry & entry = this->_entries[root];
+  if (entry.tree) {
+    this->_memory -= entry.memory;
+    this->_lru.erase(entry.lru);
+    entry.tree.reset();
+    entry.memory = 0;
+    entry.lru    = this->_lru.end();
+  }
+
+}
+
+// Distance between a node and a root
+float ShortestPathTreeCache::getDistance(long source_id, long root_id) {
+
+  const RoutingGraph & g = this->_network.getGraph();
+  int source = g.getIndex(source_id);
+  int root   = g.getIndex(root_id);
+  if (source < 0 || root < 0) throw std::out_of_range("ShortestPathTreeCache::getDistance: unknown node id");
+
+  this->_n_queries++;
+
+  // the root is not reachable from the node: no search
+  if (!this->_network.mayReach(source_id, root_id)) return std::numeric_limits<float>::max();
+
+  // trees of roots that have not been registered are not cached
+  boost::unordered_map<int, CacheEntry>::iterator it = this->_entries.find(root);
+  if (it == this->_entries.end()) {
+    return this->_network.getDistanceNodes(source_id, root_id);
+  }
+
+  // building the tree if needed, and marking it as the most recently used
+  CacheEntry & entry = it->second;
+  if (!entry.tree) {
+    entry.tree = boost::shared_ptr<ShortestPathTree>(new ShortestPathTree(this->_network.getReverseGraph(), root));
+    entry.lru  = this->_lru.insert(this->_lru.begin(), root);
+    this->_n_built++;
+  } else {
+    this->_lru.splice(this->_lru.begin(), this->_lru, entry.lru);
+  }
+
+  float d = entry.tree->distanceToRoot(source);
+
+  // updating the memory used and evicting the least recently used trees if over budget
+  size_t memory = entry.tree->getMemory();
+  this->_memory = this->_memory - entry.memory + memory;
+  entry.memory  = memory;
+  while (this->_memory > this->_budget && this->_lru.size() > 1) {
+    this->evict(this->_lru.back());
+    this->_n_evicted++;
+  }
+
+  return d;
+
+}
+
+// Distances between a set of nodes and a root
+vector<float> ShortestPathTreeCache::getDistances(const vector<long> & source_ids, long root_id) {
+
+  int root = this->_network.getGraph().getIndex(root_id);
+  if (root < 0) throw std::out_of_range("ShortestPathTreeCache::getDistances: unknown node id");
+
+  // trees of roots that have not been registered are not cached
+  if (this->_entries.find(root) == this->_entries.end()) {
+    this->_n_queries += source_ids.size();
+    return this->_network.getDistancesToDest(source_ids, root_id);
+  }
+
+  // every query resumes the same search
+  vector<float> result(source_ids.size());
+  for (unsigned int k = 0; k < source_ids.size(); k++) {
+    result[k] = this->getDistance(source_ids[k], root_id);
+  }
+  return result;
+
+}
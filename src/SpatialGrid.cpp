@@ -0,0 +1,215 @@
+/****************************************************************
+ * SPATIALGRID.CPP
+ *
+ * This file contains all the definitions of the methods of
+ * SpatialGrid.hpp (see this file for methods' documentation)
+ *
+ * Authors: J. Barthelemy
+ * Date   : 18 october 2013
+ ****************************************************************/
+
+#include "../include/SpatialGrid.hpp"
+#include <algorithm>
+#include <cmath>
+
+
+using namespace std;
+
+// Build the grid over the nodes of a road network
+void SpatialGrid::build(const Network & network, double nodesByCell) {
+
+  const RoutingGraph & g = network.getGraph();
+  int n = g.getNbNodes();
+
+  // Bounding box of the network, extended to its nodes
+  double x_min = network.getMinX(), x_max = network.getMaxX();
+  double y_min = network.getMinY(), y_max = network.getMaxY();
+  for (int i = 0; i < n; i++) {
+    x_min = min(x_min, network.getNodeXIndex(i));
+    x_max = max(x_max, network.getNodeXIndex(i));
+    y_min = min(y_min, network.getNodeYIndex(i));
+    y_max = max(y_max, network.getNodeYIndex(i));
+  }
+  if (n == 0) x_min = x_max = y_min = y_max = 0.0;
+
+  // Square cells holding nodesByCell nodes on average
+  double width  = max(x_max - x_min, 1.0);
+  double height = max(y_max - y_min, 1.0);
+  this->_x0        = x_min;
+  this->_y0        = y_min;
+  this->_cell_size = max(sqrt(width * height * max(nodesByCell, 1.0) / max(n, 1)), 1.0);
+  this->_nx        = (n > 0) ? (int) (width / this->_cell_size) + 1 : 0;
+  this->_ny        = (n > 0) ? (int) (height / this->_cell_size) + 1 : 0;
+
+  // Nodes sorted by cell (counting sort)
+  vector<int> cells(n);
+  this->_cell_first.assign((size_t) this->_nx * this->_ny + 1, 0);
+  for (int i = 0; i < n; i++) {
+    cells[i] = this->row(network.getNodeYIndex(i)) * this->_nx + this->column(network.getNodeXIndex(i));
+    this->_cell_first[cells[i] + 1]++;
+  }
+  for (size_t c = 0; c + 1 < this->_cell_first.size(); c++) this->_cell_first[c + 1] += this->_cell_first[c];
+  this->_nodes.resize(n);
+  this->_xs.resize(n);
+  this->_ys.resize(n);
+  vector<int> next_pos(this->_cell_first.begin(), this->_cell_first.end() - 1);
+  for (int i = 0; i < n; i++) {
+    int pos = next_pos[cells[i]]++;
+    this->_nodes[pos] = i;
+    this->_xs[pos]    = network.getNodeXIndex(i) - this->_x0;
+    this->_ys[pos]    = network.getNodeYIndex(i) - this->_y0;
+  }
+
+  // Smallest ratio between the length of a link and the euclidean distance between its nodes
+  this->_min_ratio = 1.0;
+  for (int i = 0; i < n; i++) {
+    for (int e = g.beginOut(i); e < g.endOut(i); e++) {
+      int    j         = g.getTarget(e);
+      double euclidean = hypot(network.getNodeXIndex(j) - network.getNodeXIndex(i), network.getNodeYIndex(j) - network.getNodeYIndex(i));
+      if (euclidean > 0.0) this->_min_ratio = min(this->_min_ratio, max(g.getLength(e), 0.0f) / euclidean);
+    }
+  }
+
+}
+
+// Return the column of the cell of an x coordinate
+int SpatialGrid::column(double x) const {
+
+  double c = floor((x - this->_x0) / this->_cell_size);
+  return (int) max(0.0, min(c, (double) (this->_nx - 1)));
+
+}
+
+// Return the row of the cell of a y coordinate
+int SpatialGrid::row(double y) const {
+
+  double r = floor((y - this->_y0) / this->_cell_size);
+  return (int) max(0.0, min(r, (double) (this->_ny - 1)));
+
+}
+
+// Add the nodes of a cell to the nearest nodes found so far
+void SpatialGrid::scanCell(int cx, int cy, double x, double y, unsigned int k, vector< pair<double, int> > & heap) const {
+
+  int c = cy * this->_nx + cx;
+  for (int pos = this->_cell_first[c]; pos < this->_cell_first[c + 1]; pos++) {
+    double dx = this->_xs[pos] - x;
+    double dy = this->_ys[pos] - y;
+    double d2 = dx * dx + dy * dy;
+    if (heap.size() < k) {
+      heap.push_back(make_pair(d2, this->_nodes[pos]));
+      push_heap(heap.begin(), heap.end());
+    } else if (d2 < heap.front().first) {
+      pop_heap(heap.begin(), heap.end());
+      heap.back() = make_pair(d2, this->_nodes[pos]);
+      push_heap(heap.begin(), heap.end());
+    }
+  }
+
+}
+
+// Return the nearest node of a point
+int SpatialGrid::nearest(double x, double y) const {
+
+  vector<int> result = this->nearest(x, y, 1);
+  return result.empty() ? -1 : result[0];
+
+}
+
+// Return the k nearest nodes of a point
+vector<int> SpatialGrid::nearest(double x, double y, int k) const {
+
+  vector< pair<double, int> > heap;   // (squared distance, node) of the nearest nodes found so far (max-heap)
+  if (k <= 0 || this->_nodes.empty()) return vector<int>();
+
+  // Scanning the rings of cells around the cell of the point, until the nodes of the next
+  // ring are farther than the k-th nearest node found
+  int    cx = this->column(x);
+  int    cy = this->row(y);
+  double qx = x - this->_x0;
+  double qy = y - this->_y0;
+  for (int rho = 0; rho <= max(this->_nx, this->_ny); rho++) {
+    double bound = (rho - 1) * this->_cell_size;   // lower bound of the distance to the nodes of the ring
+    if ((int) heap.size() == k && bound > 0.0 && bound * bound > heap.front().first) break;
+    for (int ry = max(cy - rho, 0); ry <= min(cy + rho, this->_ny - 1); ry++) {
+      if (ry == cy - rho || ry == cy + rho) {
+        for (int rx = max(cx - rho, 0); rx <= min(cx + rho, this->_nx - 1); rx++) this->scanCell(rx, ry, qx, qy, k, heap);
+      } else {
+        if (cx - rho >= 0)       this->scanCell(cx - rho, ry, qx, qy, k, heap);
+        if (cx + rho < this->_nx) this->scanCell(cx + rho, ry, qx, qy, k, heap);
+      }
+    }
+  }
+
+  sort_heap(heap.begin(), heap.end());
+  vector<int> result(heap.size());
+  for (unsigned int p = 0; p < heap.size(); p++) result[p] = heap[p].second;
+  return result;
+
+}
+
+// Return the nodes within a radius of a point
+vector<int> SpatialGrid::withinRadius(double x, double y, double radius) const {
+
+  vector<int> result;
+  if (this->_nodes.empty() || radius < 0.0) return result;
+
+  double qx = x - this->_x0;
+  double qy = y - this->_y0;
+  double r2 = radius * radius;
+  for (int ry = this->row(y - radius); ry <= this->row(y + radius); ry++) {
+    int first = this->_cell_first[ry * this->_nx + this->column(x - radius)];
+    int last  = this->_cell_first[ry * this->_nx + this->column(x + radius) + 1];
+    for (int pos = first; pos < last; pos++) {
+      double dx = this->_xs[pos] - qx;
+      double dy = this->_ys[pos] - qy;
+      if (dx * dx + dy * dy <= r2) result.push_back(this->_nodes[pos]);
+    }
+  }
+  return result;
+
+}
+
+// Return the nodes within a box
+vector<int> SpatialGrid::withinBox(double xMin, double yMin, double xMax, double yMax) const {
+
+  vector<int> result;
+  if (this->_nodes.empty() || xMin > xMax || yMin > yMax) return result;
+
+  for (int ry = this->row(yMin); ry <= this->row(yMax); ry++) {
+    int first = this->_cell_first[ry * this->_nx + this->column(xMin)];
+    int last  = this->_cell_first[ry * this->_nx + this->column(xMax) + 1];
+    for (int pos = first; pos < last; pos++) {
+      double px = this->_xs[pos] + this->_x0;
+      double py = this->_ys[pos] + this->_y0;
+      if (px >= xMin && px <= xMax && py >= yMin && py <= yMax) result.push_back(this->_nodes[pos]);
+    }
+  }
+  return result;
+
+}
+
+// Draw a node uniformly among the nodes of the cells intersecting a square
+int SpatialGrid::draw(double x, double y, double halfSide, Ranq1 & rng) const {
+
+  if (this->_nodes.empty()) return -1;
+
+  // The nodes of a row of cells are contiguous
+  int c0 = this->column(x - halfSide), c1 = this->column(x + halfSide);
+  int r0 = this->row(y - halfSide),    r1 = this->row(y + halfSide);
+  int total = 0;
+  for (int ry = r0; ry <= r1; ry++) {
+    total += this->_cell_first[ry * this->_nx + c1 + 1] - this->_cell_first[ry * this->_nx + c0];
+  }
+  if (total == 0) return -1;
+
+  int k = rng.int32() % total;
+  for (int ry = r0; ry <= r1; ry++) {
+    int first = this->_cell_first[ry * this->_nx + c0];
+    int size  = this->_cell_first[ry * this->_nx + c1 + 1] - first;
+    if (k < size) return this->_nodes[first + k];
+    k -= size;
+  }
+  return -1;
+
+}
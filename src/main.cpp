@@ -107,6 +107,7 @@
 #include <exception>
 #include <time.h>
 #include <iomanip>
+#include <fstream>
 #include "../include/Model.hpp"
 #include "../include/Data.hpp"
 #include "../include/Random.hpp"
@@ -155,8 +156,26 @@ void runSimulation(std::string propsFile, int argc, char ** argv) {
   // Create and initialize the inputs and the model.
   Data::makeInstance(props);
   props.putProperty("data_creation.time", timer.stop());
-  props.putProperty("number.nodes",Data::getInstance()->getNetwork().getNodes().size());
-  props.putProperty("number.links",Data::getInstance()->getNetwork().getLinks().size());
+  props.putProperty("number.nodes",Data::getInstance()->getNetwork().getNbNodes());
+  props.putProperty("number.links",Data::getInstance()->getNetwork().getNbLinks());
+
+  // Benchmarking the priority queues, the node orders and the bidirectional searches (root process only).
+  props.putProperty("routing.bidirectional_speedup", "NA");
+  if (world.rank() == 0 && props.getProperty("routing.benchmark") == "y") {
+    int n_queries = 1000;
+    if ( !props.getProperty("routing.benchmark_queries").empty() ) n_queries = boost::lexical_cast<int>(props.getProperty("routing.benchmark_queries"));
+    cout << "Benchmarking network searches... " << endl;
+    ofstream bench_file("../logs/log_routing_benchmark.csv", ios::out | ios::app);
+    Data::getInstance()->getNetwork().benchmarkQueues(props.getProperty("file.network"), n_queries, bench_file);
+    bench_file.close();
+    ofstream order_file("../logs/log_node_order_benchmark.csv", ios::out | ios::app);
+    Data::getInstance()->getNetwork().benchmarkNodeOrders(props.getProperty("file.network"), n_queries, order_file);
+    order_file.close();
+    double max_error = 0.0;
+    double speedup   = Data::getInstance()->getNetwork().compareBidirectional(n_queries, max_error);
+    props.putProperty("routing.bidirectional_speedup", speedup);
+    cout << "Bidirectional searches: speed-up " << speedup << " over unidirectional searches (max relative difference " << max_error << ")" << endl;
+  }
 
   Model model(&world, props);
   props.putProperty("model_init.time", timer.stop());
@@ -168,6 +187,9 @@ void runSimulation(std::string propsFile, int argc, char ** argv) {
   runner.run();
   props.putProperty("run.time", timer.stop());
 
+  // Saving the distance ring index extended during the simulation (root process only).
+  if (world.rank() == 0) Data::getInstance()->save_ring_index();
+
   // Writing the log file (only for the root process).
   if (world.rank() == 0) {
     vector<string> keysToWrite;
@@ -179,6 +201,7 @@ void runSimulation(std::string propsFile, int argc, char ** argv) {
     keysToWrite.push_back("number.individuals");
     keysToWrite.push_back("number.nodes");
     keysToWrite.push_back("number.links");
+    keysToWrite.push_back("routing.bidirectional_speedup");  // speed-up of the bidirectional searches (NA if not activated)
     props.log("root");
     props.writeToSVFile("../logs/log_simulation.csv", keysToWrite);
   }
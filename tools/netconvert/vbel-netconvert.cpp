@@ -0,0 +1,151 @@
+/****************************************************************
+ * VBEL-NETCONVERT.CPP
+ *
+ * This file contains the tool converting the XML road network of
+ * Virtual Belgium into a binary network file.
+ *
+ * Authors: J. Barthelemy
+ * Date   : 7 october 2013
+ ****************************************************************/
+
+/*! \file vbel-netconvert.cpp
+ *  \brief Conversion of a XML road network into a binary network file (see Network::writeBinary()).
+ *
+ *  Usage: vbel-netconvert network.xml node_ins.csv network.vbn [order [threads]]
+ *
+ *  - network.xml  : the road network (property file.network);
+ *  - node_ins.csv : the ins code of the nodes, one "node id;ins code" line by node (property file.node_ins);
+ *  - network.vbn  : the binary network file to be written (property file.network_bin);
+ *  - order        : the order of the nodes in the file, id, bfs or hilbert (property routing.node_order, default id);
+ *  - threads      : if given, the contraction hierarchy and the hub labels of the network are built offline with this
+ *                   number of threads and cached in network.xml.ch and network.xml.hl (properties routing.ch and
+ *                   routing.hub_labels), an interrupted build of the labels being resumed from network.xml.hl.part.
+ *
+ *  The binary file is read back and compared with the XML network before exiting.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include "../../include/Network.hpp"
+#include "../../include/ContractionHierarchy.hpp"
+#include "../../include/HubLabels.hpp"
+
+using namespace std;
+
+//! Read the ins code of the nodes.
+/*!
+  \param filename the path to the node/ins code file
+  \param nodeIns the resulting map <node id, ins code>
+
+  \return true if the file has been read successfully
+ */
+bool read_node_ins(const string & filename, map<long, int> & nodeIns) {
+
+  ifstream file(filename.c_str(), ios::in);
+  if (!file) return false;
+
+  string a_line;
+  while (getline(file, a_line)) {
+    long node_id;
+    int  ins;
+    if (sscanf(a_line.c_str(), "%ld;%d", &node_id, &ins) == 2) nodeIns.insert(make_pair(node_id, ins));
+  }
+  return true;
+
+}
+
+//! Main function.
+int main(int argc, char ** argv) {
+
+  if (argc < 4 || argc > 6) {
+    cerr << "Usage: " << argv[0] << " network.xml node_ins.csv network.vbn [id|bfs|hilbert [threads]]" << endl;
+    return EXIT_FAILURE;
+  }
+
+  string    filename_xml = argv[1];
+  string    filename_ins = argv[2];
+  string    filename_bin = argv[3];
+  NodeOrder order        = nodeOrderFromString(argc >= 5 ? argv[4] : "id", ORDER_ID);
+  int       nb_threads   = argc == 6 ? atoi(argv[5]) : 0;
+
+  // Reading the XML network
+  clock_t start = clock();
+  map<long, int> node_ins;
+  if (!read_node_ins(filename_ins, node_ins)) {
+    cerr << "Could not open " << filename_ins << endl;
+    return EXIT_FAILURE;
+  }
+  Network network;
+  if (!network.readXml(filename_xml, node_ins)) {
+    cerr << "Could not open " << filename_xml << endl;
+    return EXIT_FAILURE;
+  }
+  cout << "... network read from " << filename_xml << ": " << network.getNbNodes() << " nodes, " << network.getNbLinks() << " links ("
+       << (double) (clock() - start) / CLOCKS_PER_SEC << " s)" << endl;
+
+  // Ordering the nodes
+  if (order != network.getNodeOrder()) network.reorder(order);
+  cout << "... nodes ordered by " << nodeOrderToString(network.getNodeOrder()) << endl;
+
+  // Writing the binary network file
+  if (!network.writeBinary(filename_bin)) {
+    cerr << "Could not write " << filename_bin << endl;
+    return EXIT_FAILURE;
+  }
+
+  // ... and checking it
+  start = clock();
+  Network mapped;
+  if (!mapped.readBinary(filename_bin)) {
+    cerr << "Could not read back " << filename_bin << endl;
+    return EXIT_FAILURE;
+  }
+  double time_mapped = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+  bool ok = mapped.getGraph().getChecksum() == network.getGraph().getChecksum()
+         && mapped.getReverseGraph().getChecksum() == network.getReverseGraph().getChecksum();
+  for (map<long, Node>::const_iterator it = network.getNodes().begin(); ok && it != network.getNodes().end(); it++) {
+    ok = mapped.getNodeX(it->first) == it->second.getX() && mapped.getNodeY(it->first) == it->second.getY()
+      && mapped.getNodeIns(it->first) == it->second.getIns();
+  }
+  if (!ok) {
+    cerr << "The network read back from " << filename_bin << " differs from " << filename_xml << endl;
+    return EXIT_FAILURE;
+  }
+
+  cout << "... network written to " << filename_bin << " (read back in " << time_mapped << " s)" << endl;
+  if (nb_threads <= 0) return EXIT_SUCCESS;
+
+  // Building the contraction hierarchy (unless it is up to date)...
+  const RoutingGraph & graph = mapped.getGraph();
+  string filename_ch = filename_xml + ".ch";
+  ContractionHierarchy ch;
+  if (!ch.load(filename_ch, graph)) {
+    start = clock();
+    ch.build(graph);
+    if (!ch.save(filename_ch)) {
+      cerr << "Could not write " << filename_ch << endl;
+      return EXIT_FAILURE;
+    }
+    cout << "... contraction hierarchy written to " << filename_ch << ": " << ch.getNbShortcuts() << " shortcuts ("
+         << (double) (clock() - start) / CLOCKS_PER_SEC << " s)" << endl;
+  }
+
+  // ... and the hub labels
+  string filename_hl = filename_xml + ".hl";
+  HubLabels labels;
+  time_t start_hl = time(NULL);
+  labels.build(ch, nb_threads, filename_hl + ".part");
+  if (!labels.save(filename_hl)) {
+    cerr << "Could not write " << filename_hl << endl;
+    return EXIT_FAILURE;
+  }
+  cout << "... hub labels written to " << filename_hl << " (" << nb_threads << " threads, " << difftime(time(NULL), start_hl) << " s)" << endl;
+  labels.writeStatistics(cout, "    ");
+
+  return EXIT_SUCCESS;
+
+}